@@ -0,0 +1,190 @@
+/*
+ * Microbenchmarks for the event dispatch primitives in runtime/events.hpp.
+ *
+ * Events are instantiated with generated packs of 1 to 256 handles and
+ * the cost of `run_handles` is measured for sync handles, async handles
+ * and events whose predicate is false, with the status flags of the event
+ * stored in each group type. `StatusFlags::get`/`set` are measured for
+ * each group type as well.
+ *
+ * Timestamps are taken with rdtsc on x86 (reported as cycles) and with
+ * std::chrono elsewhere (reported as nanoseconds). Output is CSV:
+ * benchmark,handles,group_bits,unit,per_dispatch,per_handle
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define NO_ARDUINO
+#include <runtime/platform.hpp>
+#include <runtime/primitives.hpp>
+#include <runtime/events.hpp>
+
+static constexpr size_t iterations = 20'000;
+/// \brief Number of steps an async handle takes to complete.
+static constexpr int async_steps = 4;
+
+#if defined(__x86_64__) || defined(__i386__)
+static const char* unit = "cycles";
+
+static inline u64 timestamp() {
+    return __rdtsc();
+}
+#else
+static const char* unit = "ns";
+
+static inline u64 timestamp() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+/// Forces the value to be materialised, such that work is not optimised away.
+template<typename T>
+static inline void do_not_optimize(T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+static volatile bool predicate_result = true;
+static u32 invocations = 0;
+
+struct Predicate {
+    static bool invoke() {
+        return predicate_result;
+    }
+};
+
+template<size_t N>
+struct SyncHandle {
+    static void invoke() {
+        invocations++;
+        do_not_optimize(invocations);
+    }
+};
+
+/// Selects the group type `G` of the status flags of the event through `StatusGroup`.
+template<size_t Count, typename G>
+struct HandleStates {
+    using StatusGroup = G;
+    int steps[Count];
+};
+
+template<size_t N, size_t Count, typename G>
+struct AsyncHandle : AsyncFunction {
+    using State = int;
+
+    static State& get_state(HandleStates<Count, G>& states) {
+        return states.steps[N];
+    }
+
+    static int begin_invoke(State& state) {
+        state = 0;
+        return step(state);
+    }
+
+    static int step(State& state) {
+        invocations++;
+        return ++state >= async_steps;
+    }
+};
+
+template<typename E>
+static void report(const char* benchmark, size_t handles, size_t group_bits, E& event) {
+    // Warm up caches and branch predictors
+    for (size_t i = 0; i < iterations / 10; i++)
+        run_handles(event);
+
+    auto start = timestamp();
+    for (size_t i = 0; i < iterations; i++) {
+        run_handles(event);
+        do_not_optimize(event);
+    }
+    auto end = timestamp();
+
+    auto per_dispatch = static_cast<double>(end - start) / iterations;
+    std::printf("%s,%zu,%zu,%s,%.2f,%.2f\n", benchmark, handles, group_bits, unit,
+                per_dispatch, per_dispatch / handles);
+}
+
+template<typename G, size_t... I>
+static void run_sync(std::index_sequence<I...>) {
+    constexpr auto count = sizeof...(I);
+    Event<Predicate, HandleStates<1, G>, SyncHandle<I>...> event {};
+    static_assert(std::is_same_v<typename decltype(event.handle_status)::GroupType, G>);
+
+    predicate_result = true;
+    report("sync_dispatch", count, sizeof(G) * 8, event);
+    predicate_result = false;
+    report("sync_idle", count, sizeof(G) * 8, event);
+}
+
+template<typename G, size_t... I>
+static void run_async(std::index_sequence<I...>) {
+    constexpr auto count = sizeof...(I);
+    Event<Predicate, HandleStates<count, G>, AsyncHandle<I, count, G>...> event {};
+    static_assert(std::is_same_v<typename decltype(event.handle_status)::GroupType, G>);
+
+    predicate_result = true;
+    report("async_dispatch", count, sizeof(G) * 8, event);
+    predicate_result = false;
+    report("async_idle", count, sizeof(G) * 8, event);
+}
+
+template<size_t Count, typename G>
+static void run_flags() {
+    StatusFlags<Count, G> flags {};
+
+    auto start = timestamp();
+    for (size_t i = 0; i < iterations; i++) {
+        for (size_t offset = 0; offset < Count; offset++)
+            flags.set(offset, (offset ^ i) & 1);
+        do_not_optimize(flags);
+    }
+    auto end = timestamp();
+    std::printf("flags_set,%zu,%zu,%s,%.2f,%.2f\n", Count, sizeof(G) * 8, unit,
+                static_cast<double>(end - start) / iterations,
+                static_cast<double>(end - start) / iterations / Count);
+
+    size_t set = 0;
+    start = timestamp();
+    for (size_t i = 0; i < iterations; i++) {
+        for (size_t offset = 0; offset < Count; offset++)
+            set += flags.get(offset) != 0;
+        do_not_optimize(set);
+    }
+    end = timestamp();
+    std::printf("flags_get,%zu,%zu,%s,%.2f,%.2f\n", Count, sizeof(G) * 8, unit,
+                static_cast<double>(end - start) / iterations,
+                static_cast<double>(end - start) / iterations / Count);
+}
+
+template<typename G, size_t... Counts>
+static void run_events() {
+    (run_sync<G>(std::make_index_sequence<Counts>()), ...);
+    (run_async<G>(std::make_index_sequence<Counts>()), ...);
+}
+
+template<size_t... Counts>
+static void run_all() {
+    run_events<u8, Counts...>();
+    run_events<u16, Counts...>();
+    run_events<u32, Counts...>();
+    run_events<u64, Counts...>();
+    (run_flags<Counts, u8>(), ...);
+    (run_flags<Counts, u16>(), ...);
+    (run_flags<Counts, u32>(), ...);
+    (run_flags<Counts, u64>(), ...);
+}
+
+int main() {
+    std::printf("benchmark,handles,group_bits,unit,per_dispatch,per_handle\n");
+    run_all<1, 2, 4, 8, 16, 32, 64, 128, 256>();
+    return 0;
+}
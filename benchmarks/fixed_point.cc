@@ -0,0 +1,67 @@
+/*
+ * Compares fixed-point and floating point arithmetic for a typical
+ * sensor-scaling computation (`reading * gain + offset`).
+ *
+ * On targets without an FPU, such as AVR, every float operation is a call
+ * into the soft-float library, while the fixed-point operations stay short
+ * integer instruction sequences. `soft_f32` (see soft_float.hpp) runs the
+ * same soft-float algorithms on the host and is the baseline the fixed-point
+ * types should be compared against. Hardware `f32` is listed for reference,
+ * on the host the FPU makes it the fastest of all.
+ *
+ * Output is CSV: type,operation,nanoseconds per operation
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+
+#define NO_ARDUINO
+#include <runtime/platform.hpp>
+#include <runtime/primitives.hpp>
+#include "soft_float.hpp"
+
+static constexpr size_t iterations = 10'000'000;
+
+/// Forces the value to be materialised, such that the loop is not optimised away.
+template<typename T>
+static inline void do_not_optimize(T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+template<typename T, typename Kernel>
+static void measure(const char* type, const char* operation, Kernel kernel) {
+    T accumulator = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        accumulator = kernel(accumulator, static_cast<u16>(i & 1023));
+        do_not_optimize(accumulator);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    auto elapsed = std::chrono::duration<double, std::nano>(end - start).count();
+    std::printf("%s,%s,%.3f\n", type, operation, elapsed / iterations);
+}
+
+template<typename T>
+static void run(const char* type) {
+    // Volatile such that the constants are not folded into the kernels
+    static volatile double gain_value = 0.0048828125;
+    static volatile double offset_value = -0.5;
+    T gain = static_cast<T>(gain_value);
+    T offset = static_cast<T>(offset_value);
+
+    measure<T>(type, "add", [&](T acc, u16 reading) { return acc + T(reading & 15) + offset; });
+    measure<T>(type, "multiply", [&](T acc, u16 reading) { return acc * gain + T(reading & 15); });
+    measure<T>(type, "divide", [&](T acc, u16 reading) { return acc + T(reading & 15) / (gain + T(1)); });
+    measure<T>(type, "scale", [&](T, u16 reading) { return T(reading) * gain + offset; });
+}
+
+int main() {
+    std::printf("type,operation,ns_per_op\n");
+    run<f32>("f32");
+    run<soft_f32>("soft_f32");
+    run<q8_8>("q8_8");
+    run<q16_16>("q16_16");
+    return 0;
+}
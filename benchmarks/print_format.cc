@@ -0,0 +1,106 @@
+/*
+ * Compares the generic decimal formatting of the arduino `Print` class
+ * (see tests/print_reference.hpp) with `print_format`.
+ *
+ * The host has a hardware divider and FPU, so the results understate the
+ * difference on AVR, where every division of `printNumber` is a call to
+ * `__udivmodsi4` and every float operation of `printFloat` a call into the
+ * soft-float library. Floats are formatted in 32-bit arithmetic like on AVR.
+ * The generic implementation also pays for building a std::string.
+ *
+ * Timestamps are taken with rdtsc on x86 (reported as cycles) and with
+ * std::chrono elsewhere (reported as nanoseconds). Output is CSV:
+ * benchmark,implementation,unit,per_call
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstddef>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <arduino/print_format.h>
+#include "../tests/print_reference.hpp"
+
+static constexpr size_t iterations = 1'000'000;
+
+#if defined(__x86_64__) || defined(__i386__)
+static const char* unit = "cycles";
+
+static inline uint64_t timestamp() {
+    return __rdtsc();
+}
+#else
+static const char* unit = "ns";
+
+static inline uint64_t timestamp() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+/// Forces the value to be materialised, such that work is not optimised away.
+template<typename T>
+static inline void do_not_optimize(T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+template<typename Kernel>
+static void measure(const char* benchmark, const char* implementation, Kernel kernel) {
+    size_t length = 0;
+    auto start = timestamp();
+    for (size_t i = 0; i < iterations; i++) {
+        length += kernel(static_cast<uint32_t>(i));
+        do_not_optimize(length);
+    }
+    auto end = timestamp();
+
+    std::printf("%s,%s,%s,%.1f\n", benchmark, implementation, unit,
+                static_cast<double>(end - start) / iterations);
+}
+
+// Spreads the counter over the whole 32-bit range
+static inline uint32_t scatter(uint32_t i) {
+    return i * 2654435761u;
+}
+
+static inline float sample_float(uint32_t i) {
+    return static_cast<float>(scatter(i) % 2000000) / 1000.0f - 1000.0f;
+}
+
+int main() {
+    std::printf("benchmark,implementation,unit,per_call\n");
+
+    measure("u16", "generic", [](uint32_t i) {
+        return print_reference::print_number(i & 0xFFFF).size();
+    });
+    measure("u16", "print_format", [](uint32_t i) {
+        char buf[10];
+        return static_cast<size_t>(buf + sizeof(buf) - print_format::format_decimal(i & 0xFFFF, buf + sizeof(buf)));
+    });
+
+    measure("u32", "generic", [](uint32_t i) {
+        return print_reference::print_number(scatter(i)).size();
+    });
+    measure("u32", "print_format", [](uint32_t i) {
+        char buf[10];
+        return static_cast<size_t>(buf + sizeof(buf) - print_format::format_decimal(scatter(i), buf + sizeof(buf)));
+    });
+
+    for (uint8_t digits: {2, 6}) {
+        auto name = std::string("float_") + std::to_string(digits);
+        measure(name.c_str(), "generic", [&](uint32_t i) {
+            return print_reference::print_float<float>(sample_float(i), digits).size();
+        });
+        measure(name.c_str(), "print_format", [&](uint32_t i) {
+            char buf[print_format::fixed_length(print_format::max_fixed_digits)];
+            return print_format::format_fixed(buf, sample_float(i), digits);
+        });
+    }
+
+    return 0;
+}
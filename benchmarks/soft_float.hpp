@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/*
+ * IEEE 754 binary32 arithmetic in integer operations only, following the
+ * algorithms of the soft-float routines of libgcc and compiler-rt
+ * (`__addsf3`, `__mulsf3`, `__divsf3`, `__floatsisf`). These are what every
+ * float operation compiles to on targets without an FPU such as AVR, so
+ * `soft_f32` stands in for `f32` on those targets when benchmarking on the host.
+ *
+ * Results are rounded to nearest, ties to even, and match hardware floats
+ * bit for bit apart from the payload of NaNs.
+ */
+namespace soft_float {
+
+    constexpr uint32_t sign_bit = 0x80000000u;
+    constexpr uint32_t abs_mask = 0x7FFFFFFFu;
+    constexpr uint32_t inf_rep = 0x7F800000u;
+    constexpr uint32_t quiet_bit = 0x00400000u;
+    constexpr uint32_t qnan_rep = inf_rep | quiet_bit;
+    constexpr uint32_t implicit_bit = 0x00800000u;
+    constexpr uint32_t significand_mask = 0x007FFFFFu;
+    constexpr int exponent_bias = 127;
+    constexpr int max_exponent = 255;
+
+    inline int clz(uint32_t value) {
+        return __builtin_clz(value);
+    }
+
+    /// Shifts the significand of a subnormal number up to the implicit bit.
+    /// \returns The exponent of the normalised number.
+    inline int normalize(uint32_t& significand) {
+        int shift = clz(significand) - clz(implicit_bit);
+        significand <<= shift;
+        return 1 - shift;
+    }
+
+    /// Assembles a number from a significand with three extra bits (guard, round
+    /// and sticky) below the 24 significant bits, rounding to nearest, ties to even.
+    inline uint32_t round_pack(uint32_t sign, int exponent, uint64_t significand) {
+        if (exponent >= max_exponent)
+            return inf_rep | sign;
+
+        if (exponent <= 0) {
+            // Subnormal result, the bits shifted out are kept as sticky bit
+            unsigned shift = 1 - exponent;
+            if (shift >= 64) {
+                significand = significand != 0;
+            } else {
+                bool sticky = (significand << (64 - shift)) != 0;
+                significand = significand >> shift | sticky;
+            }
+            exponent = 0;
+        }
+
+        auto round_guard_sticky = static_cast<uint32_t>(significand & 7);
+        uint32_t result = static_cast<uint32_t>(significand >> 3) & significand_mask;
+        result |= static_cast<uint32_t>(exponent) << 23;
+        result |= sign;
+
+        // A carry out of the significand correctly increments the exponent
+        if (round_guard_sticky > 4)
+            result++;
+        if (round_guard_sticky == 4)
+            result += result & 1;
+        return result;
+    }
+
+    inline uint32_t add(uint32_t a, uint32_t b) {
+        uint32_t a_abs = a & abs_mask;
+        uint32_t b_abs = b & abs_mask;
+
+        // Zero, infinity or NaN
+        if (a_abs - 1u >= inf_rep - 1u || b_abs - 1u >= inf_rep - 1u) {
+            if (a_abs > inf_rep) return a | quiet_bit;
+            if (b_abs > inf_rep) return b | quiet_bit;
+            if (a_abs == inf_rep) return (a ^ b) == sign_bit ? qnan_rep : a;
+            if (b_abs == inf_rep) return b;
+            if (a_abs == 0) return b_abs == 0 ? a & b : b;
+            if (b_abs == 0) return a;
+        }
+
+        // `a` is the operand of larger magnitude
+        if (b_abs > a_abs) {
+            auto temp = a;
+            a = b;
+            b = temp;
+        }
+
+        int a_exponent = static_cast<int>(a >> 23 & 0xFF);
+        int b_exponent = static_cast<int>(b >> 23 & 0xFF);
+        uint32_t a_significand = a & significand_mask;
+        uint32_t b_significand = b & significand_mask;
+        if (a_exponent == 0) a_exponent = normalize(a_significand);
+        if (b_exponent == 0) b_exponent = normalize(b_significand);
+
+        uint32_t sign = a & sign_bit;
+        bool subtraction = ((a ^ b) & sign_bit) != 0;
+
+        a_significand = (a_significand | implicit_bit) << 3;
+        b_significand = (b_significand | implicit_bit) << 3;
+
+        unsigned align = a_exponent - b_exponent;
+        if (align >= 32) {
+            b_significand = 1;
+        } else if (align > 0) {
+            bool sticky = (b_significand << (32 - align)) != 0;
+            b_significand = b_significand >> align | sticky;
+        }
+
+        if (subtraction) {
+            a_significand -= b_significand;
+            if (a_significand == 0)
+                return 0;
+
+            // Cancellation, shift the leading bit back into place
+            if (a_significand < implicit_bit << 3) {
+                int shift = clz(a_significand) - clz(implicit_bit << 3);
+                a_significand <<= shift;
+                a_exponent -= shift;
+            }
+        } else {
+            a_significand += b_significand;
+            if (a_significand & implicit_bit << 4) {
+                bool sticky = a_significand & 1;
+                a_significand = a_significand >> 1 | sticky;
+                a_exponent += 1;
+            }
+        }
+
+        return round_pack(sign, a_exponent, a_significand);
+    }
+
+    inline uint32_t mul(uint32_t a, uint32_t b) {
+        int a_exponent = static_cast<int>(a >> 23 & 0xFF);
+        int b_exponent = static_cast<int>(b >> 23 & 0xFF);
+        uint32_t sign = (a ^ b) & sign_bit;
+        uint32_t a_significand = a & significand_mask;
+        uint32_t b_significand = b & significand_mask;
+        int scale = 0;
+
+        // Zero, subnormal, infinity or NaN
+        if (a_exponent - 1u >= max_exponent - 1u || b_exponent - 1u >= max_exponent - 1u) {
+            uint32_t a_abs = a & abs_mask;
+            uint32_t b_abs = b & abs_mask;
+            if (a_abs > inf_rep) return a | quiet_bit;
+            if (b_abs > inf_rep) return b | quiet_bit;
+            if (a_abs == inf_rep) return b_abs != 0 ? a_abs | sign : qnan_rep;
+            if (b_abs == inf_rep) return a_abs != 0 ? b_abs | sign : qnan_rep;
+            if (a_abs == 0 || b_abs == 0) return sign;
+            if (a_abs < implicit_bit) scale += normalize(a_significand);
+            if (b_abs < implicit_bit) scale += normalize(b_significand);
+        }
+
+        a_significand |= implicit_bit;
+        b_significand |= implicit_bit;
+
+        // The product of two 24-bit significands has 47 or 48 bits,
+        // keep 24 significant bits and three below for rounding
+        uint64_t product = static_cast<uint64_t>(a_significand) * b_significand;
+        int exponent = a_exponent + b_exponent - exponent_bias + scale;
+        int shift = 20;
+        if (product & (uint64_t(1) << 47))
+            exponent++, shift++;
+
+        bool sticky = (product & ((uint64_t(1) << shift) - 1)) != 0;
+        return round_pack(sign, exponent, product >> shift | sticky);
+    }
+
+    inline uint32_t div(uint32_t a, uint32_t b) {
+        int a_exponent = static_cast<int>(a >> 23 & 0xFF);
+        int b_exponent = static_cast<int>(b >> 23 & 0xFF);
+        uint32_t sign = (a ^ b) & sign_bit;
+        uint32_t a_significand = a & significand_mask;
+        uint32_t b_significand = b & significand_mask;
+        int scale = 0;
+
+        if (a_exponent - 1u >= max_exponent - 1u || b_exponent - 1u >= max_exponent - 1u) {
+            uint32_t a_abs = a & abs_mask;
+            uint32_t b_abs = b & abs_mask;
+            if (a_abs > inf_rep) return a | quiet_bit;
+            if (b_abs > inf_rep) return b | quiet_bit;
+            if (a_abs == inf_rep) return b_abs == inf_rep ? qnan_rep : a_abs | sign;
+            if (b_abs == inf_rep) return sign;
+            if (a_abs == 0) return b_abs == 0 ? qnan_rep : sign;
+            if (b_abs == 0) return inf_rep | sign;
+            if (a_abs < implicit_bit) scale += normalize(a_significand);
+            if (b_abs < implicit_bit) scale -= normalize(b_significand);
+        }
+
+        a_significand |= implicit_bit;
+        b_significand |= implicit_bit;
+
+        // The quotient of the significands is in (0.5, 2), computed with 27 or 28 bits
+        uint64_t numerator = static_cast<uint64_t>(a_significand) << 27;
+        uint64_t quotient = numerator / b_significand;
+        bool sticky = numerator % b_significand != 0;
+        int exponent = a_exponent - b_exponent + exponent_bias + scale;
+
+        if (quotient & (uint64_t(1) << 27)) {
+            sticky |= quotient & 1;
+            quotient >>= 1;
+        } else {
+            exponent--;
+        }
+
+        return round_pack(sign, exponent, quotient | sticky);
+    }
+
+    inline uint32_t from_int(int32_t value) {
+        if (value == 0)
+            return 0;
+
+        uint32_t sign = value < 0 ? sign_bit : 0;
+        uint32_t magnitude = value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+
+        // Place the leading bit at bit 26, above the three rounding bits
+        int exponent = 31 - clz(magnitude);
+        uint64_t significand = static_cast<uint64_t>(magnitude) << 32 >> (exponent + 32 - 26);
+        bool sticky = exponent > 26 && (magnitude & ((1u << (exponent - 26)) - 1)) != 0;
+        return round_pack(sign, exponent + exponent_bias, significand | sticky);
+    }
+}
+
+/// \brief A 32-bit float computed by `soft_float`.
+struct soft_f32 {
+    uint32_t bits = 0;
+
+    soft_f32() = default;
+    soft_f32(int value) : bits(soft_float::from_int(value)) {}
+
+    /// Converted by the FPU, only meant for setting up constants.
+    explicit soft_f32(double value) {
+        auto single = static_cast<float>(value);
+        std::memcpy(&bits, &single, sizeof(bits));
+    }
+
+    [[nodiscard]] float to_float() const {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    friend soft_f32 operator+(soft_f32 a, soft_f32 b) { return from_bits(soft_float::add(a.bits, b.bits)); }
+    friend soft_f32 operator-(soft_f32 a, soft_f32 b) { return from_bits(soft_float::add(a.bits, b.bits ^ soft_float::sign_bit)); }
+    friend soft_f32 operator*(soft_f32 a, soft_f32 b) { return from_bits(soft_float::mul(a.bits, b.bits)); }
+    friend soft_f32 operator/(soft_f32 a, soft_f32 b) { return from_bits(soft_float::div(a.bits, b.bits)); }
+
+private:
+    static soft_f32 from_bits(uint32_t bits) {
+        soft_f32 value;
+        value.bits = bits;
+        return value;
+    }
+};
@@ -9,6 +9,8 @@
 #include "error.hpp"
 #include "sequence.hpp"
 
+#include <unordered_set>
+
 using namespace eel;
 using namespace antlr4;
 
@@ -29,6 +31,15 @@ public:
     Sequence* active_sequence;
     std::vector<Error> errors;
 
+    /// \brief Whether long running loops are split into time slices.
+    /// Outermost `while` loops without awaits in handles, `setup` and `loop`
+    /// make the enclosing function async such that they can yield between iterations.
+    bool time_slicing = false;
+    /// \brief The loops that yield once the time slice budget is exceeded.
+    std::unordered_set<eelParser::WhileStmtContext*> sliced_loops;
+    /// \brief The width of `int` on the target, which constants are computed with.
+    size_t int_width = 16;
+
     explicit ScopeVisitor(SymbolTable* _table);
 
     /*
@@ -113,4 +124,9 @@ public:
      * */
     std::any visitAwaitStmt(eelParser::AwaitStmtContext *ctx) override;
     antlrcpp::Any visitStmtBlock (eelParser::StmtBlockContext* ctx) override;
+    antlrcpp::Any visitWhileStmt (eelParser::WhileStmtContext* ctx) override;
+
+private:
+    /// \brief Number of enclosing `while` loops.
+    size_t loop_depth = 0;
 };
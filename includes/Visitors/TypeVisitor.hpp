@@ -153,6 +153,7 @@ public:
     antlrcpp::Any visitSetPinNumberStmt (eelParser::SetPinNumberStmtContext* ctx) override;
     antlrcpp::Any visitStmtBlock (eelParser::StmtBlockContext* ctx) override;
     antlrcpp::Any visitAwaitStmt (eelParser::AwaitStmtContext* ctx) override;
+    antlrcpp::Any visitEmitStmt (eelParser::EmitStmtContext* ctx) override;
     antlrcpp::Any visitReturnStmt(eelParser::ReturnStmtContext* ctx) override;
 
     /*
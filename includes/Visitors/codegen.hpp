@@ -4,9 +4,13 @@
 #include <antlr4-runtime.h>
 #include <iostream>
 #include <functional>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <symbol_table.hpp>
 #include <sequence.hpp>
+#include <symbols/constant.hpp>
+#include <Visitors/range.hpp>
 
 namespace eel::visitors {
     using namespace eel;
@@ -23,9 +27,94 @@ namespace eel::visitors {
         bool is_in_async_state_case = false;
 
         std::vector<symbols::Event*> events;
+        /// \brief Events emitted by the program, their emits are latched at the start of every pass of the main loop.
+        std::vector<const symbols::Event*> emitted_events;
+
+        /// \brief Number of events at the front of `events` sharing the highest priority.
+        /// These are checked again before each lower priority event is dispatched,
+        /// bounding their response time by the longest single step of another event.
+        /// Zero when all events share the same priority.
+        size_t urgent_event_count = 0;
+
+        /// \brief Cache index of each event whose predicate result is cached between writes.
+        std::unordered_map<const symbols::Event*, size_t> cached_predicates;
+        /// \brief Cache indices of the predicates that read each variable.
+        std::unordered_map<Symbol::Id, std::vector<size_t>> predicate_dependents;
+
+        /// \brief Digital pins read by predicates from the per-tick snapshot, with their pin ids.
+        std::vector<std::pair<Symbol::Id, uint8_t>> snapshot_pins;
+        /// \brief Other pins read by predicates, sampled individually once per tick.
+        std::vector<Symbol::Id> sampled_pins;
+        /// \brief Whether a predicate or handle is being generated.
+        /// Only these read sampled pins from the snapshot.
+        bool is_in_event_code = false;
+
+        /// \brief Loops that yield to the scheduler once the time slice is used up.
+        std::unordered_set<eelParser::WhileStmtContext*> sliced_loops;
+        /// \brief The cases at which the sliced loops of the async function being generated resume.
+        std::vector<uint8_t> sliced_cases;
+
+        /// \brief Whether predicates, handles and the main loop are instrumented
+        /// with profiling counters (see runtime/profile.hpp).
+        bool profile = false;
+        /// \brief Whether handles record their execution in a trace buffer (see runtime/trace.hpp).
+        bool trace = false;
+
+        struct InstrumentedHandle {
+            /// \brief Index of the event in `instrumented_events`.
+            size_t event;
+            std::string name;
+        };
+        /// \brief Source names of the profiled or traced events and handles, in table order.
+        std::vector<std::string> instrumented_events;
+        std::vector<InstrumentedHandle> instrumented_handles;
+
+        /// \brief Path of the EEL source referred to by `#line` directives,
+        /// empty if no directives are emitted.
+        std::string source_path;
+
+        struct SourceMapEntry {
+            std::string generated;
+            std::string kind;
+            std::string name;
+            size_t line;
+        };
+        /// \brief Generated identifiers of the declarations in the program and their
+        /// EEL names, collected when `source_path` is set.
+        std::vector<SourceMapEntry> source_map;
+
+        struct TelemetryField {
+            /// \brief Source text of the value.
+            std::string name;
+            std::string type;
+        };
+        /// \brief A call of `emit_telemetry`, identified on the wire by its index.
+        struct TelemetryMessage {
+            eelParser::FnCallExprContext* call;
+            size_t line;
+            std::vector<TelemetryField> fields;
+        };
+        std::vector<TelemetryMessage> telemetry_messages;
 
         std::function<void()> pre_include_hook;
 
+        /// \brief Statements that have been evaluated at compile time and are not emitted.
+        std::unordered_set<antlr4::ParserRuleContext*> elided_statements;
+        /// \brief Initial values of globals that replace their declared initializer.
+        std::unordered_map<Symbol::Id, symbols::Constant::Value> initial_values;
+
+        /// \brief Events, handles/predicates and declarations that are never reached.
+        std::unordered_set<const symbols::Event*> dead_events;
+        std::unordered_set<const symbols::Function*> dead_functions;
+        std::unordered_set<antlr4::ParserRuleContext*> dead_declarations;
+
+        /// \brief Whether arithmetic should be carried out in the narrowest type
+        /// that range analysis proves to preserve the result.
+        bool narrow_arithmetic = false;
+        /// \brief Human readable description of the operations that were narrowed.
+        std::vector<std::string> narrowing_log;
+        RangeVisitor ranges;
+
         CodegenVisitor(SymbolTable& table, std::iostream* stream);
 
         any visitProgram(eelParser::ProgramContext *ctx) override;
@@ -41,7 +130,14 @@ namespace eel::visitors {
         any visitIdentifier(eelParser::IdentifierContext *ctx) override;
         any visitFnCallExpr(eelParser::FnCallExprContext *ctx) override;
         any visitAssignExpr(eelParser::AssignExprContext *ctx) override;
+        any visitAdditiveAssignExpr(eelParser::AdditiveAssignExprContext *ctx) override;
+        any visitScalingAssignExpr(eelParser::ScalingAssignExprContext *ctx) override;
+        any visitShiftingAssignExpr(eelParser::ShiftingAssignExprContext *ctx) override;
+        any visitOrAssignExpr(eelParser::OrAssignExprContext *ctx) override;
+        any visitAndAssignExpr(eelParser::AndAssignExprContext *ctx) override;
+        any visitXorAssignExpr(eelParser::XorAssignExprContext *ctx) override;
         any visitReadPinExpr(eelParser::ReadPinExprContext *ctx) override;
+        any visitArrayExpr(eelParser::ArrayExprContext *ctx) override;
 
         // Expressions - Arithmetic operators
         any visitPos(eelParser::PosContext *ctx) override;
@@ -61,7 +157,7 @@ namespace eel::visitors {
         any visitAndExpr(eelParser::AndExprContext *ctx) override;
         any visitXorExpr(eelParser::XorExprContext *ctx) override;
         any visitBitComp(eelParser::BitCompContext *ctx) override;
-        //any visitShiftingExpr(eelParser::ShiftingExprContext *ctx) override;
+        any visitShiftingExpr(eelParser::ShiftingExprContext *ctx) override;
 
         // Expressions other
         any visitCastExpr(eelParser::CastExprContext *ctx) override;
@@ -69,16 +165,20 @@ namespace eel::visitors {
 
         // Declarations
         any visitVariableDecl(eelParser::VariableDeclContext* ctx) override;
+        any visitConstDecl(eelParser::ConstDeclContext* ctx) override;
         any visitSetupDecl(eelParser::SetupDeclContext *ctx) override;
         any visitLoopDecl(eelParser::LoopDeclContext *ctx) override;
         any visitEventDecl(eelParser::EventDeclContext* ctx) override;
         any visitOnDecl(eelParser::OnDeclContext* ctx) override;
+        any visitFnDecl(eelParser::FnDeclContext* ctx) override;
         any visitPinDecl(eelParser::PinDeclContext*ctx) override;
 
         // Stmts
         any visitStmt(eelParser::StmtContext *ctx) override;
+        any visitStmtsOrLDecls(eelParser::StmtsOrLDeclsContext* ctx) override;
         any visitStmtBlock(eelParser::StmtBlockContext* ctx) override;
         any visitAwaitStmt(eelParser::AwaitStmtContext* ctx) override;
+        any visitEmitStmt(eelParser::EmitStmtContext* ctx) override;
         any visitReturnStmt(eelParser::ReturnStmtContext *ctx) override;
         any visitIfStmt(eelParser::IfStmtContext *ctx) override;
         any visitWhileStmt(eelParser::WhileStmtContext *ctx) override;
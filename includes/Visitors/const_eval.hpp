@@ -0,0 +1,74 @@
+#pragma once
+
+#include <eelBaseVisitor.h>
+#include <antlr4-runtime.h>
+
+#include <symbol_table.hpp>
+#include <symbols/constant.hpp>
+
+namespace eel::visitors {
+    using namespace eel;
+    using std::any;
+
+    /// \brief Evaluates expressions at compile time.
+    /// Every visit returns a `symbols::Constant::Value`. Any expression
+    /// that cannot be evaluated (function calls, variables, pin reads, ...)
+    /// results in a value of kind `None`, which propagates outwards.
+    ///
+    /// Integer operations on typed values are carried out in the type the
+    /// generated c++ code uses, such that they wrap at the same width.
+    /// Operations on literals only are folded exactly.
+    struct ConstEvalVisitor : eelBaseVisitor {
+        using Value = symbols::Constant::Value;
+
+        Scope scope;
+        /// \brief The width of `int` on the target in bits, see `RangeVisitor::int_width`.
+        size_t int_width = 16;
+
+        explicit ConstEvalVisitor(Scope scope);
+
+        /// \brief Evaluates the given expression.
+        /// \returns The computed value, or a value of kind `None`
+        ///          if the expression is not a constant expression.
+        Value evaluate(eelParser::ExprContext* ctx);
+
+        /// \brief Parses a decimal or hexadecimal integer literal token.
+        static uint64_t parse_integer(antlr4::tree::TerminalNode* literal);
+
+        any visitChildren(antlr4::tree::ParseTree* node) override;
+
+        // Expressions - Literals
+        any visitIntegerLiteral(eelParser::IntegerLiteralContext* ctx) override;
+        any visitFloatLiteral(eelParser::FloatLiteralContext* ctx) override;
+        any visitBoolLiteral(eelParser::BoolLiteralContext* ctx) override;
+        any visitCharLiteral(eelParser::CharLiteralContext* ctx) override;
+
+        // Expressions - Access
+        any visitParenExpr(eelParser::ParenExprContext* ctx) override;
+        any visitFqnExpr(eelParser::FqnExprContext* ctx) override;
+        any visitArrayExpr(eelParser::ArrayExprContext* ctx) override;
+        any visitCastExpr(eelParser::CastExprContext* ctx) override;
+
+        // Expressions - Unary operators
+        any visitPos(eelParser::PosContext* ctx) override;
+        any visitNeg(eelParser::NegContext* ctx) override;
+        any visitNot(eelParser::NotContext* ctx) override;
+        any visitBitComp(eelParser::BitCompContext* ctx) override;
+
+        // Expressions - Binary operators
+        any visitScalingExpr(eelParser::ScalingExprContext* ctx) override;
+        any visitAdditiveExpr(eelParser::AdditiveExprContext* ctx) override;
+        any visitShiftingExpr(eelParser::ShiftingExprContext* ctx) override;
+        any visitComparisonExpr(eelParser::ComparisonExprContext* ctx) override;
+        any visitAndExpr(eelParser::AndExprContext* ctx) override;
+        any visitXorExpr(eelParser::XorExprContext* ctx) override;
+        any visitOrExpr(eelParser::OrExprContext* ctx) override;
+        any visitLAndExpr(eelParser::LAndExprContext* ctx) override;
+        any visitLOrExpr(eelParser::LOrExprContext* ctx) override;
+
+    protected:
+        /// \brief Looks up the value bound to a name.
+        /// Only constants are resolved by default.
+        virtual Value lookup(const Symbol& symbol);
+    };
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <eelParser.h>
+#include <antlr4-runtime.h>
+
+#include <symbol_table.hpp>
+#include <symbols/event.hpp>
+
+namespace eel::visitors {
+
+    /// \brief Determines which global variables each event predicate reads.
+    /// A predicate that only depends on global variables is pure in the program state,
+    /// so its result only has to be recomputed after one of those variables is written.
+    /// Such predicates are assigned a cache index.
+    ///
+    /// Predicates that read pins, call functions (which may read time or hardware),
+    /// await, emit, declare statics, write globals or read variables whose address
+    /// is taken anywhere in the program are left polled.
+    struct PredicateDependencies {
+        struct Result {
+            /// \brief Cache index of each event whose predicate result can be cached.
+            std::unordered_map<const symbols::Event*, size_t> cached;
+            /// \brief Cache indices of the predicates that read each variable.
+            std::unordered_map<Symbol::Id, std::vector<size_t>> dependents;
+            /// \brief Human readable summary of the analysis.
+            std::vector<std::string> log;
+        };
+
+        SymbolTable& table;
+
+        explicit PredicateDependencies(SymbolTable& table);
+
+        Result run(eelParser::ProgramContext* program);
+
+    private:
+        /// \brief Collects the variables read by a predicate.
+        /// \returns An empty string if the predicate can be cached,
+        ///          otherwise the reason it cannot.
+        std::string scan(Scope scope, antlr4::tree::ParseTree* tree, std::unordered_set<Symbol::Id>& reads);
+
+        /// \brief Collects globals whose address is taken.
+        void find_escaping(antlr4::tree::ParseTree* tree);
+
+        /// \brief Resolves an identifier to a global variable, or null.
+        Symbol find_global(Scope scope, const std::string& name);
+
+        std::unordered_set<Symbol::Id> escaping;
+    };
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <eelParser.h>
+#include <antlr4-runtime.h>
+
+#include <symbol_table.hpp>
+#include <symbols/event.hpp>
+#include <symbols/function.hpp>
+
+namespace eel::visitors {
+
+    /// \brief Estimates how long each function runs between yield points and how much memory it uses.
+    /// Cycle costs are rough estimates for an 8-bit AVR at the level of single operations,
+    /// pin accesses and calls. Loops without awaits that step a counter by a constant
+    /// towards a constant bound are counted with their trip count. Any other loop without
+    /// awaits is counted as a single iteration and reported as unbounded.
+    /// Calls of user-defined functions are followed into the function body, while
+    /// functions declared with `declare_fn_cpp` are external and get a fixed cost.
+    ///
+    /// Memory sizes follow the AVR data model (2 byte `int`, 4 byte `double`).
+    struct LatencyAnalysis {
+        /// \brief Estimated cost of a path through a function.
+        struct Cost {
+            uint64_t cycles = 0;
+            size_t statements = 0;
+
+            Cost operator+(const Cost& other) const;
+            Cost operator*(uint64_t times) const;
+            bool operator<(const Cost& other) const;
+        };
+
+        struct Report {
+            std::string name;
+            bool is_async = false;
+            /// \brief The longest path between two yield points, or between
+            /// the start or end of the function and a yield point.
+            Cost longest_segment;
+            size_t yield_points = 0;
+            /// \brief Loops whose number of iterations is not known at compile time.
+            size_t unbounded_loops = 0;
+            /// \brief Calls of external functions, including those made by called user-defined functions.
+            size_t extern_calls = 0;
+            /// \brief Estimated stack usage of the synchronous call chain from `main`.
+            size_t stack_bytes = 0;
+            /// \brief Size of the `State` of an async function.
+            size_t state_bytes = 0;
+        };
+
+        struct Result {
+            std::vector<Report> functions;
+            size_t global_bytes = 0;
+            size_t event_bytes = 0;
+
+            [[nodiscard]] std::string to_text() const;
+            [[nodiscard]] std::string to_json() const;
+        };
+
+        SymbolTable& table;
+        /// \brief Events that are not generated, which do not take up any memory.
+        std::unordered_set<const symbols::Event*> dead_events;
+
+        explicit LatencyAnalysis(SymbolTable& table);
+
+        Result run(eelParser::ProgramContext* program);
+
+    private:
+        /// \brief The paths through a piece of code, split at yield points.
+        struct Path {
+            /// \brief Longest path from start to end without yielding.
+            std::optional<Cost> through;
+            /// \brief Longest path from the start to the first yield point.
+            std::optional<Cost> head;
+            /// \brief Longest path from the last yield point to the end.
+            std::optional<Cost> tail;
+            /// \brief Longest path between two yield points.
+            Cost inner;
+
+            static Path of(Cost cost);
+            static Path yield(Cost resume_cost);
+
+            /// \brief Runs `this` followed by `next`.
+            [[nodiscard]] Path then(const Path& next) const;
+            /// \brief Runs either `this` or `other`.
+            [[nodiscard]] Path either(const Path& other) const;
+        };
+
+        /// \brief The cost of running a user-defined function to completion.
+        struct Callee {
+            uint64_t cycles = 0;
+            /// \brief Stack used by the function and the functions it calls, including its frame.
+            size_t stack_bytes = 0;
+            size_t extern_calls = 0;
+            size_t unbounded_loops = 0;
+        };
+
+        Report analyze(const std::string& name, const symbols::Function& function);
+        const Callee& analyze_callee(eelParser::FnDeclContext* function);
+
+        Path walk(antlr4::tree::ParseTree* tree);
+        /// \brief The number of iterations of a loop stepping a counter towards a constant bound.
+        /// \returns The maximum number of iterations, or nothing if the loop is not of that form.
+        std::optional<uint64_t> trip_count(eelParser::WhileStmtContext* loop);
+        uint64_t expression_cycles(antlr4::tree::ParseTree* tree);
+        /// \brief Accounts for a call, returning the cycles spent within the called function.
+        uint64_t call_cycles(eelParser::FqnContext* fqn);
+
+        Report* current = nullptr;
+        /// \brief Deepest stack used by a call of the function being analyzed.
+        size_t call_bytes = 0;
+
+        std::unordered_map<std::string, eelParser::FnDeclContext*> functions;
+        std::unordered_map<eelParser::FnDeclContext*, Callee> callees;
+        /// \brief User-defined functions being analyzed, to detect recursion.
+        std::unordered_set<eelParser::FnDeclContext*> entered;
+    };
+}
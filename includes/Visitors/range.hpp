@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+#include <eelBaseVisitor.h>
+#include <antlr4-runtime.h>
+
+#include <symbol_table.hpp>
+#include <symbols/type.hpp>
+
+namespace eel::visitors {
+    using namespace eel;
+    using std::any;
+
+    /// \brief The set of values an integer expression may evaluate to.
+    /// Along with the interval the static type of the expression is tracked,
+    /// which is the type the generated c++ code performs the operation in.
+    struct Range {
+        /// \brief Whether `lo` and `hi` hold.
+        /// Unbounded ranges are used for floats, 64-bit values of unknown range
+        /// and anything that cannot be reasoned about.
+        bool bounded = false;
+        int64_t lo = 0;
+        int64_t hi = 0;
+        /// \brief The static type of the expression,
+        /// `nullptr` for literals and other untyped expressions.
+        const symbols::Primitive* type = nullptr;
+
+        static Range exact(int64_t value);
+        static Range of(int64_t lo, int64_t hi, const symbols::Primitive* type = nullptr);
+        static Range of_type(const symbols::Primitive* type);
+
+        [[nodiscard]] bool contains(const Range& other) const;
+    };
+
+    /// \brief Infers value ranges of expressions.
+    /// Ranges are seeded from literals, constants, pin reads
+    /// (0-1 for `digital`, 0-1023 for `analog`), casts and declared types,
+    /// and propagated through the arithmetic and bitwise operators.
+    struct RangeVisitor : eelBaseVisitor {
+        Scope scope;
+
+        /// \brief The width of `int` on the target in bits, 16 on AVR and 32 on the host.
+        /// Operands narrower than `int` are promoted to it before any arithmetic.
+        size_t int_width = 16;
+
+        explicit RangeVisitor(Scope scope);
+
+        Range evaluate(eelParser::ExprContext* ctx);
+
+        /// \brief Finds a narrower type in which a binary operation can be carried out
+        /// without changing its result.
+        /// Only operations performed in types wider than `int` are considered since
+        /// anything narrower is promoted back to `int` width.
+        /// \returns The narrower type, or `nullptr` if the operation cannot be narrowed.
+        const symbols::Primitive* narrowed_type(const Range& left, const Range& right, const Range& result,
+                                                bool is_shift = false);
+
+        any visitChildren(antlr4::tree::ParseTree* node) override;
+
+        any visitIntegerLiteral(eelParser::IntegerLiteralContext* ctx) override;
+        any visitCharLiteral(eelParser::CharLiteralContext* ctx) override;
+        any visitBoolLiteral(eelParser::BoolLiteralContext* ctx) override;
+
+        any visitParenExpr(eelParser::ParenExprContext* ctx) override;
+        any visitFqnExpr(eelParser::FqnExprContext* ctx) override;
+        any visitArrayExpr(eelParser::ArrayExprContext* ctx) override;
+        any visitReadPinExpr(eelParser::ReadPinExprContext* ctx) override;
+        any visitCastExpr(eelParser::CastExprContext* ctx) override;
+
+        any visitPos(eelParser::PosContext* ctx) override;
+        any visitNeg(eelParser::NegContext* ctx) override;
+        any visitNot(eelParser::NotContext* ctx) override;
+
+        any visitScalingExpr(eelParser::ScalingExprContext* ctx) override;
+        any visitAdditiveExpr(eelParser::AdditiveExprContext* ctx) override;
+        any visitShiftingExpr(eelParser::ShiftingExprContext* ctx) override;
+        any visitComparisonExpr(eelParser::ComparisonExprContext* ctx) override;
+        any visitAndExpr(eelParser::AndExprContext* ctx) override;
+        any visitXorExpr(eelParser::XorExprContext* ctx) override;
+        any visitOrExpr(eelParser::OrExprContext* ctx) override;
+        any visitLAndExpr(eelParser::LAndExprContext* ctx) override;
+        any visitLOrExpr(eelParser::LOrExprContext* ctx) override;
+
+    private:
+        std::unordered_map<antlr4::tree::ParseTree*, Range> cache;
+
+        /// \brief The type of an operand, `int` (or wider) for untyped bounded ranges such as literals.
+        const symbols::Primitive* operand_type(const Range& range) const;
+        /// \brief The type a binary operation on the two operands is carried out in.
+        /// `nullptr` if both operands are untyped.
+        const symbols::Primitive* common_type(const Range& left, const Range& right) const;
+        Range bitwise_union(const Range& left, const Range& right) const;
+    };
+
+    /// \brief The width in bits of an integer primitive, or 0 if not a fixed width integer.
+    size_t integer_width(const symbols::Primitive* type);
+
+    /// \brief The signed integer primitive of the given width.
+    const symbols::Primitive* signed_type(size_t width);
+
+    /// \brief Applies the integral promotion of c++.
+    /// Integers narrower than `int` and booleans become `int`, anything else is left as is.
+    const symbols::Primitive* promoted_type(const symbols::Primitive* type, size_t int_width);
+
+    /// \brief The type of an integer literal holding `value`, `int` or the narrowest wider type it fits.
+    const symbols::Primitive* literal_type(int64_t value, size_t int_width);
+
+    /// \brief The type a binary operation is carried out in.
+    /// Mirrors the usual arithmetic conversions of c++, including the integral promotion,
+    /// for fixed width integers. Any other operand type gives `nullptr`.
+    const symbols::Primitive* arithmetic_type(const symbols::Primitive* left, const symbols::Primitive* right,
+                                              size_t int_width);
+}
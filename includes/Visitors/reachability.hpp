@@ -0,0 +1,64 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <eelParser.h>
+#include <antlr4-runtime.h>
+
+#include <symbol_table.hpp>
+#include <symbols/event.hpp>
+#include <error.hpp>
+
+namespace eel::visitors {
+
+    /// \brief Program-wide reachability analysis of events, handles and functions.
+    /// Starting from `setup` and `loop` the analysis follows awaits, emits and calls.
+    /// An event is live if it is awaited from reachable code, or if it can
+    /// occur (has a predicate or is emitted from reachable code) and has handles.
+    /// The handles and predicate of a live event are reachable in turn.
+    ///
+    /// `symbols::Event::is_awaited` is updated to reflect only reachable awaits.
+    struct ReachabilityAnalysis {
+        struct Result {
+            std::unordered_set<const symbols::Event*> dead_events;
+            /// \brief Handles and predicates that can never run.
+            std::unordered_set<const symbols::Function*> dead_functions;
+            /// \brief Function declarations that are never called.
+            std::unordered_set<antlr4::ParserRuleContext*> dead_declarations;
+            /// \brief Statements without any observable effect (emits of dead events).
+            std::unordered_set<antlr4::ParserRuleContext*> dead_statements;
+            /// \brief Human readable summary of what was removed.
+            std::vector<std::string> log;
+            /// \brief Reachable constructs that cannot be compiled, such as calls of user-defined functions
+            /// or the use of both built-in serial events.
+            std::vector<Error> errors;
+        };
+
+        SymbolTable& table;
+
+        explicit ReachabilityAnalysis(SymbolTable& table);
+
+        Result run(eelParser::ProgramContext* program);
+
+    private:
+        /// \brief Records the awaits, emits and calls found within the tree.
+        void scan(antlr4::tree::ParseTree* tree);
+
+        /// \brief Marks the given function body as reachable.
+        void reach(antlr4::tree::ParseTree* body);
+
+        /// \brief Resolves an event referred to in an await or emit.
+        symbols::Event* find_event(eelParser::FqnContext* fqn);
+
+        std::vector<antlr4::tree::ParseTree*> worklist;
+        std::unordered_set<antlr4::tree::ParseTree*> reached;
+
+        std::unordered_map<std::string, eelParser::FnDeclContext*> functions;
+        /// \brief Awaited events and the first await of each.
+        std::unordered_map<const symbols::Event*, eelParser::AwaitStmtContext*> awaited;
+        std::unordered_set<const symbols::Event*> emitted;
+        std::unordered_map<const symbols::Event*, std::vector<antlr4::ParserRuleContext*>> emit_sites;
+    };
+}
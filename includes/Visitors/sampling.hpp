@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <eelParser.h>
+#include <antlr4-runtime.h>
+
+#include <symbol_table.hpp>
+
+namespace eel::visitors {
+
+    /// \brief Finds the pins read by event predicates, which are sampled once per tick.
+    /// Digital pins with a constant id that is never changed through `set .. pin`
+    /// are read into a single snapshot, allowing whole ports to be read at once.
+    /// Any other pin read by a predicate is sampled individually.
+    struct InputSampling {
+        struct Result {
+            /// \brief Digital pins read into the snapshot along with their pin ids,
+            /// in snapshot order.
+            std::vector<std::pair<Symbol::Id, uint8_t>> snapshot_pins;
+            /// \brief Pins that are sampled individually.
+            std::vector<Symbol::Id> sampled_pins;
+            /// \brief Human readable summary of the analysis.
+            std::vector<std::string> log;
+        };
+
+        SymbolTable& table;
+
+        explicit InputSampling(SymbolTable& table);
+
+        Result run(eelParser::ProgramContext* program);
+
+    private:
+        /// \brief Collects the global pins read within the tree.
+        void find_reads(antlr4::tree::ParseTree* tree);
+
+        /// \brief Collects the pins whose id is changed at runtime.
+        void find_renumbered(antlr4::tree::ParseTree* tree);
+
+        std::unordered_set<Symbol::Id> read;
+        std::unordered_set<Symbol::Id> renumbered;
+    };
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include <Visitors/const_eval.hpp>
+
+namespace eel::visitors {
+
+    /// \brief Partially evaluates `setup` at compile time.
+    /// The evaluator interprets the leading statements of setup for as long
+    /// as they are free of side effects (variable initialisation and assignments
+    /// of constant expressions). Assignments to globals within this prefix are
+    /// folded into the initial value of the global and the statement itself
+    /// is elided from the generated code. Evaluation stops at the first statement
+    /// that may touch hardware or depend on runtime state (calls, pin statements,
+    /// control flow, awaits, ...).
+    struct SetupEvaluator : ConstEvalVisitor {
+        struct Result {
+            /// \brief Statements that should not be emitted by codegen.
+            std::unordered_set<antlr4::ParserRuleContext*> elided_statements;
+            /// \brief Initial values of globals, replacing their declared initializer.
+            std::unordered_map<Symbol::Id, Value> initial_values;
+            /// \brief Human readable description of what was pre-evaluated.
+            std::vector<std::string> log;
+        };
+
+        SymbolTable& table;
+
+        explicit SetupEvaluator(SymbolTable& table);
+
+        Result run(eelParser::ProgramContext* program);
+
+    protected:
+        Value lookup(const Symbol& symbol) override;
+
+    private:
+        /// \brief Binds the initial values of globals with constant initializers.
+        void bind_globals(eelParser::ProgramContext* program);
+
+        /// \brief Interprets a single statement of setup.
+        /// \returns false if the statement ends the side-effect free prefix.
+        bool interpret(eelParser::VariableDeclContext* ctx);
+        bool interpret(eelParser::StmtContext* ctx);
+
+        std::unordered_map<Symbol::Id, Value> bindings;
+        /// \brief Globals read by the initializer of another global.
+        /// Changing their initial value would change the value observed by the
+        /// dependant initializer, so assignments to these are never folded.
+        std::unordered_set<Symbol::Id> pinned_globals;
+        Result result;
+    };
+}
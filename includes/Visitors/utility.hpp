@@ -19,6 +19,9 @@ namespace eel::visitors {
     /// \brief Get the source text location of a given token
     SourcePos get_source_location(antlr4::Token* token);
 
+    /// \brief Flattens the right-recursive `exprList` rule into its expressions.
+    std::vector<eelParser::ExprContext*> flatten_expr_list(eelParser::ExprListContext* list);
+
     extern const char* builtin_setup_name;
     extern const char* builtin_loop_name;
 
@@ -131,9 +131,20 @@ class HardwareSerial : public Stream
     inline size_t write(long n) { return write((uint8_t)n); }
     inline size_t write(unsigned int n) { return write((uint8_t)n); }
     inline size_t write(int n) { return write((uint8_t)n); }
+    // Copies contiguous runs into the TX buffer instead of queueing byte by byte
+    virtual size_t write(const uint8_t *buffer, size_t size);
     using Print::write; // pull in write(str) and write(buf, size) from Print
     operator bool() { return true; }
 
+    // Direct access to the RX ring buffer. Bytes between the tail and the
+    // head are never touched by the interrupt handler, so they can be read
+    // in place until they are released with rxConsume().
+    inline const unsigned char* rxBuffer(void) const { return _rx_buffer; }
+    inline rx_buffer_index_t rxTail(void) const { return _rx_buffer_tail; }
+    inline void rxConsume(rx_buffer_index_t count) {
+      _rx_buffer_tail = (rx_buffer_index_t)((_rx_buffer_tail + count) % SERIAL_RX_BUFFER_SIZE);
+    }
+
     // Interrupt handlers - Not intended to be called externally
     inline void _rx_complete_irq(void);
     void _tx_udr_empty_irq(void);
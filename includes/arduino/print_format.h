@@ -0,0 +1,208 @@
+/*
+  print_format.h - Fast decimal formatting for Print
+
+  Produces exactly the text of the generic Print::printNumber and
+  Print::printFloat for base 10, which divide once per digit and loop over
+  soft-float operations respectively. Integers are split into pairs of
+  digits by multiplying with reciprocals, floats are formatted with a
+  single pass of integer arithmetic that reproduces the rounding of the
+  original float loop bit for bit.
+
+  Header only, such that the formatting can be verified on the host.
+*/
+
+#ifndef print_format_h
+#define print_format_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define PRINT_FORMAT_PROGMEM PROGMEM
+#else
+#define PRINT_FORMAT_PROGMEM
+#endif
+
+namespace print_format {
+
+  static const char digit_pairs[] PRINT_FORMAT_PROGMEM =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+  // 0.5 / 10^digits as computed by the rounding loop of printFloat
+  // in 32-bit float arithmetic (`rounding /= 10.0` once per digit)
+  static const float rounding_table[] PRINT_FORMAT_PROGMEM = {
+    0x1p-1f, 0x1.99999ap-5f, 0x1.47ae14p-8f, 0x1.0624dcp-11f,
+    0x1.a36e2cp-15f, 0x1.4f8b56p-18f, 0x1.0c6f78p-21f, 0x1.ad7f26p-25f,
+    0x1.5798ecp-28f, 0x1.12e0bcp-31f, 0x1.b7cdfap-35f, 0x1.5fd7fcp-38f,
+    0x1.197996p-41f, 0x1.c25c24p-45f, 0x1.6849b6p-48f, 0x1.203af8p-51f,
+    0x1.cd2b26p-55f,
+  };
+
+  // Most fraction digits format_fixed() handles
+  const uint8_t max_fixed_digits = sizeof(rounding_table) / sizeof(rounding_table[0]) - 1;
+
+  // Buffer size format_fixed() needs: sign, 10 integer digits, point and fraction
+  inline constexpr size_t fixed_length(uint8_t digits) { return 12 + digits; }
+
+  inline void copy_pair(char *dst, uint16_t value)
+  {
+#ifdef __AVR__
+    memcpy_P(dst, &digit_pairs[value * 2], 2);
+#else
+    memcpy(dst, &digit_pairs[value * 2], 2);
+#endif
+  }
+
+  inline float read_rounding(uint8_t digits)
+  {
+#ifdef __AVR__
+    return pgm_read_float(&rounding_table[digits]);
+#else
+    return rounding_table[digits];
+#endif
+  }
+
+  // x / 100 for any 16-bit x, without a division
+  inline uint16_t div100(uint16_t x)
+  {
+    return (uint16_t)(((uint32_t)(x >> 2) * 5243) >> 17);
+  }
+
+  // Writes the decimal digits of n backwards, ending just before `end`.
+  // Returns the first digit, at most 10 characters are used.
+  inline char *format_decimal(uint32_t n, char *end)
+  {
+    char *str = end;
+
+    // Four digits at a time until the value fits 16 bits,
+    // n / 10000 is a widening multiply and a shift
+    while (n > 0xFFFF) {
+      uint32_t q = (uint32_t)(((uint64_t)n * 0xD1B71759UL) >> 45);
+      uint16_t r = (uint16_t)(n - q * 10000);
+      uint16_t hi = div100(r);
+      str -= 4;
+      copy_pair(str, hi);
+      copy_pair(str + 2, r - hi * 100);
+      n = q;
+    }
+
+    uint16_t x = (uint16_t)n;
+    while (x >= 100) {
+      uint16_t q = div100(x);
+      str -= 2;
+      copy_pair(str, x - q * 100);
+      x = q;
+    }
+
+    if (x >= 10) {
+      str -= 2;
+      copy_pair(str, x);
+    } else {
+      *--str = (char)('0' + x);
+    }
+    return str;
+  }
+
+  // Digits of a float remainder in [0, 1) as produced by
+  //   remainder *= 10.0; digit = (unsigned int)remainder; remainder -= digit;
+  // in 32-bit float arithmetic. The remainder is kept exactly as m * 2^-shift,
+  // so only the rounding of the multiplication has to be reproduced.
+  // The subtraction is always exact and 10 * remainder never rounds up to 10.
+  class Fraction
+  {
+    public:
+      explicit Fraction(float remainder)
+      {
+        uint32_t bits;
+        memcpy(&bits, &remainder, sizeof(bits));
+        uint8_t exponent = (uint8_t)(bits >> 23);
+        m = bits & 0x7FFFFFUL;
+        if (exponent == 0) {
+          shift = 149;
+        } else {
+          m |= 0x800000UL;
+          shift = 150 - exponent;
+        }
+      }
+
+      char next()
+      {
+        uint32_t t = m * 10;
+
+        // Round to the 24 significant bits of a float, ties to even
+        uint8_t excess = 0;
+        while ((t >> excess) > 0xFFFFFFUL) excess++;
+        if (excess > 0) {
+          uint32_t half = 1UL << (excess - 1);
+          uint32_t rest = t & ((half << 1) - 1);
+          t >>= excess;
+          if (rest > half || (rest == half && (t & 1))) t++;
+          shift -= excess;
+        }
+
+        // t < 2^28, so with larger shifts the digit is 0
+        uint8_t digit = 0;
+        if (shift < 28) {
+          digit = (uint8_t)(t >> shift);
+          t &= (1UL << shift) - 1;
+        }
+        m = t;
+        return (char)('0' + digit);
+      }
+
+    private:
+      uint32_t m;
+      uint16_t shift;
+  };
+
+  // Formats like Print::printFloat where double is a 32-bit float, for up to
+  // max_fixed_digits fraction digits. `buf` needs fixed_length(digits) bytes.
+  // Returns the number of characters written, no terminator is added.
+  inline size_t format_fixed(char *buf, float number, uint8_t digits)
+  {
+    const char *special = NULL;
+    if (isnan(number)) special = "nan";
+    else if (isinf(number)) special = "inf";
+    else if (number > 4294967040.0f || number < -4294967040.0f) special = "ovf";
+    if (special != NULL) {
+      memcpy(buf, special, 3);
+      return 3;
+    }
+
+    bool negative = number < 0.0f;
+    if (negative) number = -number;
+
+    number += read_rounding(digits);
+    uint32_t int_part = (uint32_t)number;
+    float remainder = number - (float)int_part;
+
+    // The integer part is formatted in place behind the sign
+    char *end = buf + 11;
+    char *str = format_decimal(int_part, end);
+    if (negative) *--str = '-';
+    size_t length = end - str;
+    memmove(buf, str, length);
+
+    if (digits > 0) {
+      buf[length++] = '.';
+      Fraction fraction(remainder);
+      while (digits-- > 0)
+        buf[length++] = fraction.next();
+    }
+    return length;
+  }
+}
+
+#endif
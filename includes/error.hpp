@@ -22,6 +22,8 @@ public:
         AlreadyDefined,
         ExpectedVariable,
         UndefinedType,
+        NotConstant,
+        Unsupported,
     };
     explicit Error();
     explicit Error(Error::Kind kind);
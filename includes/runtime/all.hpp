@@ -6,4 +6,12 @@
 
 #include <runtime/platform.hpp>
 #include <runtime/primitives.hpp>
-#include <runtime/events.hpp>
\ No newline at end of file
+#include <runtime/events.hpp>
+#include <runtime/progmem.hpp>
+#include <runtime/arithmetic.hpp>
+#include <runtime/sampling.hpp>
+#include <runtime/time_slice.hpp>
+#include <runtime/profile.hpp>
+#include <runtime/trace.hpp>
+#include <runtime/serial.hpp>
+#include <runtime/telemetry.hpp>
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <runtime/platform.hpp>
+#include <runtime/primitives.hpp>
+
+/*
+ * AVR has no hardware divider, so integer division and modulo become
+ * calls into libgcc costing hundreds of cycles. When the divisor is known
+ * at compile time the quotient can instead be computed with a multiply-high
+ * and a shift (see Granlund & Montgomery, "Division by Invariant Integers
+ * using Multiplication"), and powers of two reduce to plain shifts and masks.
+ *
+ * The compiler emits `div_const<T, D>(x)` and `mod_const<T, D>(x)` for
+ * `x / D` and `x % D` whenever D is a positive constant. Results are
+ * identical to the built-in operators, including truncation towards zero
+ * and the sign of the remainder for signed types.
+ */
+
+namespace arithmetic {
+
+    template<typename T>
+    struct IntegerTraits;
+
+    template<> struct IntegerTraits<u8> { using Unsigned = u8; using Wide = u16; };
+    template<> struct IntegerTraits<u16> { using Unsigned = u16; using Wide = u32; };
+    template<> struct IntegerTraits<u32> { using Unsigned = u32; using Wide = u64; };
+    template<> struct IntegerTraits<u64> { using Unsigned = u64; using Wide = void; };
+    template<> struct IntegerTraits<i8> { using Unsigned = u8; using Wide = u16; };
+    template<> struct IntegerTraits<i16> { using Unsigned = u16; using Wide = u32; };
+    template<> struct IntegerTraits<i32> { using Unsigned = u32; using Wide = u64; };
+    template<> struct IntegerTraits<i64> { using Unsigned = u64; using Wide = void; };
+
+    template<typename T>
+    constexpr bool is_signed = static_cast<T>(-1) < 0;
+
+    template<typename U>
+    constexpr bool is_power_of_two(U value) {
+        return (value & (value - 1)) == 0;
+    }
+
+    template<typename U>
+    constexpr u8 log2(U value) {
+        u8 result = 0;
+        while (value >>= 1)
+            result++;
+        return result;
+    }
+
+    /// \brief Multiplier and shift for the unsigned division by D.
+    /// The quotient is `(x * multiplier) >> (width + shift)`, where the multiplier
+    /// is `ceil(2^(width + shift) / D)`. The shift chosen is the smallest for
+    /// which the rounding error never reaches the next integer for any x.
+    template<typename U, U D>
+    struct DivisionMagic {
+        static constexpr u8 width = sizeof(U) * 8;
+
+        static constexpr u8 find_shift() {
+            for (u8 s = 0; s < width; s++) {
+                u64 power = static_cast<u64>(1) << (width + s);
+                u64 m = (power + D - 1) / D;
+                if (m * D - power <= (static_cast<u64>(1) << s))
+                    return s;
+            }
+            return width;
+        }
+
+        static constexpr u8 shift = find_shift();
+        static constexpr u64 multiplier = ((static_cast<u64>(1) << (width + shift)) + D - 1) / D;
+        /// \brief Whether the multiplier needs `width + 1` bits.
+        static constexpr bool needs_add = (multiplier >> width) != 0;
+    };
+
+    template<typename U, U D>
+    inline U unsigned_div(U x) {
+        static_assert(D != 0, "division by zero");
+        using Wide = typename IntegerTraits<U>::Wide;
+        constexpr u8 width = sizeof(U) * 8;
+
+        if constexpr (is_power_of_two(D)) {
+            return x >> log2(D);
+        } else if constexpr (D > (static_cast<U>(1) << (width - 1))) {
+            // The quotient can only be 0 or 1
+            return x >= D;
+        } else {
+            static_assert(sizeof(U) < 8, "no wider type for the multiplication");
+            using Magic = DivisionMagic<U, D>;
+
+            if constexpr (!Magic::needs_add) {
+                return static_cast<U>((static_cast<Wide>(x) * static_cast<Wide>(Magic::multiplier)) >> (width + Magic::shift));
+            } else {
+                // The multiplier does not fit in U, so the implicit top bit is added separately.
+                // (t + x) >> s is computed as (t + ((x - t) >> 1)) >> (s - 1) to avoid overflowing U.
+                constexpr U low = static_cast<U>(Magic::multiplier);
+                U t = static_cast<U>((static_cast<Wide>(x) * low) >> width);
+                return static_cast<U>((t + static_cast<U>((x - t) >> 1)) >> (Magic::shift - 1));
+            }
+        }
+    }
+}
+
+/// \brief Computes `x / D` for a positive compile-time constant D.
+template<typename T, T D>
+inline T div_const(T x) {
+    static_assert(D > 0, "only positive divisors are supported");
+    using U = typename arithmetic::IntegerTraits<T>::Unsigned;
+
+    if constexpr (!arithmetic::is_signed<T>) {
+        return arithmetic::unsigned_div<U, static_cast<U>(D)>(x);
+    } else {
+        // Signed division truncates towards zero, so dividing the magnitude
+        // and restoring the sign gives the same result as the built-in operator.
+        U magnitude = x < 0 ? static_cast<U>(0 - static_cast<U>(x)) : static_cast<U>(x);
+        U quotient = arithmetic::unsigned_div<U, static_cast<U>(D)>(magnitude);
+        return x < 0 ? static_cast<T>(0 - quotient) : static_cast<T>(quotient);
+    }
+}
+
+/// \brief Computes `x % D` for a positive compile-time constant D.
+template<typename T, T D>
+inline T mod_const(T x) {
+    static_assert(D > 0, "only positive divisors are supported");
+    using U = typename arithmetic::IntegerTraits<T>::Unsigned;
+
+    if constexpr (!arithmetic::is_signed<T> && arithmetic::is_power_of_two(static_cast<U>(D))) {
+        return x & (D - 1);
+    } else {
+        return static_cast<T>(x - div_const<T, D>(x) * D);
+    }
+}
\ No newline at end of file
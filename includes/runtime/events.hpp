@@ -9,34 +9,69 @@
 /// \brief Wrapper structure for managing a series of bit flags.
 /// Bits are stored in groups based on a unsigned integer type
 /// (defaults to an 8-bit uint).
-template<size_t count, typename G = u8>
+///
+/// Besides single bit access, whole groups are tested at once by `any`.
+/// When the offset is known at compile time the template overloads of
+/// `get` and `set` should be preferred as they fold into a single mask operation.
+template<size_t flag_count, typename G = u8>
 struct StatusFlags {
-    static_assert(count > 0);
+    static_assert(flag_count > 0);
 
     using GroupType = G;
 
     static constexpr size_t group_size = sizeof(G) * 8;
-    static constexpr size_t group_count = count / group_size + ((count % group_size) > 0);
+    static constexpr size_t group_count = flag_count / group_size + ((flag_count % group_size) > 0);
 
     G storage[group_count];
 
+    /// \brief The mask selecting the bit of the given offset within its group.
+    static constexpr G bit(size_t offset) {
+        return static_cast<G>(static_cast<G>(1) << (offset % group_size));
+    }
+
     // TODO consider force inlining these
     constexpr G get(size_t offset) const {
-        size_t group = offset / group_size;
-        G in_group_offset = offset % group_size;
-        return storage[group] & (1 << in_group_offset);
+        return storage[offset / group_size] & bit(offset);
     }
 
     constexpr void set(size_t offset, bool state) {
         size_t group = offset / group_size;
-        G in_group_offset = offset % group_size;
 
-        G isolation_mask = ~(1 << in_group_offset);
-        G insert = state ? (1 << in_group_offset) : 0;
+        G isolation_mask = static_cast<G>(~bit(offset));
+        G insert = state ? bit(offset) : 0;
 
         storage[group] = (storage[group] & isolation_mask) | insert;
     }
 
+    template<size_t offset>
+    constexpr G get() const {
+        static_assert(offset < flag_count);
+        return storage[offset / group_size] & bit(offset);
+    }
+
+    template<size_t offset>
+    constexpr void set(bool state) {
+        static_assert(offset < flag_count);
+        if (state)
+            storage[offset / group_size] |= bit(offset);
+        else
+            storage[offset / group_size] &= static_cast<G>(~bit(offset));
+    }
+
+    /// \brief Whether any flag at or after `first` is set.
+    template<size_t first = 0>
+    constexpr bool any() const {
+        static_assert(first <= flag_count);
+        if constexpr (first == flag_count) {
+            return false;
+        } else {
+            constexpr G first_mask = static_cast<G>(static_cast<G>(~static_cast<G>(0)) << (first % group_size));
+            G result = storage[first / group_size] & first_mask;
+            for (size_t group = first / group_size + 1; group < group_count; group++)
+                result |= storage[group];
+            return result != 0;
+        }
+    }
 };
 
 /// \brief Marker type for marking a type as an AsyncFunction.
@@ -59,33 +94,88 @@ template<typename T>
 struct IsAsyncFunctionTest : public std::bool_constant<IsAsyncFunction<T>> {
 };
 
+/// \brief Concept for async handles that are resumed on every pass of the main loop
+/// while `resumes` holds for their state, see `TimeSlicedHandle`.
+template<typename T>
+concept IsResumable = IsAsyncFunction<T> && requires(const typename T::State& state) {
+    T::resumes(state);
+};
+
 /// \brief Empty struct for representing the lack of a predicate.
 struct PredicateLess {};
 
-template<typename Handle, typename Flags, typename States>
+/// \brief Invokes a single handle.
+/// `offset` is the position of the status flag of the handle,
+/// which is only used by async handles.
+template<typename Handle, typename Flags, typename States, size_t offset>
 struct InvokeHandle {
-    static void invoke(size_t&, Flags&, States&) {
+    static void invoke(Flags&, States&) {
         Handle::invoke();
     }
+
+    static void resume(Flags&, States&) {}
 };
 
-template<IsAsyncFunction AsyncHandle, typename Flags, typename States>
-struct InvokeHandle<AsyncHandle, Flags, States> {
-    static void invoke(size_t& i, Flags& flags, States& states) {
+template<IsAsyncFunction AsyncHandle, typename Flags, typename States, size_t offset>
+struct InvokeHandle<AsyncHandle, Flags, States, offset> {
+    static void invoke(Flags& flags, States& states) {
         auto& state = AsyncHandle::get_state(states);
         // If already running
-        if (flags.get(i)) {
+        if (flags.template get<offset>()) {
             auto result = AsyncHandle::step(state);
             if (result)
-                flags.set(i, false);
+                flags.template set<offset>(false);
         } else {
-            flags.set(i, !AsyncHandle::begin_invoke(state));
+            flags.template set<offset>(!AsyncHandle::begin_invoke(state));
+        }
+    }
+
+    /// \brief Steps the handle if it is running and suspended where it resumes without its event.
+    static void resume(Flags& flags, States& states) {
+        if constexpr (IsResumable<AsyncHandle>) {
+            auto& state = AsyncHandle::get_state(states);
+            if (flags.template get<offset>() && AsyncHandle::resumes(state) && AsyncHandle::step(state))
+                flags.template set<offset>(false);
         }
+    }
+};
+
+/// \brief Assigns status flag offsets to the async handles of an event
+/// and invokes the handles in order.
+template<typename Flags, typename States, size_t offset, typename... Handles>
+struct HandleList {
+    static void invoke(Flags&, States&) {}
+
+    static void resume(Flags&, States&) {}
+};
 
-        i += 1;
+template<typename Flags, typename States, size_t offset, typename Handle, typename... Tail>
+struct HandleList<Flags, States, offset, Handle, Tail...> {
+    using Next = HandleList<Flags, States, offset + IsAsyncFunction<Handle>, Tail...>;
+
+    static void invoke(Flags& flags, States& states) {
+        InvokeHandle<Handle, Flags, States, offset>::invoke(flags, states);
+        Next::invoke(flags, states);
+    }
+
+    static void resume(Flags& flags, States& states) {
+        InvokeHandle<Handle, Flags, States, offset>::resume(flags, states);
+        Next::resume(flags, states);
     }
 };
 
+/// \brief The group type of the status flags of an event.
+/// `u8` unless the handle state type declares a `StatusGroup` type.
+template<typename EventState>
+struct StatusGroupOf {
+    using type = u8;
+};
+
+template<typename EventState> requires requires { typename EventState::StatusGroup; }
+struct StatusGroupOf<EventState> {
+    using type = typename EventState::StatusGroup;
+};
+
 template<typename EventState, typename... EventHandles>
 struct Event_ {
     /// \brief Counts the number of async handles passed as type parameters
@@ -100,28 +190,55 @@ struct Event_ {
     }
 
     // One flag for the status of each async handles
-    // + 1 flag for manual emit
-    StatusFlags<count_async_handles() + 1> handle_status {};
+    // + 2 flags for manual emit, the emit seen in this pass and the one pending for the next
+    StatusFlags<count_async_handles() + 2, typename StatusGroupOf<EventState>::type> handle_status {};
     EventState states {};
 
     u8 incomplete_tasks = 0;
     u8 awaiting = 0;
 
+    /// \brief Emits the event, which is observed from the next pass of the main loop on.
     void emit() {
-        handle_status.set(0, true);
+        handle_status.template set<1>(true);
     }
 
+    /// \brief Whether the event was emitted before the current pass of the main loop.
+    /// Stays set for the whole pass, such that every handle and `await` observes the emit.
     [[nodiscard]] decltype(handle_status.get(0)) has_emit_flag() const {
-        return handle_status.get(0);
+        return handle_status.template get<0>();
+    }
+
+    /// \brief Makes the pending emit visible for the coming pass and clears the previous one.
+    void latch_emit() {
+        handle_status.template set<0>(handle_status.template get<1>());
+        handle_status.template set<1>(false);
+    }
+
+    /// \brief Whether any async handle is still running.
+    /// Tests whole flag groups at once, skipping the emit flags.
+    [[nodiscard]] bool has_running_handles() const {
+        return handle_status.template any<2>();
     }
 
+    /// \brief Invokes every handle, starting idle async handles
+    /// and stepping running ones.
     void invoke_handles() {
-        size_t i_status = 1;
-        // This is just a hack to call invoke_handle for each EventHandle given
-        using arrT = int[];
-        static_cast<void>(arrT{(InvokeHandle<EventHandles, decltype(handle_status), decltype(states)>
-                ::invoke(i_status, handle_status, states), 0)...});
+        Handles::invoke(handle_status, states);
+    }
+
+    /// \brief Steps the running handles that resume without their event, such as
+    /// handles suspended in a time sliced loop. A no-op for events without such handles,
+    /// otherwise skipped with a single test of the flag groups while no handle is running.
+    void resume_handles() {
+        if constexpr ((IsResumable<EventHandles> || ...)) {
+            if (has_running_handles())
+                Handles::resume(handle_status, states);
+        }
     }
+
+private:
+    // Flags 0 and 1 are the emit flags, async handles are assigned the following flags
+    using Handles = HandleList<decltype(handle_status), EventState, 2, EventHandles...>;
 };
 
 /// \brief An event defined by its predicate function.
@@ -157,9 +274,43 @@ struct Event<PredicateLess, State, EventHandles...> : Event_<State, EventHandles
 
 
 
+/// \brief Predicate wrapper caching the result of a predicate that only
+/// depends on program state.
+/// Bit `index` of `cache` is set while the cached result is valid,
+/// writes to variables read by the predicate clear it through `invalidate`.
+template<typename Predicate, auto& cache, size_t index>
+struct CachedPredicate {
+    static inline bool result = false;
+
+    static bool invoke() {
+        if (!cache.template get<index>()) {
+            cache.template set<index>(true);
+            result = Predicate::invoke();
+        }
+        return result;
+    }
+};
+
+/// \brief Invalidates the cached results of the predicates with the given indices.
+/// Wraps the assignment expression that causes the invalidation.
+template<size_t... indices, typename Cache, typename T>
+T& invalidate(Cache& cache, T& value) {
+    (cache.template set<indices>(false), ...);
+    return value;
+}
+
+/// \brief Latches the emits of the given events at the start of a pass of the main loop.
+/// Emits made during a pass are observed in the next one.
+template<typename... Events>
+void latch_emits(Events&... events) {
+    (events.latch_emit(), ...);
+}
+
 template<typename Event>
 void run_handles(Event& event) {
     if (event.has_emit_flag() || event.check()) {
         event.invoke_handles();
+    } else {
+        event.resume_handles();
     }
 }
\ No newline at end of file
@@ -12,4 +12,5 @@ void pinMode(uint8_t pin, uint8_t mode);
 void digitalWrite(uint8_t pin, uint8_t val);
 int digitalRead(uint8_t pin);
 int analogRead(uint8_t pin);
-void analogWrite(uint8_t pin, int val);
\ No newline at end of file
+void analogWrite(uint8_t pin, int val);
+unsigned long micros();
\ No newline at end of file
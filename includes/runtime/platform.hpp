@@ -8,6 +8,7 @@
  *  TARGET_AVR      - AVR/Arduino
  *  TARGET_AMD64    - x86_64 platform
  *  TARGET_ARM64    - 64bit arm platform
+ *  TARGET_SIM      - Host simulator with a virtual clock (see runtime/simulator.hpp)
  */
 
 #ifdef TARGET_AVR
@@ -22,6 +23,13 @@
 
 #endif
 
+#ifdef TARGET_SIM
+
+// The simulator provides its own implementation of the arduino api
+#include <runtime/simulator.hpp>
+
+#else
+
 // We include arduino libraries if explicitly told to
 // or if not on AMD64 and not explicitly told not to.
 #if defined(ARDUINO) || (!defined(TARGET_AMD64) && !defined(NO_ARDUINO))
@@ -31,4 +39,10 @@
 
 #if defined(NO_ARDUINO) || (defined(TARGET_AMD64) && !defined(ARDUINO))
 #include <runtime/mock_arduino.hpp>
+#endif
+
+/// \brief Called once per iteration of the main loop.
+/// Only the simulator needs to know about loop iterations.
+inline void loop_tick() {}
+
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <runtime/platform.hpp>
 
@@ -42,6 +43,146 @@ static_assert(sizeof(f32) == 4, "f32 is not 32-bit (wrong compilation target?)")
 using f64 = std::conditional<sizeof(double) == 8, double, long double>::type;
 static_assert(sizeof(f64) == 8, "f64 is not 64-bit (wrong compilation target?)");
 
+// Fixed-point types
+
+/// \brief Signed fixed-point number with `I` integer bits (including the sign)
+/// and `F` fractional bits, i.e. values are stored as `value * 2^F`.
+///
+/// Targets without an FPU (AVR) implement float arithmetic in software,
+/// which costs in the order of hundreds of cycles per operation.
+/// Fixed-point arithmetic only needs integer operations of twice the
+/// width of the storage type. All operations saturate at the limits
+/// of the type rather than wrapping, and multiplication and division
+/// round to the nearest representable value.
+template<u8 I, u8 F>
+struct fixed {
+    static_assert(I + F == 16 || I + F == 32, "fixed-point types must be 16 or 32 bits wide");
+
+    using Storage = typename std::conditional<I + F == 16, i16, i32>::type;
+    using Wide = typename std::conditional<I + F == 16, i32, i64>::type;
+
+    static constexpr u8 integer_bits = I;
+    static constexpr u8 fraction_bits = F;
+    /// \brief The raw representation of 1.
+    static constexpr Storage scale = static_cast<Storage>(static_cast<Wide>(1) << F);
+    static constexpr Storage raw_max = static_cast<Storage>((static_cast<Wide>(1) << (I + F - 1)) - 1);
+    static constexpr Storage raw_min = static_cast<Storage>(-raw_max - 1);
+
+    Storage raw;
+
+    constexpr fixed() : raw(0) {}
+
+    /// \brief Converts an integer or floating point value, saturating if out of range.
+    /// Floating point values are rounded to the nearest representable value.
+    template<typename T>
+    constexpr fixed(T value) : raw(0) { // NOLINT(google-explicit-constructor)
+        // Integral types truncate 0.5 to 0
+        if constexpr (static_cast<T>(0.5) == 0) {
+            // Values are clamped to the integer range first, scaling a larger value could overflow `Wide`
+            constexpr Wide integer_max = raw_max >> F;
+            constexpr Wide integer_min = raw_min >> F;
+            if constexpr (std::is_signed<T>::value) {
+                if (value > integer_max) raw = raw_max;
+                else if (value < integer_min) raw = raw_min;
+                else raw = static_cast<Storage>(static_cast<Wide>(value) * scale);
+            } else {
+                if (static_cast<u64>(value) > static_cast<u64>(integer_max)) raw = raw_max;
+                else raw = static_cast<Storage>(static_cast<Wide>(value) * scale);
+            }
+        } else {
+            auto scaled = value * scale;
+            if (scaled >= raw_max) raw = raw_max;
+            else if (scaled <= raw_min) raw = raw_min;
+            else raw = static_cast<Storage>(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+        }
+    }
+
+    /// \brief Converts between fixed-point formats, rounding and saturating as needed.
+    template<u8 I2, u8 F2>
+    constexpr fixed(fixed<I2, F2> other) : raw(0) { // NOLINT(google-explicit-constructor)
+        if constexpr (F2 > F) {
+            constexpr i64 half = static_cast<i64>(1) << (F2 - F - 1);
+            raw = saturate((static_cast<i64>(other.raw) + half) >> (F2 - F));
+        } else {
+            raw = saturate(static_cast<i64>(other.raw) * (static_cast<i64>(1) << (F - F2)));
+        }
+    }
+
+    static constexpr fixed from_raw(Storage raw) {
+        fixed result;
+        result.raw = raw;
+        return result;
+    }
+
+    /// \brief Converts to an integer (truncating towards zero) or a floating point value.
+    template<typename T>
+    explicit constexpr operator T() const {
+        if constexpr (static_cast<T>(0.5) == 0) {
+            return static_cast<T>(raw / scale);
+        } else {
+            return static_cast<T>(raw) / scale;
+        }
+    }
+
+    template<typename W>
+    static constexpr Storage saturate(W value) {
+        if (value > raw_max) return raw_max;
+        if (value < raw_min) return raw_min;
+        return static_cast<Storage>(value);
+    }
+
+    friend constexpr fixed operator+(fixed a, fixed b) {
+        return from_raw(saturate(static_cast<Wide>(a.raw) + b.raw));
+    }
+
+    friend constexpr fixed operator-(fixed a, fixed b) {
+        return from_raw(saturate(static_cast<Wide>(a.raw) - b.raw));
+    }
+
+    friend constexpr fixed operator*(fixed a, fixed b) {
+        // Adding half before shifting rounds to nearest (ties towards positive infinity)
+        constexpr Wide half = static_cast<Wide>(1) << (F - 1);
+        return from_raw(saturate((static_cast<Wide>(a.raw) * b.raw + half) >> F));
+    }
+
+    friend constexpr fixed operator/(fixed a, fixed b) {
+        if (b.raw == 0)
+            return from_raw(a.raw < 0 ? raw_min : raw_max);
+
+        // Rounds to nearest by offsetting the dividend by half the divisor
+        Wide dividend = static_cast<Wide>(a.raw) * scale;
+        Wide half = (b.raw < 0 ? -static_cast<Wide>(b.raw) : b.raw) / 2;
+        dividend += (dividend < 0) == (b.raw < 0) ? half : -half;
+        return from_raw(saturate(dividend / b.raw));
+    }
+
+    constexpr fixed operator-() const {
+        return from_raw(saturate(-static_cast<Wide>(raw)));
+    }
+
+    constexpr fixed operator+() const {
+        return *this;
+    }
+
+    constexpr fixed& operator+=(fixed other) { return *this = *this + other; }
+    constexpr fixed& operator-=(fixed other) { return *this = *this - other; }
+    constexpr fixed& operator*=(fixed other) { return *this = *this * other; }
+    constexpr fixed& operator/=(fixed other) { return *this = *this / other; }
+
+    friend constexpr bool operator==(fixed a, fixed b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(fixed a, fixed b) { return a.raw != b.raw; }
+    friend constexpr bool operator<(fixed a, fixed b) { return a.raw < b.raw; }
+    friend constexpr bool operator<=(fixed a, fixed b) { return a.raw <= b.raw; }
+    friend constexpr bool operator>(fixed a, fixed b) { return a.raw > b.raw; }
+    friend constexpr bool operator>=(fixed a, fixed b) { return a.raw >= b.raw; }
+};
+
+using q8_8 = fixed<8, 8>;
+using q16_16 = fixed<16, 16>;
+
+static_assert(sizeof(q8_8) == 2);
+static_assert(sizeof(q16_16) == 4);
+
 // Pin types
 
 struct digital {
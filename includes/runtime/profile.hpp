@@ -0,0 +1,167 @@
+#pragma once
+
+#include <runtime/platform.hpp>
+#include <runtime/primitives.hpp>
+#include <runtime/events.hpp>
+
+/*
+ * On-device profiling counters.
+ *
+ * Programs compiled with `--profile` wrap their predicates and handles in
+ * the types below, which count into a fixed size table in RAM. The table is
+ * written to `Serial` in a compact binary form whenever a 'P' is received,
+ * `tools/profile_decode.py` maps the entries back to their source names.
+ *
+ * Dump layout, all fields in the native byte order (little endian on AVR):
+ *  'E' 'P' <version u8> <event count u8> <handle count u8> <bin count u8>
+ *  EventCounters[event count]
+ *  HandleTiming[handle count]
+ *  u32[bin count] loop histogram
+ */
+
+/// \brief Number of bins of the main loop histogram.
+/// Bin `i` counts iterations taking [2^i, 2^(i+1)) microseconds,
+/// the first bin includes 0 and the last bin everything above.
+constexpr size_t loop_histogram_bins = 16;
+
+constexpr u8 profile_version = 1;
+
+struct EventCounters {
+    u32 predicate_evaluations = 0;
+    u32 predicate_true = 0;
+    u32 handle_invocations = 0;
+    u32 async_steps = 0;
+};
+
+/// \brief Execution time of a handle in microseconds.
+/// Async handles are timed per step, as they do not run in one piece.
+struct HandleTiming {
+    u32 invocations = 0;
+    u32 min_us = UINT32_MAX;
+    u32 max_us = 0;
+    u32 total_us = 0;
+
+    void record(u32 us) {
+        invocations++;
+        if (us < min_us)
+            min_us = us;
+        if (us > max_us)
+            max_us = us;
+        total_us += us;
+    }
+};
+
+template<size_t event_count, size_t handle_count>
+struct ProfileTable {
+    static_assert(event_count < 256 && handle_count < 256);
+
+    // Zero sized arrays are not allowed, the extra entry is never dumped
+    EventCounters events[event_count > 0 ? event_count : 1] {};
+    HandleTiming handles[handle_count > 0 ? handle_count : 1] {};
+    u32 loop_histogram[loop_histogram_bins] {};
+
+    unsigned long last_loop_us = 0;
+    bool has_last_loop = false;
+
+    static constexpr u8 profiled_events = event_count;
+    static constexpr u8 profiled_handles = handle_count;
+};
+
+/// \brief Predicate wrapper counting the evaluations and true results
+/// of the predicate of event `event`. Only synchronous predicates are profiled.
+template<typename Predicate, auto& profile, size_t event>
+struct ProfiledPredicate {
+    static bool invoke() {
+        auto& counters = profile.events[event];
+        counters.predicate_evaluations++;
+        bool result = Predicate::invoke();
+        counters.predicate_true += result;
+        return result;
+    }
+};
+
+/// \brief Handle wrapper counting the invocations of the handle
+/// and recording its execution time in entry `handle` of the table.
+template<typename Handle, auto& profile, size_t handle, size_t event>
+struct ProfiledHandle {
+    static void invoke() {
+        profile.events[event].handle_invocations++;
+        auto start = micros();
+        Handle::invoke();
+        profile.handles[handle].record(micros() - start);
+    }
+};
+
+template<IsAsyncFunction Handle, auto& profile, size_t handle, size_t event>
+struct ProfiledHandle<Handle, profile, handle, event> : AsyncFunction {
+    using State = typename Handle::State;
+
+    template<typename S>
+    static State& get_state(S& states) {
+        return Handle::get_state(states);
+    }
+
+    static int begin_invoke(State& state) {
+        profile.events[event].handle_invocations++;
+        auto start = micros();
+        auto result = Handle::begin_invoke(state);
+        profile.handles[handle].record(micros() - start);
+        return result;
+    }
+
+    static int step(State& state) {
+        profile.events[event].async_steps++;
+        auto start = micros();
+        auto result = Handle::step(state);
+        profile.handles[handle].record(micros() - start);
+        return result;
+    }
+};
+
+/// \brief Records the time since the previous iteration of the main loop.
+template<typename Profile>
+void profile_loop(Profile& profile) {
+    auto now = micros();
+    if (profile.has_last_loop) {
+        u32 elapsed = now - profile.last_loop_us;
+        size_t bin = 0;
+        while (elapsed > 1 && bin < loop_histogram_bins - 1) {
+            elapsed >>= 1;
+            bin++;
+        }
+        profile.loop_histogram[bin]++;
+    }
+    profile.last_loop_us = now;
+    profile.has_last_loop = true;
+}
+
+#if defined(USING_ARDUINO) || defined(TARGET_SIM)
+
+/// \brief Writes the profiling table to `Serial`.
+template<typename Profile>
+void profile_dump(Profile& profile) {
+    const u8 header[] = {'E', 'P', profile_version, Profile::profiled_events, Profile::profiled_handles,
+                         loop_histogram_bins};
+    Serial.write(header, sizeof(header));
+    Serial.write(reinterpret_cast<const u8*>(profile.events), sizeof(EventCounters) * Profile::profiled_events);
+    Serial.write(reinterpret_cast<const u8*>(profile.handles), sizeof(HandleTiming) * Profile::profiled_handles);
+    Serial.write(reinterpret_cast<const u8*>(profile.loop_histogram), sizeof(profile.loop_histogram));
+}
+
+/// \brief Dumps the table if a 'P' has been received.
+/// Any other input is left for the program.
+template<typename Profile>
+void profile_poll(Profile& profile) {
+    if (Serial.available() && Serial.peek() == 'P') {
+        Serial.read();
+        profile_dump(profile);
+    }
+}
+
+#else
+
+// Without a serial port the table can only be inspected in a debugger
+template<typename Profile>
+void profile_poll(Profile&) {}
+
+#endif
\ No newline at end of file
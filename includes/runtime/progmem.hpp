@@ -0,0 +1,41 @@
+#pragma once
+
+#include <runtime/platform.hpp>
+
+/*
+ * Constant tables are placed in program memory (flash) on AVR targets
+ * to avoid them being copied into the (much smaller) SRAM on startup.
+ * Data placed in flash has to be read through the pgm_read_* family
+ * of functions, which is what `progmem_read` wraps.
+ *
+ * On any other target flash and data share an address space,
+ * so PROGMEM expands to nothing and reads are plain loads.
+ */
+
+#ifdef TARGET_AVR
+
+#include <avr/pgmspace.h>
+
+template<typename T>
+inline T progmem_read(const T* address) {
+    if constexpr (sizeof(T) == 1) {
+        return static_cast<T>(pgm_read_byte(address));
+    } else {
+        T value;
+        memcpy_P(&value, address, sizeof(T));
+        return value;
+    }
+}
+
+#else
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+template<typename T>
+inline T progmem_read(const T* address) {
+    return *address;
+}
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <runtime/platform.hpp>
+#include <runtime/primitives.hpp>
+#include <runtime/events.hpp>
+
+/*
+ * Per-tick input snapshots.
+ *
+ * When inputs are sampled, every pin read by an event predicate is read
+ * once at the top of the main loop. Predicates and handles then read the
+ * stored value, so all of them observe the same inputs within a tick.
+ */
+
+/// \brief Snapshot of digital pins whose ids are known at compile time.
+/// On arduino targets the input register of each port is read once,
+/// and the value of every pin on that port is extracted from it.
+/// Unlike `digitalRead` this does not turn off PWM on the pins.
+template<uint8_t... pin_ids>
+struct DigitalSnapshot {
+    static constexpr size_t pin_count = sizeof...(pin_ids);
+
+    StatusFlags<pin_count> values {};
+
+    void sample() {
+        static constexpr uint8_t ids[pin_count] = {pin_ids...};
+
+#ifdef USING_ARDUINO
+        // Each pin can at most be on its own port
+        uint8_t ports[pin_count];
+        uint8_t inputs[pin_count];
+        size_t port_count = 0;
+
+        for (size_t i = 0; i < pin_count; i++) {
+            uint8_t port = digitalPinToPort(ids[i]);
+            if (port == NOT_A_PORT) {
+                values.set(i, false);
+                continue;
+            }
+
+            size_t j = 0;
+            while (j < port_count && ports[j] != port)
+                j++;
+            if (j == port_count) {
+                ports[j] = port;
+                inputs[j] = *portInputRegister(port);
+                port_count++;
+            }
+
+            values.set(i, inputs[j] & digitalPinToBitMask(ids[i]));
+        }
+#else
+        for (size_t i = 0; i < pin_count; i++)
+            values.set(i, digitalRead(ids[i]) != 0);
+#endif
+    }
+
+    /// \brief The sampled value of the pin at the given position in `pin_ids`.
+    template<size_t index>
+    int read() const {
+        return values.template get<index>() ? 1 : 0;
+    }
+};
+
+/// \brief Sampled value of a pin whose id may change at runtime, or of an analog pin.
+template<auto& pin>
+struct SampledPin {
+    static inline int value = 0;
+
+    static void sample() {
+        value = pin.read();
+    }
+};
\ No newline at end of file
@@ -0,0 +1,475 @@
+#pragma once
+
+#include <string.h>
+
+#include <runtime/platform.hpp>
+#include <runtime/primitives.hpp>
+
+/*
+ * Non-blocking serial output.
+ *
+ * `Serial.print` blocks until the whole text is in the TX buffer. In async
+ * functions `serial_print` instead yields until the text fits, see
+ * `serial_try_print`. Synchronous code keeps the blocking behaviour unless
+ * compiled with `--serial-overflow drop`, in which case text that does not
+ * fit is dropped and counted.
+ *
+ * The space needed is computed from the text `Print` would produce.
+ * Text longer than the TX buffer is written once the buffer is empty,
+ * which still blocks while the remainder is sent.
+ */
+
+#if defined(USING_ARDUINO) || defined(TARGET_SIM)
+
+#ifdef SERIAL_TX_BUFFER_SIZE
+/// \brief Number of bytes the TX ring buffer can hold, one slot is always kept free.
+constexpr size_t serial_tx_capacity = SERIAL_TX_BUFFER_SIZE - 1;
+#else
+constexpr size_t serial_tx_capacity = 63;
+#endif
+
+namespace serial {
+    /// \brief Number of prints dropped because the TX buffer was full.
+    inline u32 dropped = 0;
+
+    inline size_t digits(unsigned long long value, int base) {
+        if (base < 2)
+            base = 10;
+        size_t count = 1;
+        while (value >= static_cast<unsigned long long>(base)) {
+            value /= base;
+            count++;
+        }
+        return count;
+    }
+}
+
+// Lengths of the text printed by `Print::print` for each type
+
+inline size_t serial_length() { return 0; }
+inline size_t serial_length(const char* str) { return strlen(str); }
+#ifdef USING_ARDUINO
+inline size_t serial_length(const __FlashStringHelper* str) { return strlen_P(reinterpret_cast<PGM_P>(str)); }
+#endif
+inline size_t serial_length(char) { return 1; }
+inline size_t serial_length(bool) { return 1; }
+
+inline size_t serial_length(unsigned long value, int base = 10) {
+    // A base of 0 writes the value as a single byte
+    return base == 0 ? 1 : serial::digits(value, base);
+}
+
+inline size_t serial_length(long value, int base = 10) {
+    if (base == 10 && value < 0)
+        return 1 + serial::digits(0ul - static_cast<unsigned long>(value), base);
+    return serial_length(static_cast<unsigned long>(value), base);
+}
+
+inline size_t serial_length(unsigned long long value, int base = 10) {
+    return base == 0 ? 1 : serial::digits(value, base);
+}
+
+inline size_t serial_length(long long value, int base = 10) {
+    if (base == 10 && value < 0)
+        return 1 + serial::digits(0ull - static_cast<unsigned long long>(value), base);
+    return serial_length(static_cast<unsigned long long>(value), base);
+}
+
+inline size_t serial_length(unsigned char value, int base = 10) { return serial_length(static_cast<unsigned long>(value), base); }
+inline size_t serial_length(int value, int base = 10) { return serial_length(static_cast<long>(value), base); }
+inline size_t serial_length(unsigned int value, int base = 10) { return serial_length(static_cast<unsigned long>(value), base); }
+
+inline size_t serial_length(double value, int digits = 2) {
+    // "nan", "inf" and "ovf" like `Print::printFloat`
+    if (value != value || value > 4294967040.0 || value < -4294967040.0)
+        return 3;
+
+    size_t length = 0;
+    if (value < 0) {
+        length++;
+        value = -value;
+    }
+    length += serial::digits(static_cast<unsigned long>(value), 10);
+    return digits > 0 ? length + 1 + digits : length;
+}
+
+/// \brief Whether `length` bytes can be written without blocking.
+/// Lengths beyond the size of the TX buffer require an empty buffer.
+inline bool serial_writable(size_t length) {
+    if (length > serial_tx_capacity)
+        length = serial_tx_capacity;
+    return static_cast<size_t>(Serial.availableForWrite()) >= length;
+}
+
+/// \brief Prints the value if it fits into the TX buffer.
+/// \returns Whether the value was printed.
+template<typename... Args>
+bool serial_try_print(const Args&... args) {
+    if (!serial_writable(serial_length(args...)))
+        return false;
+    Serial.print(args...);
+    return true;
+}
+
+template<typename... Args>
+bool serial_try_println(const Args&... args) {
+    if (!serial_writable(serial_length(args...) + 2))
+        return false;
+    Serial.println(args...);
+    return true;
+}
+
+/// \brief Prints the value if it fits into the TX buffer, otherwise drops it.
+/// \returns The number of bytes written.
+template<typename... Args>
+size_t serial_print_or_drop(const Args&... args) {
+    if (serial_writable(serial_length(args...)))
+        return Serial.print(args...);
+    serial::dropped++;
+    return 0;
+}
+
+template<typename... Args>
+size_t serial_println_or_drop(const Args&... args) {
+    if (serial_writable(serial_length(args...) + 2))
+        return Serial.println(args...);
+    serial::dropped++;
+    return 0;
+}
+
+inline u32 serial_dropped() {
+    return serial::dropped;
+}
+
+/// \brief `serial_print` outside of async code.
+/// Blocks like `Serial.print`, unless `EEL_SERIAL_DROP` is defined.
+template<typename... Args>
+size_t serial_print(const Args&... args) {
+#ifdef EEL_SERIAL_DROP
+    return serial_print_or_drop(args...);
+#else
+    return Serial.print(args...);
+#endif
+}
+
+template<typename... Args>
+size_t serial_println(const Args&... args) {
+#ifdef EEL_SERIAL_DROP
+    return serial_println_or_drop(args...);
+#else
+    return Serial.println(args...);
+#endif
+}
+
+/*
+ * Coalesced prints.
+ *
+ * Codegen merges runs of adjacent `serial_print`/`serial_println` calls into
+ * one `serial_print_all`, whose constant text is wrapped in `EEL_FLASH` to
+ * keep it out of SRAM. On arduino the fragments are collected in a small
+ * buffer and handed to `Serial` in a single write.
+ */
+
+#ifdef USING_ARDUINO
+#define EEL_FLASH(text) F(text)
+#else
+#define EEL_FLASH(text) (text)
+#endif
+
+namespace serial {
+    template<typename... Args>
+    size_t total_length(const Args&... args) {
+        return (serial_length(args) + ... + 0);
+    }
+
+#ifdef USING_ARDUINO
+    constexpr size_t batch_size = serial_tx_capacity < 64 ? serial_tx_capacity : 64;
+
+    /// \brief Collects printed text, writing it to `Serial` whenever the buffer is full.
+    class Batch : public Print {
+    public:
+        size_t write(uint8_t c) override {
+            if (length == batch_size)
+                send();
+            data[length++] = c;
+            return 1;
+        }
+
+        size_t write(const uint8_t* buffer, size_t size) override {
+            for (auto remaining = size; remaining > 0;) {
+                if (length == batch_size)
+                    send();
+                auto chunk = batch_size - length < remaining ? batch_size - length : remaining;
+                memcpy(data + length, buffer, chunk);
+                length += chunk;
+                buffer += chunk;
+                remaining -= chunk;
+            }
+            return size;
+        }
+
+        void send() {
+            Serial.write(data, length);
+            length = 0;
+        }
+
+    private:
+        uint8_t data[batch_size];
+        size_t length = 0;
+    };
+
+    template<typename... Args>
+    size_t write_all(const Args&... args) {
+        Batch batch;
+        size_t n = 0;
+        ((n += batch.print(args)), ...);
+        batch.send();
+        return n;
+    }
+#else
+    template<typename... Args>
+    size_t write_all(const Args&... args) {
+        size_t n = 0;
+        ((n += Serial.print(args)), ...);
+        return n;
+    }
+#endif
+}
+
+/// \brief Prints each argument in order, blocking like `serial_print`
+/// or dropping the whole text if compiled with `EEL_SERIAL_DROP`.
+template<typename... Args>
+size_t serial_print_all(const Args&... args) {
+#ifdef EEL_SERIAL_DROP
+    if (!serial_writable(serial::total_length(args...))) {
+        serial::dropped++;
+        return 0;
+    }
+#endif
+    return serial::write_all(args...);
+}
+
+/// \brief Prints each argument in order if the whole text fits into the TX buffer.
+/// \returns Whether the text was printed.
+template<typename... Args>
+bool serial_try_print_all(const Args&... args) {
+    if (!serial_writable(serial::total_length(args...)))
+        return false;
+    serial::write_all(args...);
+    return true;
+}
+
+/*
+ * Serial input as an event source.
+ *
+ * The built-in events `serial_data` and `serial_line` are polled through
+ * `serial_poll_data` and `serial_poll_line`. Instead of copying received bytes
+ * their handles get a view of the RX ring buffer, read with `serial_view_at`.
+ * The view stays valid until the event is polled again, at which point its
+ * bytes are released to the UART. As both events share the view, the compiler
+ * rejects programs that use both of them.
+ *
+ * Numbers are parsed incrementally from the view with `serial_has_number`,
+ * replacing the blocking `Stream::parseInt`/`parseFloat`. With `serial_data`
+ * a number split across two chunks of data continues where it left off,
+ * with `serial_line` the end of the line terminates it.
+ */
+
+#ifndef EEL_SERIAL_DELIMITER
+#define EEL_SERIAL_DELIMITER '\n'
+#endif
+
+#ifdef SERIAL_RX_BUFFER_SIZE
+constexpr size_t serial_rx_size = SERIAL_RX_BUFFER_SIZE;
+#else
+constexpr size_t serial_rx_size = 64;
+#endif
+
+namespace serial {
+    /// \brief Parses an optionally signed decimal number with a fraction, one character at a time.
+    struct NumberParser {
+        bool active = false;
+        bool negative = false;
+        bool has_digits = false;
+        bool in_fraction = false;
+        /// \brief Whether a number has been parsed and not yet taken.
+        bool complete = false;
+        u32 integer = 0;
+        f32 fraction = 0;
+        f32 scale = 1;
+
+        /// \returns Whether the character terminated a number.
+        bool feed(char c) {
+            if (c >= '0' && c <= '9') {
+                if (!active)
+                    start(false);
+                has_digits = true;
+                if (in_fraction) {
+                    scale *= 0.1f;
+                    fraction += static_cast<f32>(c - '0') * scale;
+                } else {
+                    integer = integer * 10 + static_cast<u32>(c - '0');
+                }
+                return false;
+            }
+
+            if (!active && (c == '-' || c == '.')) {
+                start(c == '-');
+                in_fraction = c == '.';
+                return false;
+            }
+
+            if (active && c == '.' && !in_fraction) {
+                in_fraction = true;
+                return false;
+            }
+
+            return finish();
+        }
+
+        /// \brief Terminates the number being parsed.
+        /// \returns Whether a number was completed, a lone sign or point is discarded.
+        bool finish() {
+            if (!active)
+                return false;
+            active = false;
+            complete = has_digits;
+            return complete;
+        }
+
+        [[nodiscard]] i32 int_value() const {
+            auto value = static_cast<i32>(integer);
+            return negative ? -value : value;
+        }
+
+        [[nodiscard]] f32 float_value() const {
+            auto value = static_cast<f32>(integer) + fraction;
+            return negative ? -value : value;
+        }
+
+    private:
+        void start(bool is_negative) {
+            *this = {};
+            active = true;
+            negative = is_negative;
+        }
+    };
+
+    /// \brief The view handed to the handles of `serial_data` and `serial_line`.
+    struct Receiver {
+        /// \brief Bytes in the view, starting at the tail of the RX buffer.
+        u16 length = 0;
+        /// \brief Bytes released on the next poll, which includes the delimiter of a line.
+        u16 pending = 0;
+        /// \brief Bytes of an incomplete line that have already been searched for the delimiter.
+        u16 scanned = 0;
+        /// \brief Position of the number parser in the view.
+        u16 cursor = 0;
+        bool is_line = false;
+        NumberParser number;
+    };
+
+    inline Receiver receiver;
+
+    inline u8 at(size_t index) {
+        return Serial.rxBuffer()[(Serial.rxTail() + index) % serial_rx_size];
+    }
+
+    inline void release() {
+        Serial.rxConsume(receiver.pending);
+        // A number does not continue past the end of a line, even if it was not parsed to the end
+        if (receiver.is_line)
+            receiver.number = {};
+        receiver.length = 0;
+        receiver.pending = 0;
+        receiver.cursor = 0;
+    }
+}
+
+/// \brief Predicate of the `serial_data` event, occurs whenever bytes have been received.
+inline bool serial_poll_data() {
+    auto& receiver = serial::receiver;
+    serial::release();
+
+    auto available = static_cast<u16>(Serial.available());
+    if (available == 0)
+        return false;
+
+    receiver.length = receiver.pending = available;
+    receiver.is_line = false;
+    return true;
+}
+
+/// \brief Predicate of the `serial_line` event, occurs once a line terminated by
+/// `EEL_SERIAL_DELIMITER` has been received. A trailing carriage return is not part of the line.
+/// A line that does not fit into the RX buffer is handed out in pieces.
+inline bool serial_poll_line() {
+    auto& receiver = serial::receiver;
+    serial::release();
+
+    // Only bytes received since the last poll have to be searched
+    auto available = static_cast<u16>(Serial.available());
+    while (receiver.scanned < available) {
+        if (serial::at(receiver.scanned++) != EEL_SERIAL_DELIMITER)
+            continue;
+
+        receiver.pending = receiver.scanned;
+        receiver.length = receiver.scanned - 1;
+        if (receiver.length > 0 && serial::at(receiver.length - 1) == '\r')
+            receiver.length--;
+        receiver.scanned = 0;
+        receiver.is_line = true;
+        return true;
+    }
+
+    if (available < serial_rx_size - 1)
+        return false;
+
+    receiver.length = receiver.pending = available;
+    receiver.scanned = 0;
+    receiver.is_line = true;
+    return true;
+}
+
+inline usize serial_view_length() {
+    return serial::receiver.length;
+}
+
+/// \returns The byte at `index` of the view, or 0 if out of bounds.
+inline u8 serial_view_at(usize index) {
+    return index < serial::receiver.length ? serial::at(index) : 0;
+}
+
+/// \brief Whether a number can be taken from the view with `serial_next_int` or `serial_next_float`.
+/// Never blocks, characters between numbers are skipped.
+inline bool serial_has_number() {
+    auto& receiver = serial::receiver;
+    auto& number = receiver.number;
+    if (number.complete)
+        return true;
+
+    while (receiver.cursor < receiver.length) {
+        if (number.feed(static_cast<char>(serial::at(receiver.cursor++))))
+            return true;
+    }
+
+    return receiver.is_line && number.finish();
+}
+
+/// \brief Takes the next number of the view, truncating any fraction.
+/// \returns The number, or 0 if no complete number is available.
+inline i32 serial_next_int() {
+    if (!serial_has_number())
+        return 0;
+    serial::receiver.number.complete = false;
+    return serial::receiver.number.int_value();
+}
+
+inline f32 serial_next_float() {
+    if (!serial_has_number())
+        return 0;
+    serial::receiver.number.complete = false;
+    return serial::receiver.number.float_value();
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,395 @@
+#pragma once
+
+/*
+ * Host simulator backend (TARGET_SIM).
+ *
+ * Implements the parts of the arduino api used by generated programs
+ * on top of a virtual clock, such that programs can be compiled with the
+ * host compiler and run for hours of simulated time in seconds.
+ *
+ * Time only advances when the main loop completes an iteration (see `loop_tick`)
+ * or when the program calls `delay`/`delayMicroseconds`. Each iteration of the
+ * main loop is assumed to take `EEL_SIM_TICK_US` microseconds.
+ *
+ * The simulator is configured through the following environment variables:
+ *  EEL_SIM_TICK_US     - Simulated duration of a main loop iteration (default: 10)
+ *  EEL_SIM_DURATION_MS - Stops the program after the given simulated time (default: run forever)
+ *  EEL_SIM_SERIAL_OUT  - File receiving serial output (default: stdout)
+ *  EEL_SIM_SERIAL_IN   - File providing serial input
+ *  EEL_SIM_INPUTS      - File with timed pin changes, one `<time ms> <pin> <value>` per line
+ *  EEL_SIM_PIN_LOG     - File receiving every pin write as `<time us> <pin> <value>`
+ *  EEL_SIM_TRACE       - File receiving the trace records of programs compiled with `--trace`
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <arduino/print_format.h>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#ifndef SERIAL_TX_BUFFER_SIZE
+#define SERIAL_TX_BUFFER_SIZE 64
+#endif
+#ifndef SERIAL_RX_BUFFER_SIZE
+#define SERIAL_RX_BUFFER_SIZE 64
+#endif
+
+namespace sim {
+
+    struct PinChange {
+        uint64_t time_us;
+        uint8_t pin;
+        int value;
+    };
+
+    struct Simulator {
+        static constexpr size_t pin_count = 64;
+
+        uint64_t now_us = 0;
+        uint64_t tick_us = 10;
+        /// \brief Simulated time at which the program stops, 0 if it runs forever.
+        uint64_t end_us = 0;
+        uint64_t ticks = 0;
+
+        uint8_t modes[pin_count] {};
+        /// \brief Digital level or analog value of each pin, depending on how it is used.
+        int values[pin_count] {};
+
+        /// \brief Scheduled input changes, sorted by time.
+        std::vector<PinChange> inputs;
+        size_t next_input = 0;
+
+        FILE* serial_out = stdout;
+        FILE* serial_in = nullptr;
+        FILE* pin_log = nullptr;
+        FILE* trace_out = nullptr;
+        /// \brief If set serial output is appended to `serial_buffer` instead of written to `serial_out`.
+        bool capture_serial = false;
+        std::string serial_buffer;
+        /// \brief Free space reported for the TX buffer, which is never filled by the simulator itself.
+        int serial_tx_space = SERIAL_TX_BUFFER_SIZE - 1;
+
+        Simulator() {
+            if (auto tick = getenv("EEL_SIM_TICK_US"))
+                tick_us = strtoull(tick, nullptr, 10);
+            if (auto duration = getenv("EEL_SIM_DURATION_MS"))
+                end_us = strtoull(duration, nullptr, 10) * 1000;
+            if (auto path = getenv("EEL_SIM_SERIAL_OUT"))
+                serial_out = open(path, "w");
+            if (auto path = getenv("EEL_SIM_SERIAL_IN"))
+                serial_in = open(path, "r");
+            if (auto path = getenv("EEL_SIM_PIN_LOG"))
+                pin_log = open(path, "w");
+            if (auto path = getenv("EEL_SIM_TRACE"))
+                trace_out = open(path, "wb");
+            if (auto path = getenv("EEL_SIM_INPUTS"))
+                load_inputs(path);
+        }
+
+        ~Simulator() {
+            flush();
+        }
+
+        static FILE* open(const char* path, const char* mode) {
+            auto file = fopen(path, mode);
+            if (file == nullptr) {
+                fprintf(stderr, "simulator: could not open `%s`\n", path);
+                exit(EXIT_FAILURE);
+            }
+            return file;
+        }
+
+        void load_inputs(const char* path) {
+            auto file = open(path, "r");
+            unsigned long long time_ms;
+            unsigned pin;
+            int value;
+            while (fscanf(file, "%llu %u %d", &time_ms, &pin, &value) == 3) {
+                if (pin < pin_count)
+                    inputs.push_back({time_ms * 1000, static_cast<uint8_t>(pin), value});
+            }
+            fclose(file);
+
+            std::stable_sort(inputs.begin(), inputs.end(), [](const PinChange& a, const PinChange& b) {
+                return a.time_us < b.time_us;
+            });
+            apply_inputs();
+        }
+
+        /// \brief Applies the scheduled input changes that are due.
+        void apply_inputs() {
+            while (next_input < inputs.size() && inputs[next_input].time_us <= now_us) {
+                values[inputs[next_input].pin] = inputs[next_input].value;
+                next_input++;
+            }
+        }
+
+        void advance(uint64_t us) {
+            now_us += us;
+            apply_inputs();
+
+            if (end_us != 0 && now_us >= end_us) {
+                flush();
+                exit(EXIT_SUCCESS);
+            }
+        }
+
+        void write_pin(uint8_t pin, int value) {
+            if (pin >= pin_count)
+                return;
+            values[pin] = value;
+            if (pin_log != nullptr)
+                fprintf(pin_log, "%llu %u %d\n", static_cast<unsigned long long>(now_us), pin, value);
+        }
+
+        int read_pin(uint8_t pin) const {
+            if (pin >= pin_count)
+                return 0;
+            return values[pin];
+        }
+
+        void write_serial(const char* data, size_t length) {
+            if (capture_serial)
+                serial_buffer.append(data, length);
+            else
+                fwrite(data, 1, length, serial_out);
+        }
+
+        void flush() {
+            if (serial_out != nullptr)
+                fflush(serial_out);
+            if (pin_log != nullptr)
+                fflush(pin_log);
+            if (trace_out != nullptr)
+                fflush(trace_out);
+        }
+    };
+
+    inline Simulator& simulator() {
+        static Simulator instance;
+        return instance;
+    }
+
+    /// \brief Captured replacement for the arduino `HardwareSerial`.
+    struct SerialPort {
+        void begin(unsigned long) {}
+
+        void end() {}
+
+        int available() {
+            receive_input();
+            return static_cast<int>((SERIAL_RX_BUFFER_SIZE + rx_head - rx_tail) % SERIAL_RX_BUFFER_SIZE);
+        }
+
+        int read() {
+            auto c = peek();
+            if (c != -1)
+                rxConsume(1);
+            return c;
+        }
+
+        int peek() {
+            receive_input();
+            return rx_head == rx_tail ? -1 : rx_buffer[rx_tail];
+        }
+
+        /// \brief Places the bytes into the RX buffer as if they had been received.
+        /// Like the UART interrupt handler bytes that do not fit are lost.
+        void receive(const char* data) {
+            for (; *data != '\0'; data++)
+                receive_byte(static_cast<unsigned char>(*data));
+        }
+
+        // Direct access to the RX ring buffer, like the patched `HardwareSerial`
+        const unsigned char* rxBuffer() const { return rx_buffer; }
+        uint16_t rxTail() const { return rx_tail; }
+        void rxConsume(uint16_t count) {
+            rx_tail = static_cast<uint16_t>((rx_tail + count) % SERIAL_RX_BUFFER_SIZE);
+        }
+
+        void flush() {
+            simulator().flush();
+        }
+
+        int availableForWrite() {
+            return simulator().serial_tx_space;
+        }
+
+        size_t write(uint8_t c) {
+            auto ch = static_cast<char>(c);
+            simulator().write_serial(&ch, 1);
+            return 1;
+        }
+
+        size_t write(const char* str) {
+            auto length = strlen(str);
+            simulator().write_serial(str, length);
+            return length;
+        }
+
+        size_t write(const uint8_t* buffer, size_t length) {
+            simulator().write_serial(reinterpret_cast<const char*>(buffer), length);
+            return length;
+        }
+
+        size_t print(const char* str) { return write(str); }
+        size_t print(const std::string& str) {
+            simulator().write_serial(str.data(), str.size());
+            return str.size();
+        }
+        size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+        size_t print(bool b) { return print_number(b, DEC); }
+        size_t print(unsigned char n, int base = DEC) { return print_number(n, base); }
+        size_t print(int n, int base = DEC) { return print_signed(n, base); }
+        size_t print(unsigned int n, int base = DEC) { return print_number(n, base); }
+        size_t print(long n, int base = DEC) { return print_signed(n, base); }
+        size_t print(unsigned long n, int base = DEC) { return print_number(n, base); }
+        size_t print(long long n, int base = DEC) { return print_signed(n, base); }
+        size_t print(unsigned long long n, int base = DEC) { return print_number(n, base); }
+        size_t print(double n, int digits = 2) { return print_float(n, digits); }
+
+        size_t println() { return write("\r\n"); }
+
+        template<typename T>
+        size_t println(const T& value) {
+            auto n = print(value);
+            return n + println();
+        }
+
+        template<typename T>
+        size_t println(const T& value, int format) {
+            auto n = print(value, format);
+            return n + println();
+        }
+
+    private:
+        unsigned char rx_buffer[SERIAL_RX_BUFFER_SIZE] {};
+        uint16_t rx_head = 0;
+        uint16_t rx_tail = 0;
+
+        bool receive_byte(unsigned char c) {
+            auto next = static_cast<uint16_t>((rx_head + 1) % SERIAL_RX_BUFFER_SIZE);
+            if (next == rx_tail)
+                return false;
+            rx_buffer[rx_head] = c;
+            rx_head = next;
+            return true;
+        }
+
+        /// \brief Moves input from `EEL_SIM_SERIAL_IN` into the RX buffer while it has space.
+        void receive_input() {
+            auto in = simulator().serial_in;
+            if (in == nullptr)
+                return;
+            int c;
+            while ((rx_head + 1) % SERIAL_RX_BUFFER_SIZE != rx_tail && (c = fgetc(in)) != EOF)
+                receive_byte(static_cast<unsigned char>(c));
+        }
+
+        size_t print_signed(long long n, int base) {
+            // Like arduino only decimal numbers are printed with a sign
+            if (base == DEC && n < 0)
+                return write('-') + print_number(0ull - static_cast<unsigned long long>(n), base);
+            return print_number(static_cast<unsigned long long>(n), base);
+        }
+
+        size_t print_number(unsigned long long n, int base) {
+            if (base < 2)
+                base = DEC;
+            char buffer[65];
+            char* str = &buffer[sizeof(buffer) - 1];
+            *str = '\0';
+            do {
+                auto digit = static_cast<char>(n % base);
+                n /= base;
+                *--str = static_cast<char>(digit < 10 ? digit + '0' : digit + 'A' - 10);
+            } while (n);
+            return write(str);
+        }
+
+        size_t print_float(double n, int digits) {
+            // Formatted like the AVR `Print`, where doubles are 32-bit floats
+            if (digits >= 0 && digits <= print_format::max_fixed_digits) {
+                char buffer[print_format::fixed_length(print_format::max_fixed_digits)];
+                auto length = print_format::format_fixed(buffer, static_cast<float>(n), static_cast<uint8_t>(digits));
+                simulator().write_serial(buffer, length);
+                return length;
+            }
+
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+            return write(buffer);
+        }
+    };
+
+}
+
+inline sim::SerialPort Serial;
+
+/// \brief Advances the virtual clock by one iteration of the main loop.
+inline void loop_tick() {
+    auto& simulator = sim::simulator();
+    simulator.ticks++;
+    simulator.advance(simulator.tick_us);
+}
+
+// Both wrap at 32 bits like `unsigned long` on the device, such that programs meet the rollover on the host
+
+inline uint32_t micros() {
+    return static_cast<uint32_t>(sim::simulator().now_us);
+}
+
+inline uint32_t millis() {
+    return static_cast<uint32_t>(sim::simulator().now_us / 1000);
+}
+
+inline void delay(unsigned long ms) {
+    sim::simulator().advance(static_cast<uint64_t>(ms) * 1000);
+}
+
+inline void delayMicroseconds(unsigned int us) {
+    sim::simulator().advance(us);
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+    auto& simulator = sim::simulator();
+    if (pin >= sim::Simulator::pin_count)
+        return;
+    simulator.modes[pin] = mode;
+    // Pull-ups read high until driven low by an input change
+    if (mode == INPUT_PULLUP)
+        simulator.values[pin] = HIGH;
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t val) {
+    sim::simulator().write_pin(pin, val == LOW ? LOW : HIGH);
+}
+
+inline int digitalRead(uint8_t pin) {
+    return sim::simulator().read_pin(pin) == LOW ? LOW : HIGH;
+}
+
+inline int analogRead(uint8_t pin) {
+    return std::clamp(sim::simulator().read_pin(pin), 0, 1023);
+}
+
+inline void analogWrite(uint8_t pin, int val) {
+    sim::simulator().write_pin(pin, std::clamp(val, 0, 255));
+}
\ No newline at end of file
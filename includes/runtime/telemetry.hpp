@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string.h>
+
+#include <runtime/platform.hpp>
+#include <runtime/primitives.hpp>
+#include <runtime/serial.hpp>
+
+/*
+ * Binary telemetry.
+ *
+ * `emit_telemetry(a, b, ...)` sends its values as one frame instead of text.
+ * Each call site is a message with an id, whose field types are written to
+ * the <file>.telemetry.json schema by eelc (see tools/telemetry_decode.py).
+ *
+ * A frame holds the message id, the values in little endian order and an
+ * xor checksum of both, encoded with COBS and terminated by a zero byte.
+ * COBS replaces all zero bytes of the payload, so a decoder finds the start of
+ * the next frame after any corrupted or interleaved text by the delimiter.
+ */
+
+#if defined(USING_ARDUINO) || defined(TARGET_SIM)
+
+namespace telemetry {
+    /// \brief Bytes of a COBS encoded frame holding `payload` bytes, including the delimiter.
+    constexpr size_t frame_size(size_t payload) {
+        return payload + payload / 254 + 2;
+    }
+
+    /// \brief Encodes a frame while bytes are appended, without buffering the payload.
+    template<size_t payload_capacity>
+    struct Encoder {
+        u8 data[frame_size(payload_capacity + 1)];
+        /// \brief Position of the code byte of the current block.
+        size_t code_index = 0;
+        size_t length = 1;
+        u8 code = 1;
+        u8 checksum = 0;
+
+        void put(u8 byte) {
+            checksum ^= byte;
+            put_encoded(byte);
+        }
+
+        template<typename T>
+        void put_value(const T& value) {
+            // AVR and the hosts running the simulator are little endian
+            u8 bytes[sizeof(T)];
+            memcpy(bytes, &value, sizeof(T));
+            for (auto byte: bytes)
+                put(byte);
+        }
+
+        /// \brief Appends the checksum and the delimiter.
+        /// \returns The length of the frame.
+        size_t finish() {
+            put_encoded(checksum);
+            data[code_index] = code;
+            data[length++] = 0;
+            return length;
+        }
+
+    private:
+        void put_encoded(u8 byte) {
+            if (byte != 0) {
+                data[length++] = byte;
+                code++;
+            }
+
+            // Blocks end at a zero or after 254 non-zero bytes
+            if (byte == 0 || code == 0xFF) {
+                data[code_index] = code;
+                code_index = length++;
+                code = 1;
+            }
+        }
+    };
+
+    template<typename... Args>
+    using EncoderFor = Encoder<1 + (sizeof(Args) + ... + 0)>;
+
+    template<typename... Args>
+    void encode(EncoderFor<Args...>& encoder, u8 id, const Args&... values) {
+        encoder.put(id);
+        (encoder.put_value(values), ...);
+    }
+}
+
+/// \brief Sends a telemetry frame, blocking like `serial_print`
+/// or dropping the frame if compiled with `EEL_SERIAL_DROP`.
+template<typename... Args>
+size_t telemetry_emit(u8 id, const Args&... values) {
+    telemetry::EncoderFor<Args...> encoder;
+    telemetry::encode(encoder, id, values...);
+    auto length = encoder.finish();
+
+#ifdef EEL_SERIAL_DROP
+    if (!serial_writable(length)) {
+        serial::dropped++;
+        return 0;
+    }
+#endif
+    return Serial.write(encoder.data, length);
+}
+
+/// \brief Sends a telemetry frame if it fits into the TX buffer.
+/// \returns Whether the frame was sent.
+template<typename... Args>
+bool telemetry_try_emit(u8 id, const Args&... values) {
+    telemetry::EncoderFor<Args...> encoder;
+    telemetry::encode(encoder, id, values...);
+    auto length = encoder.finish();
+
+    if (!serial_writable(length))
+        return false;
+    Serial.write(encoder.data, length);
+    return true;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <runtime/platform.hpp>
+#include <runtime/primitives.hpp>
+#include <runtime/events.hpp>
+
+/*
+ * Cooperative time slicing.
+ *
+ * Loops compiled with time slicing yield to the scheduler once the
+ * time spent in the current turn of the main loop exceeds the budget,
+ * and resume on the next turn. Each loop still completes at least one
+ * iteration per turn.
+ *
+ * Handles containing sliced loops are wrapped in `TimeSlicedHandle`,
+ * such that a handle suspended by its time slice is stepped on the next
+ * turn even if its event does not occur again.
+ */
+
+/// \brief Time budget of a turn of the main loop in microseconds.
+#ifndef EEL_TIME_SLICE_US
+#define EEL_TIME_SLICE_US 1000
+#endif
+
+namespace time_slice {
+    inline u32 turn_start = 0;
+}
+
+/// \brief Starts the time slice of a new turn of the main loop.
+inline void begin_time_slice() {
+    time_slice::turn_start = micros();
+}
+
+/// \brief Whether the budget of the current turn has been used up.
+/// Unsigned 32-bit subtraction keeps this correct when `micros` overflows.
+inline bool time_slice_expired() {
+    return static_cast<u32>(micros() - time_slice::turn_start) >= EEL_TIME_SLICE_US;
+}
+
+/// \brief Handle wrapper for async handles containing sliced loops.
+/// `cases` are the states of the handle at which a sliced loop resumes, a handle
+/// suspended in one of them is resumed by `run_handles` whether its event occurs or not.
+template<IsAsyncFunction Handle, u8... cases>
+struct TimeSlicedHandle : Handle {
+    static bool resumes(const typename Handle::State& state) {
+        return ((state.s == cases) || ...);
+    }
+};
\ No newline at end of file
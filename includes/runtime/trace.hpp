@@ -0,0 +1,227 @@
+#pragma once
+
+#include <runtime/platform.hpp>
+#include <runtime/primitives.hpp>
+#include <runtime/events.hpp>
+
+/*
+ * Event tracing.
+ *
+ * Programs compiled with `--trace` record when each handle begins, ends,
+ * yields and resumes into a circular buffer in SRAM, keeping the most recent
+ * `EEL_TRACE_CAPACITY` records. The buffer is written to `Serial` whenever a
+ * 'T' is received. In the simulator every record is also streamed to the
+ * file given by `EEL_SIM_TRACE`. `tools/trace_to_chrome.py` converts both
+ * to the chrome `trace_event` format.
+ *
+ * Trace layout, all fields in the native byte order (little endian on AVR):
+ *  'E' 'T' <version u8> <record count u16> <base time us u32>
+ *  TraceRecord[record count]
+ * Streamed traces have a record count of 0xFFFF and end with the file.
+ */
+
+/// \brief Number of records kept in the trace buffer.
+#ifndef EEL_TRACE_CAPACITY
+#define EEL_TRACE_CAPACITY 64
+#endif
+
+constexpr u8 trace_version = 2;
+
+enum class TraceKind : u8 {
+    Begin = 0,
+    End = 1,
+    Yield = 2,
+    Resume = 3,
+};
+
+/// \brief A single trace record.
+/// The time is stored relative to the previous record. When the time since
+/// the previous record does not fit into 16 bits, the record is preceded by
+/// a single record of the event `trace_gap_event` holding the upper bits,
+/// bits 16 to 31 in `delta_us` and bits 32 to 39 in `info`.
+struct TraceRecord {
+    u16 delta_us;
+    u8 event;
+    /// \brief The kind in the upper two bits, the index of the handle within its event in the lower six.
+    u8 info;
+};
+
+static_assert(sizeof(TraceRecord) == 4);
+
+constexpr u8 trace_gap_event = 0xFF;
+constexpr u16 trace_max_delta = 0xFFFF;
+
+/// \brief The time covered by a record in microseconds.
+constexpr u64 trace_record_us(const TraceRecord& record) {
+    if (record.event == trace_gap_event)
+        return static_cast<u64>(record.info) << 32 | static_cast<u64>(record.delta_us) << 16;
+    return record.delta_us;
+}
+
+/// \brief The gap record carrying the upper bits of `delta_us`, which has to be less than 2^40.
+constexpr TraceRecord trace_gap(u64 delta_us) {
+    return {static_cast<u16>(delta_us >> 16), trace_gap_event, static_cast<u8>(delta_us >> 32)};
+}
+
+#ifdef TARGET_SIM
+
+namespace trace {
+    /// \brief Time of the last record streamed to the simulator trace file.
+    inline u64 streamed_us = 0;
+    inline bool has_stream_header = false;
+
+    inline void stream(u64 now, u8 event, u8 info) {
+        auto file = sim::simulator().trace_out;
+        if (file == nullptr)
+            return;
+
+        if (!has_stream_header) {
+            const u8 header[] = {'E', 'T', trace_version, 0xFF, 0xFF, 0, 0, 0, 0};
+            fwrite(header, 1, sizeof(header), file);
+            has_stream_header = true;
+        }
+
+        auto delta = now - streamed_us;
+        // Only gaps of more than 12 days need several gap records
+        constexpr u64 max_gap_us = trace_record_us(trace_gap(~u64(0)));
+        for (; delta >> 40 != 0; delta -= max_gap_us) {
+            auto gap = trace_gap(max_gap_us);
+            fwrite(&gap, sizeof(gap), 1, file);
+        }
+        if (delta > trace_max_delta) {
+            auto gap = trace_gap(delta);
+            fwrite(&gap, sizeof(gap), 1, file);
+        }
+        TraceRecord record {static_cast<u16>(delta), event, info};
+        fwrite(&record, sizeof(record), 1, file);
+        streamed_us = now;
+    }
+}
+
+#endif
+
+template<size_t capacity>
+struct TraceBuffer {
+    static_assert(capacity > 0 && capacity < 0xFFFF);
+
+    static constexpr size_t size = capacity;
+
+    TraceRecord records[capacity] {};
+    /// \brief Position of the next record, which is the oldest record once the buffer is full.
+    u16 head = 0;
+    u16 count = 0;
+    /// \brief Time before the oldest record.
+    u32 base_us = 0;
+    unsigned long last_us = 0;
+
+    void record(TraceKind kind, u8 event, u8 handle) {
+        auto now = micros();
+        if (count == 0) {
+            base_us = now;
+            last_us = now;
+        }
+
+        auto info = static_cast<u8>(static_cast<u8>(kind) << 6 | handle);
+        u32 delta = now - last_us;
+        if (delta > trace_max_delta)
+            push(trace_gap(delta));
+        push({static_cast<u16>(delta), event, info});
+        last_us = now;
+
+#ifdef TARGET_SIM
+        trace::stream(sim::simulator().now_us, event, info);
+#endif
+    }
+
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+
+private:
+    void push(TraceRecord record) {
+        if (count == capacity)
+            base_us += static_cast<u32>(trace_record_us(records[head]));
+        else
+            count++;
+
+        records[head] = record;
+        if (++head == capacity)
+            head = 0;
+    }
+};
+
+/// \brief Handle wrapper recording the execution of a handle,
+/// `handle` is the index of the handle within event `event`.
+template<typename Handle, auto& trace, u8 event, u8 handle>
+struct TracedHandle {
+    static_assert(event != trace_gap_event && handle < 64);
+
+    static void invoke() {
+        trace.record(TraceKind::Begin, event, handle);
+        Handle::invoke();
+        trace.record(TraceKind::End, event, handle);
+    }
+};
+
+template<IsAsyncFunction Handle, auto& trace, u8 event, u8 handle>
+struct TracedHandle<Handle, trace, event, handle> : AsyncFunction {
+    static_assert(event != trace_gap_event && handle < 64);
+
+    using State = typename Handle::State;
+
+    template<typename S>
+    static State& get_state(S& states) {
+        return Handle::get_state(states);
+    }
+
+    static int begin_invoke(State& state) {
+        trace.record(TraceKind::Begin, event, handle);
+        auto result = Handle::begin_invoke(state);
+        trace.record(result ? TraceKind::End : TraceKind::Yield, event, handle);
+        return result;
+    }
+
+    static int step(State& state) {
+        trace.record(TraceKind::Resume, event, handle);
+        auto result = Handle::step(state);
+        trace.record(result ? TraceKind::End : TraceKind::Yield, event, handle);
+        return result;
+    }
+};
+
+#if defined(USING_ARDUINO) || defined(TARGET_SIM)
+
+/// \brief Writes the records in the trace buffer to `Serial`, oldest first, and clears it.
+template<typename Trace>
+void trace_dump(Trace& trace) {
+    const u8 header[] = {'E', 'T', trace_version,
+                         static_cast<u8>(trace.count), static_cast<u8>(trace.count >> 8),
+                         static_cast<u8>(trace.base_us), static_cast<u8>(trace.base_us >> 8),
+                         static_cast<u8>(trace.base_us >> 16), static_cast<u8>(trace.base_us >> 24)};
+    Serial.write(header, sizeof(header));
+
+    // Before the buffer is full the oldest record is the first one
+    size_t first = trace.count == Trace::size ? trace.head : 0;
+    for (size_t i = 0; i < trace.count; i++) {
+        size_t index = (first + i) % Trace::size;
+        Serial.write(reinterpret_cast<const u8*>(&trace.records[index]), sizeof(TraceRecord));
+    }
+    trace.clear();
+}
+
+/// \brief Dumps the trace buffer if a 'T' has been received.
+template<typename Trace>
+void trace_poll(Trace& trace) {
+    if (Serial.available() && Serial.peek() == 'T') {
+        Serial.read();
+        trace_dump(trace);
+    }
+}
+
+#else
+
+template<typename Trace>
+void trace_poll(Trace&) {}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eel {
+
+    /// \brief A sized function or object in the symbol table of an ELF file.
+    struct ElfSymbol {
+        /// \brief The demangled name.
+        std::string name;
+        uint64_t size = 0;
+        /// \brief Whether the symbol occupies program memory (code, read-only data and initialised data).
+        bool in_flash = false;
+        /// \brief Whether the symbol occupies RAM (initialised and zero-initialised data).
+        bool in_ram = false;
+    };
+
+    /// \brief Reads the sized function and object symbols of a 32 or 64-bit ELF file,
+    /// such as an AVR firmware image or a host object file.
+    /// \returns The symbols, or `std::nullopt` if `image` is not a valid ELF file with a symbol table.
+    std::optional<std::vector<ElfSymbol>> read_elf_symbols(const std::vector<uint8_t>& image);
+
+    /// \brief Attributes the size of the symbols of a compiled program to the
+    /// EEL constructs they were generated from, using the naming scheme of codegen.
+    struct SizeReport {
+        enum struct Construct {
+            Event,
+            Predicate,
+            Handle,
+            State,
+            Function,
+            Variable,
+            Setup,
+            Loop,
+            Main,
+            /// \brief Templates and globals of the runtime library.
+            Runtime,
+            /// \brief Anything else, such as the arduino core and compiler support code.
+            Other,
+        };
+
+        struct Entry {
+            Construct construct;
+            std::string name;
+            uint64_t flash_bytes = 0;
+            uint64_t ram_bytes = 0;
+        };
+
+        /// \brief Entries ordered by their total size, largest first.
+        std::vector<Entry> entries;
+        uint64_t flash_bytes = 0;
+        uint64_t ram_bytes = 0;
+
+        /// \brief Builds the report.
+        /// \param names EEL names of generated identifiers, as written to the source map.
+        /// Identifiers that are not in it are named after the generated identifier.
+        static SizeReport build(const std::vector<ElfSymbol>& symbols,
+                                const std::unordered_map<std::string, std::string>& names = {});
+
+        [[nodiscard]] std::string to_text() const;
+    };
+
+    const char* construct_name(SizeReport::Construct construct);
+}
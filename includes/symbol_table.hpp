@@ -146,8 +146,10 @@ namespace eel {
 
         symbols::Variable* declare_var(Symbol& type, const std::string& name, bool is_static = false);
 
-        struct ConstExpr {}; // TODO replace with proper type
-        void declare_const(Symbol& type, const std::string& name, ConstExpr expr);
+        /// \brief Declares a constant. The value of the constant
+        /// is expected to be assigned by the caller once computed.
+        /// \returns The newly created constant, or `nullptr` if the name is already in use.
+        symbols::Constant* declare_const(Symbol& type, const std::string& name);
 
         /// \brief Registers an already existing type.
         void declare_type(symbols::Type*);
@@ -179,6 +181,9 @@ namespace eel {
 
         Symbol declare_event(const std::string& name);
         Symbol declare_event(const std::string& name, symbols::Function* function);
+
+        /// \brief Declares a built-in event whose predicate is the external (c++) function `cpp_predicate`.
+        Symbol declare_event_cpp(const std::string& eel_name, const std::string& cpp_predicate);
         symbols::Event& declare_event_handle(const std::string& event_name, Error::Pos pos);
 
         /// \brief Declares a function by the given name, with no return type.
@@ -243,6 +248,7 @@ namespace eel {
         Symbol_& new_symbol();
         Symbol get_symbol(Symbol_::Id id);
         Symbol::Raw get_symbol_raw(Symbol::Id id);
+        size_t get_symbol_count();
 
         Scope root_scope;
 
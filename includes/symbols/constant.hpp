@@ -1,11 +1,57 @@
 #pragma once
+
+#include <cstdint>
+#include <vector>
+
 #include <symbol_table.hpp>
 
 namespace eel::symbols {
 
     // const T x = ?;
     struct Constant {
-        struct Value {};
+        /// \brief A value computed at compile time.
+        /// Scalars are stored in the union member matching `kind`,
+        /// aggregates (arrays) store their elements in `elements`.
+        struct Value {
+            enum struct Kind {
+                None = 0,
+                Integer,
+                Float,
+                Bool,
+                Array,
+            };
+
+            Kind kind = Kind::None;
+            union {
+                int64_t integer = 0;
+                double floating;
+                bool boolean;
+            };
+            std::vector<Value> elements;
+            /// \brief The primitive the value is represented in, set by `cast`.
+            /// `nullptr` for literals and the results of operations on literals only.
+            const Primitive* type = nullptr;
+
+            static Value from_integer(int64_t value);
+            static Value from_float(double value);
+            static Value from_bool(bool value);
+
+            /// \brief Whether a value was computed.
+            /// A value of kind `None` signals that the expression
+            /// it was computed from is not a constant expression.
+            [[nodiscard]] bool is_constant() const;
+            [[nodiscard]] bool is_scalar() const;
+
+            [[nodiscard]] int64_t as_integer() const;
+            [[nodiscard]] double as_float() const;
+            [[nodiscard]] bool as_bool() const;
+
+            /// \brief Converts the value into the representation of `type`.
+            /// Integers are wrapped to the width of the type, arrays are converted
+            /// element-wise and non-primitive types leave the value untouched.
+            /// The result is tagged with the type.
+            [[nodiscard]] Value cast(const Type* type) const;
+        };
     public:
         Symbol type;
         Value value;
@@ -15,18 +15,26 @@ namespace eel::symbols {
     public:
         /// \brief Whether the event occurrence
         ///        is determined by a predicate.
-        bool has_predicate;
+        bool has_predicate = false;
 
         /// \brief Whether the symbol is complete.
         /// An incomplete event is created when
         /// event handler is created before the corresponding
         /// event has been declared.
-        bool is_complete;
+        bool is_complete = false;
 
         /// \brief Whether the event has been awaited.
-        bool is_awaited;
+        bool is_awaited = false;
 
-        Function* predicate;
+        /// \brief Dispatch priority, higher priorities are dispatched first.
+        /// The highest of the priorities annotated on the event and its handles.
+        uint8_t priority = 0;
+
+        Function* predicate = nullptr;
+
+        /// \brief The external (c++) function polled as the predicate of a built-in event,
+        /// empty for events declared in the program.
+        std::string builtin_predicate;
 
         std::string id;
 
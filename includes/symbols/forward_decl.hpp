@@ -7,5 +7,6 @@ namespace eel::symbols {
     struct Function;
     struct ExternalFunction;
     struct Type;
+    struct Primitive;
     struct Event;
 }
\ No newline at end of file
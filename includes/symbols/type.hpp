@@ -47,6 +47,10 @@ namespace eel::symbols {
         static Primitive f32;
         static Primitive f64;
 
+        /// \brief Signed fixed-point types with 8/16 integer and 8/16 fractional bits.
+        static Primitive q8_8;
+        static Primitive q16_16;
+
         static Primitive boolean;
 
         static Primitive digital;
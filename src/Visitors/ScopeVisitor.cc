@@ -1,10 +1,16 @@
 #include <Visitors/ScopeVisitor.hpp>
 #include <Visitors/utility.hpp>
+#include <Visitors/const_eval.hpp>
 #include <fmt/core.h>
+#include <algorithm>
 
 ScopeVisitor::ScopeVisitor(SymbolTable* _table) {
     table = _table;
     symbols::Primitive::register_primitives(table->root_scope);
+
+    // Serial input, see runtime/serial.hpp
+    table->root_scope->declare_event_cpp("serial_data", "serial_poll_data");
+    table->root_scope->declare_event_cpp("serial_line", "serial_poll_line");
     current_scope = table->root_scope;
     current_event = nullptr;
     active_sequence = nullptr;
@@ -77,7 +83,54 @@ antlrcpp::Any ScopeVisitor::visitVariableDecl (eelParser::VariableDeclContext* c
 
 antlrcpp::Any ScopeVisitor::visitConstDecl(eelParser::ConstDeclContext* ctx) {
     auto res = any_cast<TypedIdentifier>(visit(ctx->typedIdentifier()));
-    current_scope->declare_const(res.type, res.identifier, {});
+    auto evaluator = visitors::ConstEvalVisitor(current_scope);
+    evaluator.int_width = int_width;
+    symbols::Constant::Value value;
+
+    if (ctx->arrayInit() != nullptr) {
+        value.kind = symbols::Constant::Value::Kind::Array;
+        for (auto expr: visitors::flatten_expr_list(ctx->arrayInit()->exprList())) {
+            auto element = evaluator.evaluate(expr);
+            if (!element.is_scalar()) {
+                errors.push_back(Error(Error::NotConstant, expr->getStart(), ctx, ""));
+                return {};
+            }
+            value.elements.push_back(element);
+        }
+
+        // An explicit size pads the table with zeroes
+        if (ctx->expr() != nullptr) {
+            auto size = evaluator.evaluate(ctx->expr());
+            if (size.kind != symbols::Constant::Value::Kind::Integer || size.integer < 0) {
+                errors.push_back(Error(Error::NotConstant, ctx->expr()->getStart(), ctx, ""));
+                return {};
+            }
+            if (static_cast<size_t>(size.integer) < value.elements.size()) {
+                auto expected = fmt::format("at most {} elements", size.integer);
+                errors.push_back(Error(Error::TypeMisMatch, ctx->arrayInit()->getStart(), ctx, expected));
+                return {};
+            }
+            value.elements.resize(size.integer, symbols::Constant::Value::from_integer(0));
+        }
+    } else {
+        value = evaluator.evaluate(ctx->expr());
+        if (!value.is_constant()) {
+            errors.push_back(Error(Error::NotConstant, ctx->expr()->getStart(), ctx, ""));
+            return {};
+        }
+    }
+
+    auto constant = current_scope->declare_const(res.type, res.identifier);
+    if (constant == nullptr) {
+        errors.push_back(Error(Error::AlreadyDefined, ctx->typedIdentifier()->Identifier()->getSymbol(), ctx, ""));
+        return {};
+    }
+
+    // Store the value in the representation of the declared type,
+    // deferred types are left as is and reported by the type checker.
+    if (res.type->kind == Symbol_::Kind::Type)
+        value = value.cast(res.type->value.type);
+    constant->value = value;
     return {};
 }
 
@@ -149,6 +202,20 @@ static symbols::Function* create_predicate_function(SymbolTable& table, Scope& c
     return function;
 }
 
+/// Parses the priority of a `priority(n)` annotation, saturating at the maximum priority.
+/// Annotations with any other name are reported and have priority zero.
+static uint8_t annotated_priority(eelParser::PriorityAnnotationContext* ctx, std::vector<Error>& errors) {
+    auto name = ctx->Identifier()->getText();
+    if (name != "priority") {
+        errors.push_back(Error(Error::Unsupported, ctx->Identifier()->getSymbol(), ctx,
+                               fmt::format("annotation `{}`", name)));
+        return 0;
+    }
+
+    auto value = visitors::ConstEvalVisitor::parse_integer(ctx->IntegerLiteral());
+    return static_cast<uint8_t>(std::min<uint64_t>(value, UINT8_MAX));
+}
+
 antlrcpp::Any ScopeVisitor::visitEventDecl(eelParser::EventDeclContext* ctx) {
     auto name = ctx->Identifier()->getText();
     auto event = current_scope->find(name);
@@ -203,6 +270,14 @@ antlrcpp::Any ScopeVisitor::visitEventDecl(eelParser::EventDeclContext* ctx) {
             }
         }
     }
+
+    if (ctx->priorityAnnotation() != nullptr) {
+        auto symbol = current_scope->find(name);
+        if (!symbol.is_nullptr() && symbol->kind == Symbol_::Kind::Event) {
+            auto& e = *symbol->value.event;
+            e.priority = std::max(e.priority, annotated_priority(ctx->priorityAnnotation(), errors));
+        }
+    }
     return {};
 }
 
@@ -215,6 +290,10 @@ antlrcpp::Any ScopeVisitor::visitOnDecl(eelParser::OnDeclContext* ctx) {
     auto& event = current_scope->declare_event_handle(ctx->fqn()->getText(), loc);
     auto& function = event.get_handle(loc);
 
+    // A handle raises the priority of the event it is attached to
+    if (ctx->priorityAnnotation() != nullptr)
+        event.priority = std::max(event.priority, annotated_priority(ctx->priorityAnnotation(), errors));
+
     function.scope = table->derive_scope(current_scope);
     function.body = ctx->stmtBlock();
     this->active_sequence = function.sequence = new Sequence(function.scope);
@@ -234,7 +313,16 @@ antlrcpp::Any ScopeVisitor::visitTraitDecl(eelParser::TraitDeclContext* ctx) {
  * Function declarations
  * */
 antlrcpp::Any ScopeVisitor::visitFnDecl(eelParser::FnDeclContext* ctx) {
-    return eelBaseVisitor::visitFnDecl(ctx);
+    // No code is generated for user-defined functions, reachable calls are reported by `ReachabilityAnalysis`.
+    // The body still gets its scopes, such that the analyses can walk it like any other body.
+    auto scope = current_scope;
+    current_scope = table->derive_scope(scope);
+    Sequence sequence(current_scope);
+    active_sequence = &sequence;
+    visitChildren(ctx);
+    current_scope = scope;
+    active_sequence = nullptr;
+    return {};
 }
 
 antlrcpp::Any ScopeVisitor::visitParamList(eelParser::ParamListContext* ctx) {
@@ -242,7 +330,9 @@ antlrcpp::Any ScopeVisitor::visitParamList(eelParser::ParamListContext* ctx) {
 }
 
 antlrcpp::Any ScopeVisitor::visitFnParam(eelParser::FnParamContext* ctx) {
-    return eelBaseVisitor::visitFnParam(ctx);
+    auto res = any_cast<TypedIdentifier>(visit(ctx->typedIdentifier()));
+    current_scope->declare_var(res.type, res.identifier);
+    return {};
 }
 
 
@@ -345,8 +435,40 @@ std::any ScopeVisitor::visitAwaitStmt(eelParser::AwaitStmtContext* ctx) {
     if (this->active_sequence == nullptr)
         throw InternalError(InternalError::ScopeAnalysis, "Invalid visit to AwaitStmt without active_sequence.");
 
-    active_sequence->yield(); // TODO mark event as awaited assuming ctx is an event.
+    active_sequence->yield();
+
+    // Events declared later in the program are picked up by the reachability analysis
+    if (auto fqn = dynamic_cast<eelParser::FqnExprContext*>(ctx->expr())) {
+        auto symbol = visitors::resolve_fqn(current_scope, fqn->fqn());
+        if (!symbol.is_nullptr() && symbol->kind == Symbol_::Kind::Event)
+            symbol->value.event->is_awaited = true;
+    }
+    visitChildren(ctx);
+
+    return {};
+}
+
+/// Whether the tree contains an await statement.
+static bool contains_await(antlr4::tree::ParseTree* tree) {
+    if (dynamic_cast<eelParser::AwaitStmtContext*>(tree) != nullptr)
+        return true;
+    return std::any_of(tree->children.begin(), tree->children.end(), contains_await);
+}
+
+antlrcpp::Any ScopeVisitor::visitWhileStmt(eelParser::WhileStmtContext* ctx) {
+    if (this->active_sequence == nullptr)
+        throw InternalError(InternalError::ScopeAnalysis, "Invalid visit to WhileStmt without active_sequence.");
+
+    // Predicates are not sliced as they have to produce a result within the turn.
+    // Loops containing awaits already yield on every iteration.
+    if (time_slicing && loop_depth == 0 && current_event == nullptr && !contains_await(ctx->stmtBlock())) {
+        active_sequence->current_block->mark_async();
+        sliced_loops.insert(ctx);
+    }
+
+    loop_depth++;
     visitChildren(ctx);
+    loop_depth--;
 
     return {};
 }
\ No newline at end of file
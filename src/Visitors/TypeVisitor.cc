@@ -174,12 +174,15 @@ bool TypeVisitor::Type::equals(TypeVisitor::Type* other) {
         }  else if(symbol->symbol()->kind == Symbol_::Kind::Event){
             return kind->literal() == Type::Kind::Bool;
         }
+        // Integer and float literals are promoted to fixed-point types
+        auto is_fixed = symbol->symbol()->id == symbols::Primitive::q8_8.id
+                        || symbol->symbol()->id == symbols::Primitive::q16_16.id;
         switch (kind->literal()) {
             case Type::Kind::Integer:
-                if(symbol->symbol()->id <= 7) return true;
+                if(symbol->symbol()->id <= 7 || is_fixed) return true;
                 break;
             case Type::Kind::Float:
-                if(symbol->symbol()->id == 8 || symbol->symbol()->id == 9) return true;
+                if(symbol->symbol()->id == 8 || symbol->symbol()->id == 9 || is_fixed) return true;
                 break;
             case Type::Kind::Bool:
                 return symbol->symbol()->id == 10;
@@ -294,16 +297,25 @@ antlrcpp::Any TypeVisitor::visitConstDecl(eelParser::ConstDeclContext* ctx) {
         auto error = Error(Error::UndefinedType,type.token, ctx,"");
         this->errors.push_back(error);
     } else {
-        this->expected_type = type; // Set expected type to be used inside expressions
-        auto expr = any_cast<Type>(visit(ctx->expr()));
-        this->expected_type = Type(); // Reset value
+        // Constant tables check each of their elements against the element type
+        std::vector<eelParser::ExprContext*> exprs;
+        if(ctx->arrayInit() != nullptr)
+            exprs = visitors::flatten_expr_list(ctx->arrayInit()->exprList());
+        else
+            exprs.push_back(ctx->expr());
+
+        for(auto expr_ctx : exprs) {
+            this->expected_type = type; // Set expected type to be used inside expressions
+            auto expr = any_cast<Type>(visit(expr_ctx));
+            this->expected_type = Type(); // Reset value
 
-        if(expr.is_literal && expr.literal() == Type::Undefined){
-            auto error = Error(Error::UndefinedType,expr.token, ctx,"");
-            this->errors.push_back(error);
-        } else if(!type.equals(&expr)){
-            auto error = Error(Error::TypeMisMatch,expr.token,ctx,type.to_string());
-            this->errors.push_back(error);
+            if(expr.is_literal && expr.literal() == Type::Undefined){
+                auto error = Error(Error::UndefinedType,expr.token, ctx,"");
+                this->errors.push_back(error);
+            } else if(!type.equals(&expr)){
+                auto error = Error(Error::TypeMisMatch,expr.token,ctx,type.to_string());
+                this->errors.push_back(error);
+            }
         }
         type.token = ctx->start;
     }
@@ -427,7 +439,18 @@ antlrcpp::Any TypeVisitor::visitStructExpr(eelParser::StructExprContext* ctx) {
 }
 
 antlrcpp::Any TypeVisitor::visitArrayExpr(eelParser::ArrayExprContext* ctx) {
-    return eelBaseVisitor::visitArrayExpr(ctx);
+    auto index = any_cast<Type>(visit(ctx->expr()));
+    auto integer = Type(Type::Integer, nullptr);
+    if(!integer.equals(&index)){
+        auto error = Error(Error::TypeMisMatch,index.token,ctx,integer.to_string());
+        this->errors.push_back(error);
+    }
+
+    // The symbol of an array resolves to its element type
+    auto token = current_scope->find(ctx->fqn()->getText());
+    if(token.is_nullptr())
+        return Type(Type::Undefined, ctx->start);
+    return Type(token, ctx->start);
 }
 
 antlrcpp::Any TypeVisitor::visitPointerExpr(eelParser::PointerExprContext* ctx) {
@@ -699,6 +722,15 @@ antlrcpp::Any TypeVisitor::visitAwaitStmt(eelParser::AwaitStmtContext* ctx) {
     return expr;
 }
 
+antlrcpp::Any TypeVisitor::visitEmitStmt(eelParser::EmitStmtContext* ctx) {
+    auto symbol = current_scope->find(ctx->fqn()->getText());
+    if(symbol.is_nullptr() || symbol->kind != Symbol_::Kind::Event){
+        auto error = Error(Error::Kind::TypeMisMatch, ctx->fqn()->start, ctx, "event");
+        this->errors.push_back(error);
+    }
+    return {};
+}
+
 antlrcpp::Any TypeVisitor::visitReturnStmt(eelParser::ReturnStmtContext* ctx) {
     if(nullptr == ctx->expr()){
         if(this->current_function->has_return_type()){
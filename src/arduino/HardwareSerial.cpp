@@ -278,4 +278,57 @@ size_t HardwareSerial::write(uint8_t c)
   return 1;
 }
 
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = size;
+  while (size > 0) {
+    // While nothing is queued bytes go straight to the data register,
+    // like in write(uint8_t)
+    if (_tx_buffer_head == _tx_buffer_tail && bit_is_set(*_ucsra, UDRE0)) {
+      HardwareSerial::write(*buffer++);
+      size--;
+      continue;
+    }
+
+    tx_buffer_index_t head;
+    tx_buffer_index_t tail;
+
+    TX_BUFFER_ATOMIC {
+      head = _tx_buffer_head;
+      tail = _tx_buffer_tail;
+    }
+
+    // Free space from the head up to the tail or the end of the buffer,
+    // whichever comes first. The interrupt handler only ever frees up more.
+    size_t space;
+    if (head >= tail)
+      space = SERIAL_TX_BUFFER_SIZE - head - (tail == 0 ? 1 : 0);
+    else
+      space = tail - head - 1;
+
+    if (space == 0) {
+      // Wait for the interrupt handler to free up space, or do its job
+      // ourselves if interrupts are disabled (see write(uint8_t))
+      if (bit_is_clear(SREG, SREG_I) && bit_is_set(*_ucsra, UDRE0))
+        _tx_udr_empty_irq();
+      continue;
+    }
+
+    if (space > size)
+      space = size;
+    memcpy(_tx_buffer + head, buffer, space);
+    buffer += space;
+    size -= space;
+
+    // A single index update and interrupt enable for the whole run
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      _tx_buffer_head = (tx_buffer_index_t)((head + space) % SERIAL_TX_BUFFER_SIZE);
+      sbi(*_ucsrb, UDRIE0);
+    }
+  }
+
+  _written = true;
+  return n;
+}
+
 #endif // whole file
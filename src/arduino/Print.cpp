@@ -27,6 +27,7 @@
 #include "Arduino.h"
 
 #include "Print.h"
+#include "print_format.h"
 
 // Public Methods //////////////////////////////////////////////////////////////
 
@@ -45,11 +46,16 @@ size_t Print::print(const __FlashStringHelper *ifsh)
 {
   PGM_P p = reinterpret_cast<PGM_P>(ifsh);
   size_t n = 0;
+  // Copy the text out of flash in chunks, such that it reaches
+  // write(buffer, size) instead of write(c) for every byte
+  char buffer[16];
   while (1) {
-    unsigned char c = pgm_read_byte(p++);
-    if (c == 0) break;
-    if (write(c)) n++;
-    else break;
+    size_t length = 0;
+    while (length < sizeof(buffer) && (buffer[length] = pgm_read_byte(p++)) != 0) length++;
+    if (length == 0) break;
+    size_t written = write(buffer, length);
+    n += written;
+    if (written < length || length < sizeof(buffer)) break;
   }
   return n;
 }
@@ -205,6 +211,13 @@ size_t Print::printNumber(unsigned long n, uint8_t base)
   char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
   char *str = &buf[sizeof(buf) - 1];
 
+  // Decimal numbers are formatted two digits at a time without divisions
+  if (base == 10) {
+    char *end = &buf[sizeof(buf)];
+    str = print_format::format_decimal(n, end);
+    return write(str, end - str);
+  }
+
   *str = '\0';
 
   // prevent crash if called with base == 1
@@ -223,6 +236,14 @@ size_t Print::printNumber(unsigned long n, uint8_t base)
 size_t Print::printFloat(double number, uint8_t digits) 
 { 
   size_t n = 0;
+
+#if __SIZEOF_DOUBLE__ == 4
+  // Same text in a single write, without looping over soft-float operations
+  if (digits <= print_format::max_fixed_digits) {
+    char buf[print_format::fixed_length(print_format::max_fixed_digits)];
+    return write(buf, print_format::format_fixed(buf, number, digits));
+  }
+#endif
   
   if (isnan(number)) return print("nan");
   if (isinf(number)) return print("inf");
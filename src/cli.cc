@@ -1,7 +1,12 @@
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <regex>
+#include <vector>
 #include <cxxopts.hpp>
 #include <fmt/core.h>
 #include <fmt/ostream.h>
+#include <fmt/format.h>
 
 #include <antlr4-runtime.h>
 #include <eelLexer.h>
@@ -11,19 +16,66 @@
 #include <Visitors/ScopeVisitor.hpp>
 #include <Visitors/TypeVisitor.hpp>
 #include <Visitors/codegen.hpp>
+#include <Visitors/setup_eval.hpp>
+#include <Visitors/reachability.hpp>
+#include <Visitors/dependencies.hpp>
+#include <Visitors/sampling.hpp>
+#include <Visitors/latency.hpp>
+#include <Visitors/utility.hpp>
+#include <size_report.hpp>
 
 struct BuildOptions {
+    std::string target = "avr";
     bool testing;
+    bool pre_evaluate_setup;
+    bool narrow_arithmetic;
+    bool cache_predicates;
+    bool sample_inputs;
+    /// Time slice budget in microseconds, 0 if loops are not sliced.
+    unsigned long time_slice_us = 0;
+    /// Whether prints outside of async code drop text that does not fit into the TX buffer.
+    bool serial_drop;
+    /// Sizes of the serial ring buffers in bytes, 0 to keep the core's default.
+    unsigned long serial_tx_buffer = 0;
+    unsigned long serial_rx_buffer = 0;
+    /// Path of the JSON latency report, empty if latency is not analysed.
+    std::string latency_report_path;
+    /// Path of the profiling name map, empty if the program is not profiled.
+    std::string profile_map_path;
+    /// Path of the tracing name map, empty if the program is not traced.
+    std::string trace_map_path;
+    /// Path of the source map, empty if `#line` directives are not emitted.
+    std::string source_map_path;
 };
 
-static void process_file(std::fstream& input_file, std::fstream&  output_file, BuildOptions& options);
+/// \returns False if the program contains errors, in which case no code is generated.
+static bool process_file(std::fstream& input_file, std::fstream&  output_file, BuildOptions& options,
+                         const std::string& input_path);
 
 static void register_test_library(SymbolTable& table);
 
+static std::string escape_json(const std::string& text);
+
+/// Writes the source names of the profiled or traced events and handles as JSON.
+static void write_name_map(const std::string& path, const visitors::CodegenVisitor& visitor);
+
+/// `eelc size <file>`: attributes the flash and RAM use of a compiled program to EEL constructs.
+static int run_size(int argc, char** argv);
+
+/// Targets accepted by `--target` along with a short description.
+static const std::vector<std::pair<std::string, std::string>> targets {
+        {"avr", "AVR based arduino boards"},
+        {"amd64", "x86_64 host, arduino functions have to be provided externally"},
+        {"sim", "x86_64 host simulator with virtual time, simulated pins and captured serial"},
+};
+
 auto main(int argc, char** argv) -> int {
     const std::string ProgramName = "eelc";
     const std::string ProgramDescription = "Compiler for the EEL language";
 
+    if (argc > 1 && std::string(argv[1]) == "size")
+        return run_size(argc - 1, argv + 1);
+
     BuildOptions buildOptions {};
 
     cxxopts::Options options(ProgramName, ProgramDescription);
@@ -32,7 +84,38 @@ auto main(int argc, char** argv) -> int {
             ("t,target", "Select target platform (default: avr)", cxxopts::value<std::string>())
             ("f,file", "Sets source file path", cxxopts::value<std::string>())
             ("list-targets", "Lists available target platforms", cxxopts::value<bool>())
-            ("test", "Enables use of the testing library", cxxopts::value<bool>());
+            ("test", "Enables use of the testing library", cxxopts::value<bool>())
+            ("pre-evaluate-setup", "Evaluates the side-effect free prefix of setup at compile time",
+                    cxxopts::value<bool>())
+            ("narrow-arithmetic", "Performs 32 and 64-bit arithmetic in narrower types when the result is unaffected",
+                    cxxopts::value<bool>())
+            ("cache-predicates", "Only re-evaluates event predicates that depend solely on variables after those are written",
+                    cxxopts::value<bool>())
+            ("sample-inputs", "Reads the pins used by event predicates once per loop iteration",
+                    cxxopts::value<bool>())
+            ("time-slice", "Lets long running loops yield after the given number of microseconds per loop iteration",
+                    cxxopts::value<unsigned long>())
+            ("analyze-latency", "Reports the longest run time between yield points and the memory use of each handler, "
+                                "also written as JSON to <file>.latency.json",
+                    cxxopts::value<bool>())
+            ("profile", "Counts event and handler activity and execution times on the device, dumped over serial "
+                        "on receiving 'P'. Entry names are written to <file>.profile.json",
+                    cxxopts::value<bool>())
+            ("trace", "Records when handles begin, end, yield and resume in a ring buffer, dumped over serial "
+                      "on receiving 'T'. Entry names are written to <file>.trace.json",
+                    cxxopts::value<bool>())
+            ("source-map", "Emits #line directives referring to the EEL source and writes the EEL names "
+                           "of generated identifiers to <file>.map.json",
+                    cxxopts::value<bool>())
+            ("serial-overflow", "What prints outside of async code do when the serial TX buffer is full: "
+                                "`block` (default) or `drop`, which drops and counts the text",
+                    cxxopts::value<std::string>())
+            ("serial-tx-buffer", "Size of the serial TX buffer in bytes, a power of two up to 256. "
+                                 "The arduino core must be built with the same size",
+                    cxxopts::value<unsigned long>())
+            ("serial-rx-buffer", "Size of the serial RX buffer in bytes, a power of two up to 256. "
+                                 "The arduino core must be built with the same size",
+                    cxxopts::value<unsigned long>());
 
     auto opts = options.parse(argc, argv);
 
@@ -41,6 +124,23 @@ auto main(int argc, char** argv) -> int {
         return 0;
     }
 
+    if (opts.count("list-targets") > 0) {
+        for (auto& [name, description]: targets)
+            fmt::print("{:<8}{}\n", name, description);
+        return 0;
+    }
+
+    if (opts.count("target") > 0) {
+        buildOptions.target = opts["target"].as<std::string>();
+        auto known = std::any_of(targets.begin(), targets.end(), [&](auto& target) {
+            return target.first == buildOptions.target;
+        });
+        if (!known) {
+            std::cout << "Unknown target `" << buildOptions.target << "`. See --list-targets." << std::endl;
+            return 1;
+        }
+    }
+
     if (opts.count("file") == 0){
         std::cout << "Source file path is required." << std::endl;
         return 0;
@@ -50,22 +150,83 @@ auto main(int argc, char** argv) -> int {
         buildOptions.testing = true;
     }
 
+    if (opts.count("pre-evaluate-setup") > 0) {
+        buildOptions.pre_evaluate_setup = true;
+    }
+
+    if (opts.count("narrow-arithmetic") > 0) {
+        buildOptions.narrow_arithmetic = true;
+    }
+
+    if (opts.count("cache-predicates") > 0) {
+        buildOptions.cache_predicates = true;
+    }
+
+    if (opts.count("sample-inputs") > 0) {
+        buildOptions.sample_inputs = true;
+    }
+
+    if (opts.count("time-slice") > 0) {
+        buildOptions.time_slice_us = opts["time-slice"].as<unsigned long>();
+        if (buildOptions.time_slice_us == 0) {
+            std::cout << "The time slice must be at least one microsecond." << std::endl;
+            return 1;
+        }
+    }
+
+    if (opts.count("serial-overflow") > 0) {
+        auto& policy = opts["serial-overflow"].as<std::string>();
+        if (policy == "drop") {
+            buildOptions.serial_drop = true;
+        } else if (policy != "block") {
+            std::cout << "Unknown serial overflow policy `" << policy << "`." << std::endl;
+            return 1;
+        }
+    }
+
+    for (auto [name, size]: {std::pair {"serial-tx-buffer", &buildOptions.serial_tx_buffer},
+                             std::pair {"serial-rx-buffer", &buildOptions.serial_rx_buffer}}) {
+        if (opts.count(name) == 0)
+            continue;
+        // Larger buffers need 16-bit indices, which the core does not access atomically
+        *size = opts[name].as<unsigned long>();
+        if (*size < 2 || *size > 256 || (*size & (*size - 1)) != 0) {
+            std::cout << "The --" << name << " size must be a power of two between 2 and 256." << std::endl;
+            return 1;
+        }
+    }
+
     auto& input_path = opts["file"].as<std::string>();
     auto output_path = fmt::format("{}.cc", input_path);
 
+    if (opts.count("analyze-latency") > 0)
+        buildOptions.latency_report_path = fmt::format("{}.latency.json", input_path);
+
+    if (opts.count("profile") > 0)
+        buildOptions.profile_map_path = fmt::format("{}.profile.json", input_path);
+
+    if (opts.count("trace") > 0)
+        buildOptions.trace_map_path = fmt::format("{}.trace.json", input_path);
+
+    if (opts.count("source-map") > 0)
+        buildOptions.source_map_path = fmt::format("{}.map.json", input_path);
+
     std::fstream input_file(input_path);
     std::fstream output_file(output_path, std::fstream::out);
 
-    process_file(input_file, output_file, buildOptions);
+    auto success = process_file(input_file, output_file, buildOptions, input_path);
 
     input_file.close();
     output_file.close();
 
-    return 0;
+    return success ? 0 : 1;
 }
 
-void process_file(std::fstream& input_file, std::fstream& output_file, BuildOptions& options) {
-    antlr4::ANTLRInputStream input(input_file);
+bool process_file(std::fstream& input_file, std::fstream& output_file, BuildOptions& options,
+                  const std::string& input_path) {
+    std::string source {std::istreambuf_iterator<char>(input_file), std::istreambuf_iterator<char>()};
+
+    antlr4::ANTLRInputStream input(source);
     eel::eelLexer lexer(&input);
     antlr4::CommonTokenStream tokens(&lexer);
     tokens.fill();
@@ -75,23 +236,246 @@ void process_file(std::fstream& input_file, std::fstream& output_file, BuildOpti
     eel::SymbolTable symbol_table;
 
     auto scope_visitor = ScopeVisitor(&symbol_table);
+    // `int` is 16 bits wide on AVR, testing and the other targets run on the host
+    size_t int_width = options.target == "avr" && !options.testing ? 16 : 32;
 
     if (options.testing)
         register_test_library(symbol_table);
 
+    scope_visitor.time_slicing = options.time_slice_us > 0;
+    scope_visitor.int_width = int_width;
     scope_visitor.visitProgram(tree);
     TypeVisitor(&symbol_table).visitProgram(tree);
 
     auto cg_visitor = visitors::CodegenVisitor(symbol_table, &output_file);
+
+    auto reachability = visitors::ReachabilityAnalysis(symbol_table).run(tree);
+    if (!reachability.log.empty()) {
+        fmt::print("Removed unreachable code:\n");
+        for (auto& line: reachability.log)
+            fmt::print("  {}\n", line);
+    }
+
+    if (!reachability.errors.empty()) {
+        for (auto& error: reachability.errors)
+            error.print();
+        return false;
+    }
+
+    if (!options.latency_report_path.empty()) {
+        auto analysis = visitors::LatencyAnalysis(symbol_table);
+        analysis.dead_events = reachability.dead_events;
+        auto result = analysis.run(tree);
+        fmt::print("{}", result.to_text());
+
+        std::fstream report(options.latency_report_path, std::fstream::out);
+        report << result.to_json();
+    }
+
+    cg_visitor.dead_events = std::move(reachability.dead_events);
+    cg_visitor.dead_functions = std::move(reachability.dead_functions);
+    cg_visitor.dead_declarations = std::move(reachability.dead_declarations);
+    cg_visitor.elided_statements = std::move(reachability.dead_statements);
+
+    if (options.pre_evaluate_setup) {
+        auto evaluator = visitors::SetupEvaluator(symbol_table);
+        evaluator.int_width = int_width;
+        auto result = evaluator.run(tree);
+        fmt::print("Pre-evaluated {} statement(s) of setup\n", result.elided_statements.size());
+        for (auto& line: result.log)
+            fmt::print("  {}\n", line);
+
+        cg_visitor.elided_statements.merge(result.elided_statements);
+        cg_visitor.initial_values = std::move(result.initial_values);
+    }
+
+    if (options.cache_predicates) {
+        auto result = visitors::PredicateDependencies(symbol_table).run(tree);
+        fmt::print("Cached {} event predicate(s)\n", result.cached.size());
+        for (auto& line: result.log)
+            fmt::print("  {}\n", line);
+
+        cg_visitor.cached_predicates = std::move(result.cached);
+        cg_visitor.predicate_dependents = std::move(result.dependents);
+    }
+
+    if (options.sample_inputs) {
+        auto result = visitors::InputSampling(symbol_table).run(tree);
+        fmt::print("Sampling {} pin(s) once per loop iteration\n",
+                   result.snapshot_pins.size() + result.sampled_pins.size());
+        for (auto& line: result.log)
+            fmt::print("  {}\n", line);
+
+        cg_visitor.snapshot_pins = std::move(result.snapshot_pins);
+        cg_visitor.sampled_pins = std::move(result.sampled_pins);
+    }
+
+    if (!scope_visitor.sliced_loops.empty())
+        fmt::print("Sliced {} loop(s) into {}us turns\n", scope_visitor.sliced_loops.size(), options.time_slice_us);
+    cg_visitor.sliced_loops = std::move(scope_visitor.sliced_loops);
+
+    cg_visitor.ranges.int_width = int_width;
+    cg_visitor.narrow_arithmetic = options.narrow_arithmetic;
+    cg_visitor.profile = !options.profile_map_path.empty();
+    cg_visitor.trace = !options.trace_map_path.empty();
+    if (!options.source_map_path.empty())
+        cg_visitor.source_path = input_path;
     cg_visitor.pre_include_hook = [options, cg_visitor](){
-        if (options.testing) {
-            // TODO set target dynamically or at least default to avr
-            fmt::print(*cg_visitor.stream, "#define TARGET_AMD64\n"
-                                           "#define TESTING\n");
+        if (options.target == "sim") {
+            fmt::print(*cg_visitor.stream, "#define TARGET_SIM\n");
+        } else if (options.target == "amd64" || options.testing) {
+            // Testing defaults to amd64 as the tests run on the host
+            fmt::print(*cg_visitor.stream, "#define TARGET_AMD64\n");
         }
+
+        if (options.testing)
+            fmt::print(*cg_visitor.stream, "#define TESTING\n");
+
+        if (options.time_slice_us > 0)
+            fmt::print(*cg_visitor.stream, "#define EEL_TIME_SLICE_US {}\n", options.time_slice_us);
+
+        if (options.serial_drop)
+            fmt::print(*cg_visitor.stream, "#define EEL_SERIAL_DROP\n");
+
+        if (options.serial_tx_buffer > 0)
+            fmt::print(*cg_visitor.stream, "#define SERIAL_TX_BUFFER_SIZE {}\n", options.serial_tx_buffer);
+        if (options.serial_rx_buffer > 0)
+            fmt::print(*cg_visitor.stream, "#define SERIAL_RX_BUFFER_SIZE {}\n", options.serial_rx_buffer);
     };
     cg_visitor.visitProgram(tree);
 
+    // The buffers are members of `HardwareSerial`, so its translation unit has to agree on their size
+    if (options.serial_tx_buffer > 0 || options.serial_rx_buffer > 0) {
+        std::string flags;
+        if (options.serial_tx_buffer > 0)
+            flags += fmt::format(" -DSERIAL_TX_BUFFER_SIZE={}", options.serial_tx_buffer);
+        if (options.serial_rx_buffer > 0)
+            flags += fmt::format(" -DSERIAL_RX_BUFFER_SIZE={}", options.serial_rx_buffer);
+        fmt::print("Build the arduino core with{}\n", flags);
+    }
+
+    if (options.narrow_arithmetic) {
+        fmt::print("Narrowed {} arithmetic operation(s)\n", cg_visitor.narrowing_log.size());
+        for (auto& line: cg_visitor.narrowing_log)
+            fmt::print("  {}\n", line);
+    }
+
+    if (cg_visitor.profile) {
+        fmt::print("Profiling {} event(s) and {} handle(s)\n",
+                   cg_visitor.instrumented_events.size(), cg_visitor.instrumented_handles.size());
+        write_name_map(options.profile_map_path, cg_visitor);
+    }
+
+    if (cg_visitor.trace) {
+        fmt::print("Tracing {} handle(s)\n", cg_visitor.instrumented_handles.size());
+        write_name_map(options.trace_map_path, cg_visitor);
+    }
+
+    if (!cg_visitor.telemetry_messages.empty()) {
+        std::vector<std::string> messages;
+        for (size_t id = 0; id < cg_visitor.telemetry_messages.size(); id++) {
+            auto& message = cg_visitor.telemetry_messages[id];
+            std::vector<std::string> fields;
+            for (auto& field: message.fields)
+                fields.push_back(fmt::format("{{\"name\": \"{}\", \"type\": \"{}\"}}", escape_json(field.name), field.type));
+            messages.push_back(fmt::format("{{\"id\": {}, \"line\": {}, \"fields\": [{}]}}",
+                                           id, message.line, fmt::join(fields, ", ")));
+        }
+
+        fmt::print("Telemetry: {} message(s), schema written to {}.telemetry.json\n", messages.size(), input_path);
+        std::fstream schema(fmt::format("{}.telemetry.json", input_path), std::fstream::out);
+        schema << fmt::format("{{\n  \"version\": 1,\n  \"framing\": \"cobs\",\n  \"checksum\": \"xor\",\n"
+                              "  \"messages\": [\n    {}\n  ]\n}}\n", fmt::join(messages, ",\n    "));
+    }
+
+    if (!options.source_map_path.empty()) {
+        std::vector<std::string> entries;
+        for (auto& entry: cg_visitor.source_map) {
+            entries.push_back(fmt::format("{{\"generated\": \"{}\", \"kind\": \"{}\", \"name\": \"{}\", \"line\": {}}}",
+                                          entry.generated, entry.kind, entry.name, entry.line));
+        }
+
+        std::fstream map(options.source_map_path, std::fstream::out);
+        map << fmt::format("{{\n  \"version\": 1,\n  \"source\": \"{}\",\n  \"symbols\": [\n    {}\n  ]\n}}\n",
+                           escape_json(input_path), fmt::join(entries, ",\n    "));
+    }
+
+    return true;
+}
+
+int run_size(int argc, char** argv) {
+    cxxopts::Options options("eelc size", "Reports the flash and RAM used by each EEL construct of a compiled program");
+    options.add_options()
+            ("h,help", "Display help text", cxxopts::value<bool>())
+            ("f,file", "ELF file of the compiled program, such as the firmware or an object file",
+                    cxxopts::value<std::string>())
+            ("map", "Source map written by --source-map, used to name variables and handles",
+                    cxxopts::value<std::string>());
+    options.parse_positional({"file"});
+    auto opts = options.parse(argc, argv);
+
+    if (opts.count("help") > 0) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    if (opts.count("file") == 0) {
+        std::cout << "ELF file path is required." << std::endl;
+        return 1;
+    }
+
+    auto& path = opts["file"].as<std::string>();
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto symbols = read_elf_symbols(image);
+    if (!symbols) {
+        std::cout << "`" << path << "` is not an ELF file with a symbol table." << std::endl;
+        return 1;
+    }
+
+    // The source map has one symbol per line, which is all we need to read it back
+    std::unordered_map<std::string, std::string> names;
+    if (opts.count("map") > 0) {
+        static const std::regex entry(R"re("generated": "([^"]*)", "kind": "([^"]*)", "name": "([^"]*)", "line": (\d+))re");
+        std::ifstream map(opts["map"].as<std::string>());
+        std::string line;
+        std::smatch match;
+        while (std::getline(map, line)) {
+            if (!std::regex_search(line, match, entry))
+                continue;
+
+            // Handles are anonymous, so they are told apart by their line
+            names[match[1].str()] = match[2].str() == "handle"
+                                    ? fmt::format("{} ({})", match[3].str(), match[4].str())
+                                    : match[3].str();
+        }
+    }
+
+    fmt::print("{}", SizeReport::build(*symbols, names).to_text());
+    return 0;
+}
+
+std::string escape_json(const std::string& text) {
+    std::string result;
+    for (auto c: text) {
+        if (c == '\\' || c == '"')
+            result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+void write_name_map(const std::string& path, const visitors::CodegenVisitor& visitor) {
+    // Names are identifiers, so they need no escaping
+    std::vector<std::string> events, handles;
+    for (auto& event: visitor.instrumented_events)
+        events.push_back(fmt::format("\"{}\"", event));
+    for (auto& handle: visitor.instrumented_handles)
+        handles.push_back(fmt::format("{{\"event\": {}, \"name\": \"{}\"}}", handle.event, handle.name));
+
+    std::fstream map(path, std::fstream::out);
+    map << fmt::format("{{\n  \"version\": 1,\n  \"events\": [{}],\n  \"handles\": [{}]\n}}\n",
+                       fmt::join(events, ", "), fmt::join(handles, ", "));
 }
 
 void register_test_library(SymbolTable& table) {
@@ -55,6 +55,7 @@ Trait: 'trait';
 On: 'on';
 In: 'in';
 Await: 'await';
+Emit: 'emit';
 Lock: 'lock';
 Set: 'set';
 Mode: 'mode';
@@ -170,6 +171,7 @@ variableDecl:
 
 constDecl:
     Const typedIdentifier '=' expr ';'
+    | Const typedIdentifier '[' expr? ']' '=' arrayInit ';'
 ;
 
 staticDecl:
@@ -240,8 +242,14 @@ fnParam: typedIdentifier;
 
 
 eventDecl:
-    Event Identifier ';'
-    | Event Identifier stmtBlock
+    Event Identifier priorityAnnotation? ';'
+    | Event Identifier priorityAnnotation? stmtBlock
+;
+
+// Higher priorities are dispatched first.
+// The annotation name is checked during scope analysis, so `priority` stays usable as an identifier.
+priorityAnnotation:
+    Identifier '(' IntegerLiteral ')'
 ;
 
 intervalDecl:
@@ -285,7 +293,7 @@ namespaceDecl:
 ;
 
 onDecl:
-    On fqn stmtBlock
+    On fqn priorityAnnotation? stmtBlock
 ;
 
 stmt:
@@ -298,6 +306,7 @@ stmt:
     | forEachStmt
     | lockStmt
     | awaitStmt
+    | emitStmt
     | pinStmt
     | continueStmt
     | breakStmt
@@ -363,6 +372,9 @@ lockList:
 awaitStmt:
     Await expr ';' ;
 
+emitStmt:
+    Emit fqn ';' ;
+
 pinStmt:
     Set fqn expr ';' # SetPinValueStmt
     | Set fqn Mode expr ';' # SetPinModeStmt
@@ -388,7 +400,7 @@ expr:
     | CharLiteral # CharLiteral
     | StringLiteral # StringLiteral
 
-    | fqn '(' params=exprList ')' # FnCallExpr
+    | fqn '(' params=exprList? ')' # FnCallExpr
     | fqn '(' '&' Self ',' params=exprList ')' # InstanceAssociatedFnCallExpr
 
     | type '{' fieldInit* '}' # StructExpr
@@ -410,7 +422,7 @@ expr:
     | <assoc=left> left=expr op=('/'|'*'|'%') right=expr # ScalingExpr
     | <assoc=left> left=expr op=('+'|'-') right=expr # AdditiveExpr
     | <assoc=left> left=expr op=('>>'|'>>>' |'<<') right=expr # ShiftingExpr
-    | <assoc=left> left=expr op=('>'|'>='|'<='|'=='|'!=') right=expr # ComparisonExpr
+    | <assoc=left> left=expr op=('>'|'>='|'<'|'<='|'=='|'!=') right=expr # ComparisonExpr
 
     | <assoc=left> left=expr '&' right=expr # AndExpr
     | <assoc=left> left=expr '^' right=expr # XorExpr
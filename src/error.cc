@@ -32,6 +32,12 @@ void Error::print() {
         case Error::ExpectedVariable:
             ::print(this, "Expected Variable");
             break;
+        case Error::NotConstant:
+            ::print(this, "Expression is not a compile-time constant");
+            break;
+        case Error::Unsupported:
+            ::print(this, "Not supported: ");
+            break;
         default:
             ::print(this,"Unknown error");
     }
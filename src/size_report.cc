@@ -0,0 +1,340 @@
+#include <size_report.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <map>
+#include <regex>
+#include <set>
+#include <tuple>
+
+#include <fmt/core.h>
+
+using namespace eel;
+
+/*
+ * ELF parsing
+ *
+ * Only the section headers, the symbol table and its string table are read.
+ * Offsets of the fields differ between the 32 and 64-bit formats.
+ */
+
+namespace {
+    constexpr uint32_t sht_symtab = 2;
+    constexpr uint32_t sht_nobits = 8;
+
+    constexpr uint64_t shf_write = 0x1;
+    constexpr uint64_t shf_alloc = 0x2;
+    constexpr uint64_t shf_execinstr = 0x4;
+
+    constexpr uint16_t shn_undef = 0;
+    constexpr uint16_t shn_loreserve = 0xFF00;
+    constexpr uint16_t shn_common = 0xFFF2;
+
+    constexpr uint8_t stt_object = 1;
+    constexpr uint8_t stt_func = 2;
+
+    struct Reader {
+        const std::vector<uint8_t>& image;
+        bool is_64;
+        bool is_little_endian;
+
+        [[nodiscard]] bool contains(uint64_t offset, uint64_t size) const {
+            return offset <= image.size() && size <= image.size() - offset;
+        }
+
+        [[nodiscard]] uint64_t read(uint64_t offset, size_t size) const {
+            uint64_t value = 0;
+            for (size_t i = 0; i < size; i++) {
+                auto byte = image[offset + (is_little_endian ? size - 1 - i : i)];
+                value = (value << 8) | byte;
+            }
+            return value;
+        }
+
+        /// \brief Reads a field that is 4 bytes in ELF32 and 8 bytes in ELF64.
+        [[nodiscard]] uint64_t read_word(uint64_t offset) const {
+            return read(offset, is_64 ? 8 : 4);
+        }
+    };
+
+    struct Section {
+        uint32_t type;
+        uint64_t flags;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t link;
+    };
+
+    std::string demangle(const std::string& name) {
+        int status = 0;
+        auto demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+        if (status != 0 || demangled == nullptr)
+            return name;
+
+        std::string result(demangled);
+        free(demangled);
+        return result;
+    }
+}
+
+std::optional<std::vector<ElfSymbol>> eel::read_elf_symbols(const std::vector<uint8_t>& image) {
+    if (image.size() < 0x34 || image[0] != 0x7F || image[1] != 'E' || image[2] != 'L' || image[3] != 'F')
+        return std::nullopt;
+    if ((image[4] != 1 && image[4] != 2) || (image[5] != 1 && image[5] != 2))
+        return std::nullopt;
+
+    Reader reader {image, image[4] == 2, image[5] == 1};
+    if (reader.is_64 && image.size() < 0x40)
+        return std::nullopt;
+
+    auto section_offset = reader.read_word(reader.is_64 ? 0x28 : 0x20);
+    auto section_entry_size = reader.read(reader.is_64 ? 0x3A : 0x2E, 2);
+    auto section_count = reader.read(reader.is_64 ? 0x3C : 0x30, 2);
+    if (section_entry_size < (reader.is_64 ? 64u : 40u) || !reader.contains(section_offset, section_entry_size * section_count))
+        return std::nullopt;
+
+    std::vector<Section> sections;
+    for (uint64_t i = 0; i < section_count; i++) {
+        auto header = section_offset + i * section_entry_size;
+        if (reader.is_64) {
+            sections.push_back({static_cast<uint32_t>(reader.read(header + 4, 4)), reader.read(header + 8, 8),
+                                reader.read(header + 24, 8), reader.read(header + 32, 8),
+                                static_cast<uint32_t>(reader.read(header + 40, 4))});
+        } else {
+            sections.push_back({static_cast<uint32_t>(reader.read(header + 4, 4)), reader.read(header + 8, 4),
+                                reader.read(header + 16, 4), reader.read(header + 20, 4),
+                                static_cast<uint32_t>(reader.read(header + 24, 4))});
+        }
+    }
+
+    auto symbol_table = std::find_if(sections.begin(), sections.end(), [](auto& s) { return s.type == sht_symtab; });
+    if (symbol_table == sections.end() || symbol_table->link >= sections.size())
+        return std::nullopt;
+
+    auto& strings = sections[symbol_table->link];
+    if (!reader.contains(symbol_table->offset, symbol_table->size) || !reader.contains(strings.offset, strings.size))
+        return std::nullopt;
+
+    std::vector<ElfSymbol> symbols;
+    // Aliases, such as the variants of a constructor, share their address and would be counted twice
+    std::set<std::tuple<uint16_t, uint64_t, uint64_t>> seen;
+
+    uint64_t symbol_size = reader.is_64 ? 24 : 16;
+    for (uint64_t entry = symbol_table->offset;
+         entry + symbol_size <= symbol_table->offset + symbol_table->size;
+         entry += symbol_size) {
+        uint64_t name_offset = reader.read(entry, 4);
+        uint8_t info;
+        uint16_t section_index;
+        uint64_t value, size;
+        if (reader.is_64) {
+            info = image[entry + 4];
+            section_index = reader.read(entry + 6, 2);
+            value = reader.read(entry + 8, 8);
+            size = reader.read(entry + 16, 8);
+        } else {
+            value = reader.read(entry + 4, 4);
+            size = reader.read(entry + 8, 4);
+            info = image[entry + 12];
+            section_index = reader.read(entry + 14, 2);
+        }
+
+        auto type = info & 0xF;
+        if (size == 0 || (type != stt_object && type != stt_func) || section_index == shn_undef)
+            continue;
+        if (name_offset >= strings.size || !seen.insert({section_index, value, size}).second)
+            continue;
+
+        ElfSymbol symbol;
+        auto name = reinterpret_cast<const char*>(&image[strings.offset + name_offset]);
+        symbol.name = demangle(std::string(name, strnlen(name, strings.size - name_offset)));
+        symbol.size = size;
+
+        if (section_index == shn_common) {
+            symbol.in_ram = true;
+        } else if (section_index < shn_loreserve && section_index < sections.size()) {
+            auto& section = sections[section_index];
+            if (!(section.flags & shf_alloc))
+                continue;
+
+            auto is_writable = (section.flags & shf_write) && !(section.flags & shf_execinstr);
+            symbol.in_ram = is_writable;
+            // Initialised data is copied from program memory at startup
+            symbol.in_flash = !is_writable || section.type != sht_nobits;
+        } else {
+            continue;
+        }
+
+        symbols.push_back(std::move(symbol));
+    }
+
+    return symbols;
+}
+
+/*
+ * Attribution
+ */
+
+namespace {
+    struct Attribution {
+        SizeReport::Construct construct;
+        std::string generated;
+    };
+
+    /// \brief Names of runtime templates and of the globals emitted alongside the generated code.
+    const std::set<std::string> runtime_names {
+            "StatusFlags", "Event_", "Event", "HandleList", "InvokeHandle", "PredicateLess", "CachedPredicate",
+            "invalidate", "run_handles", "progmem_read", "DigitalSnapshot",
+            "SampledPin", "begin_time_slice", "time_slice_expired", "ProfileTable", "ProfiledPredicate",
+            "ProfiledHandle", "HandleTiming", "profile_loop", "profile_dump", "profile_poll", "TraceBuffer",
+            "TracedHandle", "trace_dump", "trace_poll", "pin", "loop_tick",
+            "__predicate_cache", "__inputs", "__profile", "__trace", "__dispatch_urgent",
+    };
+
+    /// \brief Finds the first identifier of a demangled name that is either generated or part of the runtime.
+    /// For `ProfiledHandle<s1_event_a_handle0, ...>::invoke()` that is the runtime wrapper,
+    /// and for `s1_event_a_handle0::invoke()` the handle.
+    std::optional<Attribution> attribute(const std::string& name) {
+        static const std::regex identifier(R"([A-Za-z_][A-Za-z0-9_]*)");
+        static const std::regex handle_state(R"(s\d+_event_\w+_handle_state)");
+        static const std::regex handle(R"(s\d+_event_\w+_handle\d+)");
+        static const std::regex predicate(R"(s\d+_event_\w+_predicate)");
+        static const std::regex event(R"(s\d+_event_\w+)");
+        static const std::regex setup(R"(func\d+___eel_setup)");
+        static const std::regex loop(R"(func\d+___eel_loop)");
+        static const std::regex function(R"(func\d+_\w+)");
+        static const std::regex variable(R"(__v\d+)");
+
+        using Construct = SizeReport::Construct;
+        for (auto it = std::sregex_iterator(name.begin(), name.end(), identifier); it != std::sregex_iterator(); ++it) {
+            auto token = it->str();
+            if (std::regex_match(token, handle_state))
+                return Attribution {Construct::State, token};
+            if (std::regex_match(token, handle))
+                return Attribution {Construct::Handle, token};
+            if (std::regex_match(token, predicate))
+                return Attribution {Construct::Predicate, token};
+            if (std::regex_match(token, event))
+                return Attribution {Construct::Event, token};
+            if (std::regex_match(token, setup))
+                return Attribution {Construct::Setup, token};
+            if (std::regex_match(token, loop))
+                return Attribution {Construct::Loop, token};
+            if (std::regex_match(token, function))
+                return Attribution {Construct::Function, token};
+            if (std::regex_match(token, variable))
+                return Attribution {Construct::Variable, token};
+            if (token == "__setup_state")
+                return Attribution {Construct::Setup, token};
+            if (token == "__loop_state")
+                return Attribution {Construct::Loop, token};
+            if (runtime_names.contains(token))
+                return Attribution {Construct::Runtime, token};
+        }
+        return std::nullopt;
+    }
+
+    /// \brief Names a generated identifier after the EEL construct, for when it is not in the source map.
+    std::string eel_name(const Attribution& attribution) {
+        static const std::regex event_name(R"(s\d+_event_(\w+?)(_handle(\d+)|_handle_state|_predicate)?)");
+        static const std::regex function_name(R"(func\d+_(\w+))");
+
+        std::smatch match;
+        switch (attribution.construct) {
+            case SizeReport::Construct::Event:
+            case SizeReport::Construct::Predicate:
+            case SizeReport::Construct::State:
+                if (std::regex_match(attribution.generated, match, event_name))
+                    return match[1].str();
+                break;
+            case SizeReport::Construct::Handle:
+                if (std::regex_match(attribution.generated, match, event_name))
+                    return fmt::format("on {} #{}", match[1].str(), match[3].str());
+                break;
+            case SizeReport::Construct::Function:
+                if (std::regex_match(attribution.generated, match, function_name))
+                    return match[1].str();
+                break;
+            case SizeReport::Construct::Setup:
+                return "setup";
+            case SizeReport::Construct::Loop:
+                return "loop";
+            default:
+                break;
+        }
+        return attribution.generated;
+    }
+}
+
+const char* eel::construct_name(SizeReport::Construct construct) {
+    switch (construct) {
+        case SizeReport::Construct::Event: return "event";
+        case SizeReport::Construct::Predicate: return "predicate";
+        case SizeReport::Construct::Handle: return "handle";
+        case SizeReport::Construct::State: return "state";
+        case SizeReport::Construct::Function: return "function";
+        case SizeReport::Construct::Variable: return "variable";
+        case SizeReport::Construct::Setup: return "setup";
+        case SizeReport::Construct::Loop: return "loop";
+        case SizeReport::Construct::Main: return "main";
+        case SizeReport::Construct::Runtime: return "runtime";
+        case SizeReport::Construct::Other: return "other";
+    }
+    return "";
+}
+
+SizeReport SizeReport::build(const std::vector<ElfSymbol>& symbols,
+                             const std::unordered_map<std::string, std::string>& names) {
+    SizeReport report;
+    std::map<std::pair<Construct, std::string>, Entry> entries;
+
+    for (auto& symbol: symbols) {
+        Attribution attribution {Construct::Other, "other"};
+        if (auto found = attribute(symbol.name)) {
+            attribution = *found;
+        } else if (symbol.name == "main") {
+            // Generated functors are usually inlined into main
+            attribution = {Construct::Main, "main"};
+        }
+
+        std::string name;
+        if (attribution.construct == Construct::Runtime || attribution.construct == Construct::Other
+            || attribution.construct == Construct::Main) {
+            name = attribution.generated;
+        } else {
+            auto mapped = names.find(attribution.generated);
+            name = mapped != names.end() ? mapped->second : eel_name(attribution);
+        }
+
+        auto& entry = entries[{attribution.construct, name}];
+        entry.construct = attribution.construct;
+        entry.name = name;
+        if (symbol.in_flash) {
+            entry.flash_bytes += symbol.size;
+            report.flash_bytes += symbol.size;
+        }
+        if (symbol.in_ram) {
+            entry.ram_bytes += symbol.size;
+            report.ram_bytes += symbol.size;
+        }
+    }
+
+    for (auto& [key, entry]: entries)
+        report.entries.push_back(std::move(entry));
+    std::stable_sort(report.entries.begin(), report.entries.end(), [](const Entry& a, const Entry& b) {
+        return a.flash_bytes + a.ram_bytes > b.flash_bytes + b.ram_bytes;
+    });
+    return report;
+}
+
+std::string SizeReport::to_text() const {
+    std::string text = fmt::format("{:<10} {:<32} {:>8} {:>8}\n", "construct", "name", "flash", "ram");
+    for (auto& entry: entries) {
+        text += fmt::format("{:<10} {:<32} {:>8} {:>8}\n",
+                            construct_name(entry.construct), entry.name, entry.flash_bytes, entry.ram_bytes);
+    }
+    text += fmt::format("{:<10} {:<32} {:>8} {:>8}\n", "total", "", flash_bytes, ram_bytes);
+    return text;
+}
@@ -3,6 +3,7 @@
 #include <symbols/variable.hpp>
 #include <symbols/constant.hpp>
 #include <symbols/event.hpp>
+#include <sequence.hpp>
 
 #include <utility>
 #include <fmt/core.h>
@@ -128,21 +129,24 @@ symbols::Variable *Scope_::declare_var(Symbol &type, const std::string &name, bo
     return var;
 }
 
-void Scope_::declare_const(Symbol &type, const std::string &name, ConstExpr expr) {
+symbols::Constant *Scope_::declare_const(Symbol &type, const std::string &name) {
     if (this->symbol_map.contains(name)) {
         // TODO throw exception
+        return nullptr;
     }
 
     auto &symbol = this->context->new_symbol();
-    symbol.kind = Symbol_::Kind::Variable;
+    symbol.kind = Symbol_::Kind::Constant;
     symbol.name = name;
 
-    auto var = new symbols::Constant;
-    var->type = type;
+    auto constant = new symbols::Constant;
+    constant->type = type;
 
-    symbol.value.constant = var;
+    symbol.value.constant = constant;
 
     this->symbol_map.insert(std::make_pair(name, symbol.id));
+
+    return constant;
 }
 
 void Scope_::declare_type(symbols::Type *type) {
@@ -283,6 +287,28 @@ Scope_::declare_fn_cpp_(
     return declare_fn_cpp_(eel_name, cpp_name, return_type, {});
 }
 
+Symbol Scope_::declare_event_cpp(const std::string &eel_name, const std::string &cpp_predicate) {
+    auto root = this->context->root_scope;
+
+    if (!root->find(eel_name).is_nullptr()) {
+        throw InternalError(InternalError::SymbolTable,
+                            fmt::format("Invalid built-in event declaration of `{}`,"
+                                        " symbol by that name already exists.",
+                                        eel_name));
+    }
+
+    auto predicate = new symbols::Function;
+    predicate->return_type = this->context->get_symbol(symbols::Primitive::boolean.id);
+    predicate->scope = this->context->derive_scope(root);
+    predicate->sequence = new Sequence(predicate->scope);
+
+    auto symbol = declare_event(eel_name, predicate);
+    predicate->type_id = fmt::format("{}_predicate", symbol->value.event->id);
+    symbol->value.event->builtin_predicate = cpp_predicate;
+
+    return symbol;
+}
+
 Symbol Scope_::declare_func(const std::string &name, Symbol return_type) {
     auto root = this->context->root_scope;
     auto symbol = root->find(name);
@@ -448,3 +474,7 @@ void SymbolTable::try_resolve_unresolved() {
 size_t SymbolTable::get_scope_count() {
     return this->scopes.size();
 }
+
+size_t SymbolTable::get_symbol_count() {
+    return this->symbols.size();
+}
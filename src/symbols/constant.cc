@@ -0,0 +1,123 @@
+#include <symbols/constant.hpp>
+#include <symbols/type.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace eel::symbols;
+using Value = Constant::Value;
+
+Value Value::from_integer(int64_t value) {
+    Value v;
+    v.kind = Kind::Integer;
+    v.integer = value;
+    return v;
+}
+
+Value Value::from_float(double value) {
+    Value v;
+    v.kind = Kind::Float;
+    v.floating = value;
+    return v;
+}
+
+Value Value::from_bool(bool value) {
+    Value v;
+    v.kind = Kind::Bool;
+    v.boolean = value;
+    return v;
+}
+
+bool Value::is_constant() const {
+    return kind != Kind::None;
+}
+
+bool Value::is_scalar() const {
+    return kind == Kind::Integer || kind == Kind::Float || kind == Kind::Bool;
+}
+
+int64_t Value::as_integer() const {
+    switch (kind) {
+        case Kind::Integer:
+            return integer;
+        case Kind::Float:
+            return static_cast<int64_t>(floating);
+        case Kind::Bool:
+            return boolean;
+        default:
+            return 0;
+    }
+}
+
+double Value::as_float() const {
+    switch (kind) {
+        case Kind::Integer:
+            return static_cast<double>(integer);
+        case Kind::Float:
+            return floating;
+        case Kind::Bool:
+            return boolean;
+        default:
+            return 0;
+    }
+}
+
+bool Value::as_bool() const {
+    switch (kind) {
+        case Kind::Integer:
+            return integer != 0;
+        case Kind::Float:
+            return floating != 0;
+        case Kind::Bool:
+            return boolean;
+        default:
+            return false;
+    }
+}
+
+/// Converts a scalar into the representation of a primitive type.
+static Value convert(const Value& value, const Type* type) {
+    auto i = value.as_integer();
+
+    if (type == &Primitive::u8) return Value::from_integer(static_cast<uint8_t>(i));
+    if (type == &Primitive::u16) return Value::from_integer(static_cast<uint16_t>(i));
+    if (type == &Primitive::u32) return Value::from_integer(static_cast<uint32_t>(i));
+    if (type == &Primitive::u64 || type == &Primitive::usize) return Value::from_integer(i);
+
+    if (type == &Primitive::i8) return Value::from_integer(static_cast<int8_t>(i));
+    if (type == &Primitive::i16) return Value::from_integer(static_cast<int16_t>(i));
+    if (type == &Primitive::i32) return Value::from_integer(static_cast<int32_t>(i));
+    if (type == &Primitive::i64) return Value::from_integer(i);
+
+    if (type == &Primitive::f32) return Value::from_float(static_cast<float>(value.as_float()));
+    if (type == &Primitive::f64) return Value::from_float(value.as_float());
+
+    // Fixed-point values are rounded to the nearest representable value and saturated
+    if (type == &Primitive::q8_8 || type == &Primitive::q16_16) {
+        auto fraction_bits = type == &Primitive::q8_8 ? 8 : 16;
+        auto scale = static_cast<double>(1 << fraction_bits);
+        auto limit = std::ldexp(1.0, type == &Primitive::q8_8 ? 15 : 31);
+        auto raw = std::clamp(std::round(value.as_float() * scale), -limit, limit - 1);
+        return Value::from_float(raw / scale);
+    }
+
+    if (type == &Primitive::boolean) return Value::from_bool(value.as_bool());
+
+    return value;
+}
+
+Value Value::cast(const Type* type) const {
+    if (kind == Kind::None || type == nullptr || type->kind != Type::Kind::Primitive)
+        return *this;
+
+    Value result = *this;
+    if (kind == Kind::Array) {
+        for (auto& element: result.elements)
+            element = element.cast(type);
+    } else {
+        result = convert(*this, type);
+    }
+
+    result.type = dynamic_cast<const Primitive*>(type);
+    return result;
+}
@@ -6,7 +6,7 @@
 using namespace eel::symbols;
 
 static size_t pos_into_key(eel::visitors::SourcePos pos) {
-    return (pos.c << 32) & pos.l;
+    return (pos.c << 32) | pos.l;
 }
 
 void Event::compute_id(Symbol symbol) {
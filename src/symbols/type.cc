@@ -50,6 +50,9 @@ Primitive Primitive::usize("usize");
 Primitive Primitive::f32("f32");
 Primitive Primitive::f64("f64");
 
+Primitive Primitive::q8_8("q8_8");
+Primitive Primitive::q16_16("q16_16");
+
 Primitive Primitive::boolean("bool");
 
 Primitive Primitive::digital("digital", "pin<digital>");
@@ -75,6 +78,9 @@ void Primitive::register_primitives(eel::Scope scope) {
     scope->declare_type(&analog);
 
     scope->declare_type(&usize);
+
+    scope->declare_type(&q8_8);
+    scope->declare_type(&q16_16);
 }
 
 #pragma clang diagnostic pop
\ No newline at end of file
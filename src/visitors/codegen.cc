@@ -1,11 +1,14 @@
 #include <Visitors/codegen.hpp>
+#include <Visitors/const_eval.hpp>
 #include <symbols/event.hpp>
 #include <symbols/variable.hpp>
 #include <symbols/type.hpp>
+#include <symbols/constant.hpp>
 #include <error.hpp>
 #include <sequence.hpp>
 
 #include <unordered_set>
+#include <algorithm>
 #include <fmt/core.h>
 #include <fmt/ostream.h>
 
@@ -15,8 +18,8 @@ using std::any;
 
 const char *kind_labels[] = {
         "None", "Variable", "Constant",
-        "Function", "Type", "Namespace",
-        "Event", "Indirect"
+        "Function", "ExternFunction", "Type",
+        "Namespace", "Event", "Indirect"
 };
 
 /// \brief Generates a functor type for a synchronous function.
@@ -43,9 +46,106 @@ static void generate_async_functor_type(
 
 static void close_open_async_case(CodegenVisitor &visitor);
 
+/// Generates the dispatch of every event for one iteration of the main loop.
+static void generate_dispatch(CodegenVisitor &visitor);
+
+/// Latches the emits of the emitted events, such that every handle and `await`
+/// of the following pass observes the same emits.
+static void generate_emit_latch(CodegenVisitor &visitor);
+
+/// Emits the per-tick sampling of the pins read by predicates.
+static void generate_input_sampling(CodegenVisitor &visitor);
+
+/// Generates the handles, predicate and field of an event.
+/// \param ctx The declaration of the event, `nullptr` for built-in events.
+static void generate_event(CodegenVisitor &visitor, Symbol symbol, eelParser::EventDeclContext *ctx);
+
+/// Whether code is generated for the event, which requires it to be used (awaited or handled) and reachable.
+static bool is_generated(CodegenVisitor &visitor, const symbols::Event *event);
+
+/// Generates a print in async code that yields until the text fits into the TX buffer.
+/// \returns Whether the statement is such a print.
+static bool generate_async_serial_print(CodegenVisitor &visitor, eelParser::StmtContext *ctx);
+
+/// Emits a case that retries `try_print` until it succeeds, yielding in between.
+static void generate_yielding_print(CodegenVisitor &visitor, const std::string &try_print);
+
+/// Whether the statement is a `serial_print` or `serial_println` of at most one value,
+/// which can be merged with adjacent ones by `generate_serial_print_run`.
+static bool is_coalescable_print(CodegenVisitor &visitor, eelParser::StmtContext *ctx);
+
+/// Generates a run of adjacent prints as a single `serial_print_all`, merging constant text
+/// into string literals that are placed in flash.
+static void generate_serial_print_run(CodegenVisitor &visitor, const std::vector<eelParser::StmtContext *> &run);
+
+/// Assigns a message id to a call of `emit_telemetry` and records its fields for the schema.
+/// \returns The arguments of `telemetry_emit`, the id followed by the values cast to their field types.
+static std::string generate_telemetry_args(CodegenVisitor &visitor, eelParser::FnCallExprContext *call);
+
+/// Points the following code at the line of `ctx` in the EEL source, if source mapping is enabled.
+static void generate_line_directive(CodegenVisitor &visitor, antlr4::ParserRuleContext *ctx);
+
+/// Marks the following code as not originating from the EEL source, if source mapping is enabled.
+static void generate_glue_line_directive(CodegenVisitor &visitor);
+
+/// Records the EEL name of a generated identifier, if source mapping is enabled.
+static void map_source(CodegenVisitor &visitor, std::string generated, std::string kind, std::string name,
+                       antlr4::ParserRuleContext *ctx);
+
+/// Emits a while loop that runs until its condition fails or the time slice
+/// of the current scheduler turn is used up, in which case it resumes on the next turn.
+static void generate_emit_latch(CodegenVisitor &visitor) {
+    if (visitor.emitted_events.empty())
+        return;
+
+    fmt::print(*visitor.stream, "latch_emits(");
+    for (size_t i = 0; i < visitor.emitted_events.size(); i++)
+        fmt::print(*visitor.stream, "{}{}", i == 0 ? "" : ", ", visitor.emitted_events[i]->id);
+    fmt::print(*visitor.stream, ");\n");
+}
+
+void generate_sliced_while(CodegenVisitor &visitor, const std::string &condition,
+                                  eelParser::StmtBlockContext *body);
+
+/// Generates a binary operation. If arithmetic narrowing is enabled and range analysis
+/// shows that the operands and result fit a narrower type, the operation is carried
+/// out in that type and the result is converted back to the original type.
+static std::string generate_binary_expr(
+        CodegenVisitor &visitor,
+        eelParser::ExprContext *ctx,
+        eelParser::ExprContext *left,
+        const std::string &op,
+        eelParser::ExprContext *right,
+        bool is_shift = false
+);
+
+/// Generates a division or modulo by a positive compile-time constant
+/// as a call to the `div_const`/`mod_const` runtime templates.
+/// \returns The generated code, or an empty string if the divisor is not a suitable constant.
+static std::string generate_constant_division(CodegenVisitor &visitor, eelParser::ScalingExprContext *ctx);
+
+/// The unsigned type of the same width as the operand, which logical shifts are performed in.
+static std::string logical_shift_type(CodegenVisitor &visitor, eelParser::ExprContext *operand);
+
+/// Generates an assignment. Writes to variables read by cached event predicates
+/// invalidate the cached results of those predicates.
+static std::string generate_assignment(CodegenVisitor &visitor, eelParser::ExprContext *target,
+                                       const std::string &assignment);
+
+/// Generates a compound assignment (`+=`, `>>=`, ...).
+static std::string generate_compound_assignment(CodegenVisitor &visitor, eelParser::ExprContext *target,
+                                                const std::string &op, eelParser::ExprContext *right);
+
 /// Generate a variable identifier, for use in the generated c++ code.
 static std::string generate_variable_id(Symbol symbol);
 
+/// Emits the definitions of all constants at the top of the program.
+/// Scalars become `constexpr` values and arrays are placed in flash.
+static void generate_constants(std::iostream *stream, SymbolTable &table);
+
+/// Formats a compile-time computed value as a c++ literal.
+static std::string generate_constant_value(const symbols::Constant::Value &value, const symbols::Type *type);
+
 /// Check if a Symbol is non-null and is of correct kind.
 /// \throws InternalError If null or kind != expected_kind
 static void check_symbol(Symbol symbol, Symbol_::Kind expected_kind, const std::string &identifier);
@@ -55,19 +155,38 @@ static void resolve(Symbol &symbol, SymbolTable &table);
 
 
 CodegenVisitor::CodegenVisitor(eel::SymbolTable &table, std::iostream *stream)
-        : table(table), stream(stream) {
+        : table(table), stream(stream), ranges(table.root_scope) {
     current_scope = table.root_scope;
 
     auto size_type = table.get_symbol(symbols::Primitive::usize.id);
     auto u32_type = table.get_symbol(symbols::Primitive::u32.id);
+    auto bool_type = table.get_symbol(symbols::Primitive::boolean.id);
+    auto u8_type = table.get_symbol(symbols::Primitive::u8.id);
+    auto i32_type = table.get_symbol(symbols::Primitive::i32.id);
+    auto f32_type = table.get_symbol(symbols::Primitive::f32.id);
 
     // Parameter types are currently omitted for print function due
     // to not having a way of handling overloaded functions.
     // This works exclusively because type checking has not been
     // implemented.
-    current_scope->declare_fn_cpp("serial_print", "Serial.print", size_type);
-    current_scope->declare_fn_cpp("serial_println", "Serial.println", size_type);
+    // In async code prints yield while the TX buffer is full instead (see `generate_async_serial_print`)
+    current_scope->declare_fn_cpp("serial_print", "serial_print", size_type);
+    current_scope->declare_fn_cpp("serial_println", "serial_println", size_type);
     current_scope->declare_fn_cpp("serial_begin", "Serial.begin", size_type, u32_type);
+    current_scope->declare_fn_cpp("serial_writable", "serial_writable", bool_type, size_type);
+    current_scope->declare_fn_cpp("serial_dropped", "serial_dropped", u32_type);
+
+    // Serial input, the `serial_data` and `serial_line` events are declared by `ScopeVisitor`
+    current_scope->declare_fn_cpp("serial_poll_data", "serial_poll_data", bool_type);
+    current_scope->declare_fn_cpp("serial_poll_line", "serial_poll_line", bool_type);
+    current_scope->declare_fn_cpp("serial_view_length", "serial_view_length", size_type);
+    current_scope->declare_fn_cpp("serial_view_at", "serial_view_at", u8_type, size_type);
+    current_scope->declare_fn_cpp("serial_has_number", "serial_has_number", bool_type);
+    current_scope->declare_fn_cpp("serial_next_int", "serial_next_int", i32_type);
+    current_scope->declare_fn_cpp("serial_next_float", "serial_next_float", f32_type);
+
+    // Calls are rewritten to carry their message id, see `generate_telemetry_args`
+    current_scope->declare_fn_cpp("emit_telemetry", "telemetry_emit", size_type);
 }
 
 any CodegenVisitor::visitProgram(eelParser::ProgramContext *ctx) {
@@ -77,7 +196,58 @@ any CodegenVisitor::visitProgram(eelParser::ProgramContext *ctx) {
     pre_include_hook();
 
     fmt::print(*stream, "#include <runtime/all.hpp>\n");
+    generate_constants(stream, table);
+
+    if (!cached_predicates.empty())
+        fmt::print(*stream, "StatusFlags<{}> __predicate_cache {{}};\n", cached_predicates.size());
+
+    if (profile) {
+        // The table is declared up front as the instrumented types refer to it
+        size_t event_count = 0;
+        size_t handle_count = 0;
+        for (size_t i = 0; i < table.get_symbol_count(); i++) {
+            auto symbol = table.get_symbol(i);
+            if (symbol->kind != Symbol_::Kind::Event || !is_generated(*this, symbol->value.event))
+                continue;
+
+            event_count++;
+            for (auto &handle: symbol->value.event->get_handles())
+                handle_count += !dead_functions.contains(&handle.second);
+        }
+        fmt::print(*stream, "ProfileTable<{}, {}> __profile {{}};\n", event_count, handle_count);
+    }
+
+    if (trace)
+        fmt::print(*stream, "TraceBuffer<EEL_TRACE_CAPACITY> __trace {{}};\n");
+
+    if (!snapshot_pins.empty()) {
+        fmt::print(*stream, "DigitalSnapshot<");
+        for (size_t i = 0; i < snapshot_pins.size(); i++)
+            fmt::print(*stream, "{}{}", i == 0 ? "" : ", ", snapshot_pins[i].second);
+        fmt::print(*stream, "> __inputs {{}};\n");
+    }
+
     visitChildren(ctx);
+    generate_glue_line_directive(*this);
+
+    // Built-in events have no declaration in the source
+    for (size_t i = 0; i < table.get_symbol_count(); i++) {
+        auto symbol = table.get_symbol(i);
+        if (symbol->kind == Symbol_::Kind::Event && !symbol->value.event->builtin_predicate.empty())
+            generate_event(*this, symbol, nullptr);
+    }
+
+    // Events are dispatched in declaration order within the same priority
+    std::stable_sort(events.begin(), events.end(), [](auto a, auto b) { return a->priority > b->priority; });
+    if (!events.empty() && events.front()->priority != events.back()->priority) {
+        while (events[urgent_event_count]->priority == events.front()->priority)
+            urgent_event_count++;
+
+        fmt::print(*stream, "\nstatic void __dispatch_urgent() {{");
+        for (size_t i = 0; i < urgent_event_count; i++)
+            fmt::print(*stream, "run_handles<decltype({event_id})>({event_id});", fmt::arg("event_id", events[i]->id));
+        fmt::print(*stream, "}}\n");
+    }
 
     fmt::print(*stream, "\nint main(void) {{\n");
 
@@ -89,14 +259,16 @@ any CodegenVisitor::visitProgram(eelParser::ProgramContext *ctx) {
         auto f = setup->value.function;
         if (f->is_async()) {
             fmt::print(*stream, "{setup_type}::State {setup_state} {{}};\n"
-                                "while (!{setup_type}::step({setup_state})) {{\n",
+                                "while (!{setup_type}::step({setup_state})) {{\n"
+                                "loop_tick();\n",
                        fmt::arg("setup_type", f->type_id),
                        fmt::arg("setup_state", setup_state_id));
 
-            for (auto event: events) {
-                fmt::print(*stream, "run_handles<decltype({event_id}})>({event_id}});\n",
-                           fmt::arg("event_id", event->id));
-            }
+            if (!sliced_loops.empty())
+                fmt::print(*stream, "begin_time_slice();\n");
+            generate_input_sampling(*this);
+            generate_emit_latch(*this);
+            generate_dispatch(*this);
 
             fmt::print(*stream, "}}\n");
         } else {
@@ -114,12 +286,19 @@ any CodegenVisitor::visitProgram(eelParser::ProgramContext *ctx) {
         }
     }
 
-    fmt::print(*stream, "while (true) {{\n");
+    fmt::print(*stream, "while (true) {{\n"
+                        "loop_tick();\n");
 
-    for (auto event: events) {
-        fmt::print(*stream, "run_handles<decltype({event_id})>({event_id});\n",
-                   fmt::arg("event_id", event->id));
-    }
+    if (!sliced_loops.empty())
+        fmt::print(*stream, "begin_time_slice();\n");
+    if (profile)
+        fmt::print(*stream, "profile_loop(__profile);\n"
+                            "profile_poll(__profile);\n");
+    if (trace)
+        fmt::print(*stream, "trace_poll(__trace);\n");
+    generate_input_sampling(*this);
+    generate_emit_latch(*this);
+    generate_dispatch(*this);
 
     if (!loop.is_nullptr()) {
         auto f = loop->value.function;
@@ -185,7 +364,8 @@ any CodegenVisitor::visitIdentifier(eelParser::IdentifierContext *ctx) {
 
         while (current != state_root->parent) {
             symbol = current->find_member(identifier);
-            if (!symbol.is_nullptr()) {
+            // Constants are hoisted out of the function and are never part of the state
+            if (!symbol.is_nullptr() && symbol->kind != Symbol_::Kind::Constant) {
                 is_in_async_state = true;
                 break;
             }
@@ -199,6 +379,8 @@ any CodegenVisitor::visitIdentifier(eelParser::IdentifierContext *ctx) {
     }
 
     resolve(symbol, table);
+    if (!symbol.is_nullptr() && symbol->kind == Symbol_::Kind::Constant)
+        return generate_variable_id(symbol);
     check_symbol(symbol, Symbol_::Kind::Variable, identifier);
 
     auto id = generate_variable_id(symbol);
@@ -220,6 +402,9 @@ any CodegenVisitor::visitFnCallExpr(eelParser::FnCallExprContext *ctx) {
 
     auto fn = symbol->value.extern_function;
 
+    if (fn->target_id() == "telemetry_emit")
+        return fmt::format("telemetry_emit({})", generate_telemetry_args(*this, ctx));
+
     std::string params;
     if (ctx->params)
         params = std::any_cast<std::string>(visit(ctx->params));
@@ -233,11 +418,58 @@ any CodegenVisitor::visitAssignExpr(eelParser::AssignExprContext *ctx) {
     auto lop = std::any_cast<std::string>(visit(ctx->var));
     auto rop = std::any_cast<std::string>(visit(ctx->right));
 
-    return fmt::format("{} = {}", lop, rop);
+    return generate_assignment(*this, ctx->var, fmt::format("{} = {}", lop, rop));
+}
+
+any CodegenVisitor::visitAdditiveAssignExpr(eelParser::AdditiveAssignExprContext *ctx) {
+    return generate_compound_assignment(*this, ctx->var, ctx->op->getText(), ctx->right);
+}
+
+any CodegenVisitor::visitScalingAssignExpr(eelParser::ScalingAssignExprContext *ctx) {
+    return generate_compound_assignment(*this, ctx->var, ctx->op->getText(), ctx->right);
+}
+
+any CodegenVisitor::visitShiftingAssignExpr(eelParser::ShiftingAssignExprContext *ctx) {
+    return generate_compound_assignment(*this, ctx->var, ctx->op->getText(), ctx->right);
+}
+
+any CodegenVisitor::visitOrAssignExpr(eelParser::OrAssignExprContext *ctx) {
+    return generate_compound_assignment(*this, ctx->var, "|=", ctx->right);
+}
+
+any CodegenVisitor::visitAndAssignExpr(eelParser::AndAssignExprContext *ctx) {
+    return generate_compound_assignment(*this, ctx->var, "&=", ctx->right);
+}
+
+any CodegenVisitor::visitXorAssignExpr(eelParser::XorAssignExprContext *ctx) {
+    return generate_compound_assignment(*this, ctx->var, "^=", ctx->right);
+}
+
+any CodegenVisitor::visitArrayExpr(eelParser::ArrayExprContext *ctx) {
+    auto array = std::any_cast<std::string>(visit(ctx->fqn()));
+    auto index = std::any_cast<std::string>(visit(ctx->expr()));
+
+    // Constant tables live in flash and have to be read through `progmem_read`
+    auto symbol = resolve_fqn(current_scope, ctx->fqn());
+    if (!symbol.is_nullptr() && symbol->kind == Symbol_::Kind::Constant)
+        return fmt::format("progmem_read(&{}[{}])", array, index);
+
+    return fmt::format("{}[{}]", array, index);
 }
 
 any CodegenVisitor::visitReadPinExpr(eelParser::ReadPinExprContext *ctx) {
-    auto identifier = std::any_cast<std::string>(ctx->fqn());
+    auto identifier = std::any_cast<std::string>(visit(ctx->fqn()));
+
+    auto symbol = resolve_fqn(current_scope, ctx->fqn());
+    if (is_in_event_code && !symbol.is_nullptr()) {
+        for (size_t i = 0; i < snapshot_pins.size(); i++) {
+            if (snapshot_pins[i].first == symbol->id)
+                return fmt::format("__inputs.read<{}>()", i);
+        }
+        if (std::find(sampled_pins.begin(), sampled_pins.end(), symbol->id) != sampled_pins.end())
+            return fmt::format("SampledPin<{}>::value", identifier);
+    }
+
     return fmt::format("{}.read()", identifier);
 }
 
@@ -254,17 +486,16 @@ any CodegenVisitor::visitNeg(eelParser::NegContext *ctx) {
 }
 
 any CodegenVisitor::visitScalingExpr(eelParser::ScalingExprContext *ctx) {
-    return fmt::format("({}){}({})",
-                       std::any_cast<std::string>(visit(ctx->left)),
-                       ctx->op->getText(),
-                       std::any_cast<std::string>(visit(ctx->right)));
+    if (ctx->op->getText() != "*") {
+        auto reduced = generate_constant_division(*this, ctx);
+        if (!reduced.empty())
+            return reduced;
+    }
+    return generate_binary_expr(*this, ctx, ctx->left, ctx->op->getText(), ctx->right);
 }
 
 any CodegenVisitor::visitAdditiveExpr(eelParser::AdditiveExprContext *ctx) {
-    return fmt::format("({}){}({})",
-                       std::any_cast<std::string>(visit(ctx->left)),
-                       ctx->op->getText(),
-                       std::any_cast<std::string>(visit(ctx->right)));
+    return generate_binary_expr(*this, ctx, ctx->left, ctx->op->getText(), ctx->right);
 }
 
 /*
@@ -299,19 +530,25 @@ any CodegenVisitor::visitNot(eelParser::NotContext *ctx) {
  */
 
 any CodegenVisitor::visitAndExpr(eelParser::AndExprContext *ctx) {
-    return fmt::format("({})&({})",
-                       std::any_cast<std::string>(visit(ctx->left)),
-                       std::any_cast<std::string>(visit(ctx->right)));
+    return generate_binary_expr(*this, ctx, ctx->left, "&", ctx->right);
 }
 
 any CodegenVisitor::visitOrExpr(eelParser::OrExprContext *ctx) {
-    return fmt::format("({})|({})",
-                       std::any_cast<std::string>(visit(ctx->left)),
-                       std::any_cast<std::string>(visit(ctx->right)));
+    return generate_binary_expr(*this, ctx, ctx->left, "|", ctx->right);
 }
 
 any CodegenVisitor::visitXorExpr(eelParser::XorExprContext *ctx) {
-    return fmt::format("({})^({})",
+    return generate_binary_expr(*this, ctx, ctx->left, "^", ctx->right);
+}
+
+any CodegenVisitor::visitShiftingExpr(eelParser::ShiftingExprContext *ctx) {
+    auto op = ctx->op->getText();
+    if (op != ">>>")
+        return generate_binary_expr(*this, ctx, ctx->left, op, ctx->right, true);
+
+    // Logical shifts are performed on the unsigned equivalent of the left operand
+    return fmt::format("(static_cast<{}>({}))>>({})",
+                       logical_shift_type(*this, ctx->left),
                        std::any_cast<std::string>(visit(ctx->left)),
                        std::any_cast<std::string>(visit(ctx->right)));
 }
@@ -334,11 +571,9 @@ any CodegenVisitor::visitCastExpr(eelParser::CastExprContext *ctx) {
 
 any CodegenVisitor::visitExprList(eelParser::ExprListContext *ctx) {
     std::stringstream s;
-    fmt::print(s, std::any_cast<std::string>(visit(ctx->expr())));
-    if (ctx->exprList()) {
-        fmt::print(s, ",");
-        visit(ctx->exprList());
-    }
+    fmt::print(s, "{}", std::any_cast<std::string>(visit(ctx->expr())));
+    if (ctx->exprList())
+        fmt::print(s, ",{}", std::any_cast<std::string>(visit(ctx->exprList())));
 
     return s.str();
 }
@@ -355,8 +590,19 @@ any CodegenVisitor::visitVariableDecl(eelParser::VariableDeclContext *ctx) {
     auto variable = symbol->value.variable;
     auto type = variable->type;
 
+    map_source(*this, generate_variable_id(symbol), "variable", identifier, ctx);
+    // Locals are covered by the directive of their statement
+    if (current_sequence == nullptr)
+        generate_line_directive(*this, ctx);
+
     if (current_sequence == nullptr || current_sequence->current_point->kind == SequencePoint::SyncPoint) {
-        if (variable->has_value) {
+        auto initial_value = initial_values.find(symbol->id);
+        if (current_sequence == nullptr && initial_value != initial_values.end()) {
+            fmt::print(*stream, "{} {} = {};",
+                       type->value.type->type_target_name(),
+                       generate_variable_id(symbol),
+                       generate_constant_value(initial_value->second, type->value.type));
+        } else if (variable->has_value) {
             fmt::print(*stream, "{} {} = {};",
                        type->value.type->type_target_name(),
                        generate_variable_id(symbol),
@@ -375,9 +621,15 @@ any CodegenVisitor::visitVariableDecl(eelParser::VariableDeclContext *ctx) {
     return {};
 }
 
-any CodegenVisitor::visitSetupDecl(eelParser::SetupDeclContext *) {
+any CodegenVisitor::visitConstDecl(eelParser::ConstDeclContext *) {
+    // Constants are emitted up front by `generate_constants`
+    return {};
+}
+
+any CodegenVisitor::visitSetupDecl(eelParser::SetupDeclContext *ctx) {
     auto symbol = current_scope->find("__eel_setup");
     auto func = symbol->value.function;
+    map_source(*this, func->type_id, "setup", "setup", ctx);
 
     if (func->sequence->start->kind == SequencePoint::AsyncPoint) {
         generate_async_functor_type(stream, *func, *this);
@@ -388,9 +640,10 @@ any CodegenVisitor::visitSetupDecl(eelParser::SetupDeclContext *) {
     return {};
 }
 
-any CodegenVisitor::visitLoopDecl(eelParser::LoopDeclContext *) {
+any CodegenVisitor::visitLoopDecl(eelParser::LoopDeclContext *ctx) {
     auto symbol = current_scope->find("__eel_loop");
     auto func = symbol->value.function;
+    map_source(*this, func->type_id, "loop", "loop", ctx);
 
     if (func->sequence->start->kind == SequencePoint::AsyncPoint) {
         generate_async_functor_type(stream, *func, *this);
@@ -415,6 +668,8 @@ any CodegenVisitor::visitPinDecl(eelParser::PinDeclContext *ctx) {
 
     auto pin_id = std::any_cast<std::string>(visitChildren(ctx->expr()));
 
+    map_source(*this, generate_variable_id(symbol), "pin", identifier, ctx);
+    generate_line_directive(*this, ctx);
     fmt::print(*stream,
                "{} {} {{ {} }};",
                type_v->type_target_name(),
@@ -430,60 +685,10 @@ any CodegenVisitor::visitEventDecl(eelParser::EventDeclContext *ctx) {
     if (symbol->kind != Symbol_::Kind::Event)
         throw InternalError(InternalError::Codegen, "Invalid symbol. Expected event.");
 
-    auto event = symbol->value.event;
-    if (!event->is_complete)
-        throw InternalError(InternalError::Codegen, "Incomplete event encountered during codegen.");
-
-    events.push_back(event);
-
-    // If the event is never used (no `awaits` or `on` blocks)
-    // don't bother generating the event.
-    // TODO re-enable this check once is_awaited is updated properly
-    // if (!event->is_awaited && event->get_handles().empty())
-    //    return {};
-
-    auto block = ctx->stmtBlock();
-    if (block == nullptr)
-        event->has_predicate = false; // TODO ensure that this has not already been done (no point in doing it twice)
-
-    static const std::string predicateless_type = "PredicateLess";
-    std::stringstream event_state;
-
-    fmt::print(event_state, "struct {}_handle_state {{", event->id);
-
-    // Generate function types for event handles
-    auto &handles = event->get_handles();
-    for (auto &handle: handles) {
-        if (handle.second.sequence->start->kind == SequencePoint::AsyncPoint) {
-            fmt::print(event_state, "{}::State {};", handle.second.type_id, handle.second.type_id);
-            generate_async_functor_type(stream, handle.second, *this);
-        } else {
-            generate_sync_functor_type(stream, handle.second, *this);
-        }
-    }
-
-    fmt::print(event_state, "}};");
-
-    auto predicate_type = predicateless_type;
-    if (event->has_predicate) {
-        predicate_type = event->predicate->type_id;
-        if (event->predicate->sequence->start->kind == SequencePoint::AsyncPoint) {
-            generate_async_functor_type(stream, *event->predicate, *this);
-        } else {
-            generate_sync_functor_type(stream, *event->predicate, *this);
-        }
-    }
-
-    fmt::print(*stream, "{}", event_state.str());
-
-    // Generate the event field
-    fmt::print(*stream, "Event<{}, {}_handle_state", predicate_type, event->id);
-    for (auto &handle: handles) {
-        fmt::print(*stream, ", {}", handle.second.type_id);
-    }
-
-    fmt::print(*stream, "> {} {{}};\n", event->id);
+    if (ctx->stmtBlock() == nullptr)
+        symbol->value.event->has_predicate = false; // TODO ensure that this has not already been done (no point in doing it twice)
 
+    generate_event(*this, symbol, ctx);
     return {};
 }
 
@@ -492,11 +697,26 @@ any CodegenVisitor::visitOnDecl(eelParser::OnDeclContext *) {
     return {};
 }
 
+any CodegenVisitor::visitFnDecl(eelParser::FnDeclContext *ctx) {
+    if (dead_declarations.contains(ctx))
+        return {};
+
+    throw InternalError(InternalError::Codegen, "Non external functions are not currently supported.");
+}
+
 /*
  * Statements
  */
 
 any CodegenVisitor::visitStmt(eelParser::StmtContext *ctx) {
+    if (elided_statements.contains(ctx))
+        return {};
+
+    generate_line_directive(*this, ctx);
+
+    if (generate_async_serial_print(*this, ctx))
+        return {};
+
     if (current_sequence->current_block->is_async()
         && (!current_sequence->is_next_yield() || current_sequence->current_point->kind == SequencePoint::YieldPoint)
         && !is_in_async_state_case) {
@@ -514,6 +734,21 @@ any CodegenVisitor::visitStmt(eelParser::StmtContext *ctx) {
     return {};
 }
 
+any CodegenVisitor::visitStmtsOrLDecls(eelParser::StmtsOrLDeclsContext *ctx) {
+    std::vector<eelParser::StmtContext *> run;
+    auto rest = ctx;
+    while (rest != nullptr && rest->stmt() != nullptr && is_coalescable_print(*this, rest->stmt())) {
+        run.push_back(rest->stmt());
+        rest = rest->stmtsOrLDecls();
+    }
+
+    if (run.empty())
+        return visitChildren(ctx);
+
+    generate_serial_print_run(*this, run);
+    return rest != nullptr ? visit(rest) : any {};
+}
+
 any CodegenVisitor::visitStmtBlock(eelParser::StmtBlockContext *ctx) {
     auto sequence_point = dynamic_cast<Block *>(current_sequence->next());
 
@@ -538,6 +773,21 @@ any CodegenVisitor::visitStmtBlock(eelParser::StmtBlockContext *ctx) {
     return {};
 }
 
+any CodegenVisitor::visitEmitStmt(eelParser::EmitStmtContext *ctx) {
+    auto identifier = ctx->fqn()->getText();
+    auto symbol = resolve_fqn(table.root_scope, ctx->fqn());
+
+    resolve(symbol, table);
+    check_symbol(symbol, Symbol_::Kind::Event, identifier);
+
+    auto event = symbol->value.event;
+    if (std::find(emitted_events.begin(), emitted_events.end(), event) == emitted_events.end())
+        emitted_events.push_back(event);
+
+    fmt::print(*stream, "{}.emit();", event->id);
+    return {};
+}
+
 any CodegenVisitor::visitAwaitStmt(eelParser::AwaitStmtContext *ctx) {
     auto sequence_point = current_sequence->next();
 
@@ -705,7 +955,9 @@ any CodegenVisitor::visitWhileStmt(eelParser::WhileStmtContext *ctx) {
     auto const stmt = ctx->stmtBlock();
 
     auto seq = current_sequence->next();
-    if (seq->is_async()) {
+    if (sliced_loops.contains(ctx) && current_sequence->start->is_async()) {
+        generate_sliced_while(*this, cond_expr, stmt);
+    } else if (seq->is_async()) {
         close_open_async_case(*this);
 
         auto while_starting_case = async_state_counter++;
@@ -777,12 +1029,490 @@ any CodegenVisitor::visitSetPinNumberStmt(eelParser::SetPinNumberStmtContext *ct
  * Helper functions
  */
 
+std::string logical_shift_type(CodegenVisitor &visitor, eelParser::ExprContext *operand) {
+    visitor.ranges.scope = visitor.current_scope;
+    switch (integer_width(visitor.ranges.evaluate(operand).type)) {
+        case 8: return "u8";
+        case 16: return "u16";
+        case 32: return "u32";
+        case 64: return "u64";
+        default: return "unsigned";
+    }
+}
+
+std::string generate_assignment(CodegenVisitor &visitor, eelParser::ExprContext *target,
+                                const std::string &assignment) {
+    if (visitor.predicate_dependents.empty())
+        return assignment;
+
+    eelParser::FqnContext *fqn = nullptr;
+    if (auto variable = dynamic_cast<eelParser::FqnExprContext *>(target))
+        fqn = variable->fqn();
+    else if (auto element = dynamic_cast<eelParser::ArrayExprContext *>(target))
+        fqn = element->fqn();
+    if (fqn == nullptr)
+        return assignment;
+
+    // Only globals are read by predicates
+    auto symbol = resolve_fqn(visitor.current_scope, fqn);
+    if (symbol.is_nullptr() || visitor.table.root_scope->find_member(symbol->name) != symbol)
+        return assignment;
+
+    auto dependents = visitor.predicate_dependents.find(symbol->id);
+    if (dependents == visitor.predicate_dependents.end())
+        return assignment;
+
+    std::string indices;
+    for (auto index: dependents->second)
+        indices += fmt::format("{}{}", indices.empty() ? "" : ", ", index);
+
+    return fmt::format("invalidate<{}>(__predicate_cache, {})", indices, assignment);
+}
+
+std::string generate_compound_assignment(CodegenVisitor &visitor, eelParser::ExprContext *target,
+                                         const std::string &op, eelParser::ExprContext *right) {
+    auto lop = std::any_cast<std::string>(visitor.visit(target));
+    auto rop = std::any_cast<std::string>(visitor.visit(right));
+
+    if (op != ">>>=")
+        return generate_assignment(visitor, target, fmt::format("{} {} ({})", lop, op, rop));
+
+    // C++ has no logical shift operator, so the shift is performed in the unsigned type
+    return generate_assignment(visitor, target, fmt::format("{lop} = static_cast<{unsigned_type}>({lop}) >> ({rop})",
+                                                            fmt::arg("lop", lop),
+                                                            fmt::arg("unsigned_type", logical_shift_type(visitor, target)),
+                                                            fmt::arg("rop", rop)));
+}
+
+void generate_dispatch(CodegenVisitor &visitor) {
+    // The highest priority events are checked before every other event
+    for (size_t i = visitor.urgent_event_count; i < visitor.events.size(); i++) {
+        if (visitor.urgent_event_count > 0)
+            fmt::print(*visitor.stream, "__dispatch_urgent();\n");
+        fmt::print(*visitor.stream, "run_handles<decltype({event_id})>({event_id});\n",
+                   fmt::arg("event_id", visitor.events[i]->id));
+    }
+}
+
+void generate_sliced_while(CodegenVisitor &visitor, const std::string &condition,
+                           eelParser::StmtBlockContext *body) {
+    // The loop gets its own case to resume at, entered by falling through from the current one
+    auto resume_case = visitor.async_state_counter++;
+    visitor.sliced_cases.push_back(resume_case);
+    if (visitor.is_in_async_state_case) {
+        fmt::print(*visitor.stream, "state.s = {}; }} [[fallthrough]];", resume_case);
+        visitor.is_in_async_state_case = false;
+    }
+
+    // The body runs at least once per turn, `continue` also checks the time slice
+    fmt::print(*visitor.stream,
+               "case {}: {{ bool __expired = false;"
+               "do {{ if (!({})) break;",
+               resume_case,
+               condition);
+    visitor.visitChildren(body);
+    fmt::print(*visitor.stream, "}} while (!(__expired = time_slice_expired()));"
+                                "if (__expired) return 0;");
+
+    // Statements following the loop continue within the case
+    visitor.is_in_async_state_case = true;
+}
+
+void generate_line_directive(CodegenVisitor &visitor, antlr4::ParserRuleContext *ctx) {
+    if (visitor.source_path.empty())
+        return;
+
+    std::string path;
+    for (auto c: visitor.source_path) {
+        if (c == '\\' || c == '"')
+            path += '\\';
+        path += c;
+    }
+
+    // Directives have to be on a line of their own
+    fmt::print(*visitor.stream, "\n#line {} \"{}\"\n", get_source_location(ctx->getStart()).l, path);
+}
+
+void generate_glue_line_directive(CodegenVisitor &visitor) {
+    if (!visitor.source_path.empty())
+        fmt::print(*visitor.stream, "\n#line 1 \"<generated>\"\n");
+}
+
+void map_source(CodegenVisitor &visitor, std::string generated, std::string kind, std::string name,
+                antlr4::ParserRuleContext *ctx) {
+    if (visitor.source_path.empty())
+        return;
+
+    visitor.source_map.push_back({std::move(generated), std::move(kind), std::move(name),
+                                  get_source_location(ctx->getStart()).l});
+}
+
+bool generate_async_serial_print(CodegenVisitor &visitor, eelParser::StmtContext *ctx) {
+    // Statements in blocks without awaits are not split into cases, so they can't yield
+    if (visitor.current_sequence == nullptr || !visitor.current_sequence->current_block->is_async())
+        return false;
+
+    auto call = dynamic_cast<eelParser::FnCallExprContext *>(ctx->expr());
+    if (call == nullptr)
+        return false;
+
+    auto symbol = resolve_fqn(visitor.current_scope, call->fqn());
+    if (symbol.is_nullptr() || symbol->kind != Symbol_::Kind::ExternFunction)
+        return false;
+
+    auto &target = symbol->value.extern_function->target_id();
+    if (target == "telemetry_emit") {
+        generate_yielding_print(visitor, fmt::format("telemetry_try_emit({})", generate_telemetry_args(visitor, call)));
+        return true;
+    }
+
+    if (target != "serial_print" && target != "serial_println")
+        return false;
+
+    std::string params;
+    if (call->params)
+        params = std::any_cast<std::string>(visitor.visit(call->params));
+
+    generate_yielding_print(visitor, fmt::format("serial_try_{}({})",
+                                                 target == "serial_print" ? "print" : "println", params));
+    return true;
+}
+
+/// The type a telemetry value is sent as. Types that differ in size between
+/// targets are widened, untyped integer expressions take the smallest type holding their range.
+static const symbols::Primitive *telemetry_type(CodegenVisitor &visitor, eelParser::ExprContext *expr) {
+    using symbols::Primitive;
+
+    visitor.ranges.scope = visitor.current_scope;
+    auto range = visitor.ranges.evaluate(expr);
+    auto type = range.type;
+
+    if (auto call = dynamic_cast<eelParser::FnCallExprContext *>(expr)) {
+        auto symbol = resolve_fqn(visitor.current_scope, call->fqn());
+        if (!symbol.is_nullptr() && symbol->kind == Symbol_::Kind::ExternFunction) {
+            auto return_type = symbol->value.extern_function->return_type;
+            if (!return_type.is_nullptr() && return_type->kind == Symbol_::Kind::Type)
+                type = dynamic_cast<const Primitive *>(return_type->value.type);
+        }
+    }
+
+    if (type == nullptr) {
+        if (dynamic_cast<eelParser::FloatLiteralContext *>(expr) != nullptr)
+            return &Primitive::f32;
+        if (dynamic_cast<eelParser::BoolLiteralContext *>(expr) != nullptr)
+            return &Primitive::boolean;
+        if (dynamic_cast<eelParser::CharLiteralContext *>(expr) != nullptr)
+            return &Primitive::u8;
+
+        for (auto candidate: {&Primitive::u8, &Primitive::i8, &Primitive::u16, &Primitive::i16, &Primitive::u32}) {
+            if (range.bounded && Range::of_type(candidate).contains(range))
+                return candidate;
+        }
+        return &Primitive::i32;
+    }
+
+    if (type == &Primitive::digital || type == &Primitive::analog)
+        throw InternalError(InternalError::Codegen, "Pins cannot be sent as telemetry.");
+    if (type == &Primitive::usize)
+        return &Primitive::u32;
+    return type;
+}
+
+std::string generate_telemetry_args(CodegenVisitor &visitor, eelParser::FnCallExprContext *call) {
+    auto &messages = visitor.telemetry_messages;
+    auto message = std::find_if(messages.begin(), messages.end(), [&](auto &m) { return m.call == call; });
+    auto params = flatten_expr_list(call->params);
+
+    if (message == messages.end()) {
+        if (messages.size() > UINT8_MAX)
+            throw InternalError(InternalError::Codegen, "A program can have at most 256 telemetry messages.");
+
+        CodegenVisitor::TelemetryMessage added {call, get_source_location(call->getStart()).l, {}};
+        for (auto param: params)
+            added.fields.push_back({get_source_text(param), telemetry_type(visitor, param)->type_source_name()});
+        messages.push_back(std::move(added));
+        message = messages.end() - 1;
+    }
+
+    std::vector<std::string> args {std::to_string(message - messages.begin())};
+    for (size_t i = 0; i < params.size(); i++) {
+        auto type = telemetry_type(visitor, params[i]);
+        args.push_back(fmt::format("static_cast<{}>({})", type->type_target_name(),
+                                   std::any_cast<std::string>(visitor.visit(params[i]))));
+    }
+    return fmt::format("{}", fmt::join(args, ", "));
+}
+
+void generate_yielding_print(CodegenVisitor &visitor, const std::string &try_print) {
+    // The print gets its own case to retry at, entered by falling through from the current one
+    auto retry_case = visitor.async_state_counter++;
+    if (visitor.is_in_async_state_case)
+        fmt::print(*visitor.stream, "state.s = {}; }} [[fallthrough]];", retry_case);
+
+    fmt::print(*visitor.stream, "case {}: {{ if (!{}) return 0;", retry_case, try_print);
+    visitor.is_in_async_state_case = true;
+}
+
+bool is_coalescable_print(CodegenVisitor &visitor, eelParser::StmtContext *ctx) {
+    if (visitor.elided_statements.contains(ctx))
+        return false;
+
+    auto call = dynamic_cast<eelParser::FnCallExprContext *>(ctx->expr());
+    if (call == nullptr)
+        return false;
+
+    auto symbol = resolve_fqn(visitor.current_scope, call->fqn());
+    if (symbol.is_nullptr() || symbol->kind != Symbol_::Kind::ExternFunction)
+        return false;
+
+    // Prints with a format are left alone, as the format belongs to the value
+    auto &target = symbol->value.extern_function->target_id();
+    return (target == "serial_print" || target == "serial_println") && flatten_expr_list(call->params).size() <= 1;
+}
+
+void generate_serial_print_run(CodegenVisitor &visitor, const std::vector<eelParser::StmtContext *> &run) {
+    generate_line_directive(visitor, run.front());
+
+    // Adjacent literals are concatenated by the c++ compiler,
+    // which keeps escape sequences of different fragments apart
+    std::vector<std::string> args;
+    std::string literals;
+    auto add_text = [&](const std::string &literal) {
+        literals += literals.empty() ? literal : " " + literal;
+    };
+    auto flush_text = [&]() {
+        if (!literals.empty())
+            args.push_back(fmt::format("EEL_FLASH({})", literals));
+        literals.clear();
+    };
+
+    for (auto stmt: run) {
+        auto call = dynamic_cast<eelParser::FnCallExprContext *>(stmt->expr());
+        auto params = flatten_expr_list(call->params);
+        if (!params.empty()) {
+            auto param = params.front();
+            if (dynamic_cast<eelParser::StringLiteralContext *>(param) != nullptr) {
+                add_text(param->getText());
+            } else if (dynamic_cast<eelParser::CharLiteralContext *>(param) != nullptr) {
+                auto text = param->getText();
+                auto character = text.substr(1, text.size() - 2);
+                if (character == "\"")
+                    character = "\\\"";
+                else if (character == "\\'")
+                    character = "'";
+                add_text(fmt::format("\"{}\"", character));
+            } else {
+                flush_text();
+                args.push_back(std::any_cast<std::string>(visitor.visit(param)));
+            }
+        }
+
+        if (call->fqn()->getText() == "serial_println")
+            add_text("\"\\r\\n\"");
+    }
+    flush_text();
+
+    if (args.empty())
+        return;
+
+    auto joined = fmt::format("{}", fmt::join(args, ", "));
+    if (visitor.current_sequence != nullptr && visitor.current_sequence->current_block->is_async())
+        generate_yielding_print(visitor, fmt::format("serial_try_print_all({})", joined));
+    else
+        fmt::print(*visitor.stream, "serial_print_all({});", joined);
+}
+
+void generate_event(CodegenVisitor &visitor, Symbol symbol, eelParser::EventDeclContext *ctx) {
+    auto event = symbol->value.event;
+    if (!event->is_complete)
+        throw InternalError(InternalError::Codegen, "Incomplete event encountered during codegen.");
+
+    // If the event is never used (no `awaits` or reachable `on` blocks)
+    // don't bother generating the event.
+    if (!is_generated(visitor, event))
+        return;
+
+    auto event_index = visitor.events.size();
+    visitor.events.push_back(event);
+    if (visitor.profile || visitor.trace)
+        visitor.instrumented_events.push_back(symbol->name);
+    if (ctx != nullptr)
+        map_source(visitor, event->id, "event", symbol->name, ctx);
+    visitor.is_in_event_code = true;
+
+    static const std::string predicateless_type = "PredicateLess";
+    std::stringstream event_state;
+
+    fmt::print(event_state, "struct {}_handle_state {{", event->id);
+
+    // Generate function types for event handles
+    auto &handles = event->get_handles();
+    std::vector<std::string> handle_types;
+    for (auto &handle: handles) {
+        if (visitor.dead_functions.contains(&handle.second))
+            continue;
+
+        // Tracing is applied first, so the profiled time includes the cost of tracing
+        auto handle_type = handle.second.type_id;
+        if (visitor.trace)
+            handle_type = fmt::format("TracedHandle<{}, __trace, {}, {}>", handle_type, event_index, handle_types.size());
+        if (visitor.profile)
+            handle_type = fmt::format("ProfiledHandle<{}, __profile, {}, {}>",
+                                      handle_type, visitor.instrumented_handles.size(), event_index);
+        if (visitor.profile || visitor.trace)
+            visitor.instrumented_handles.push_back({event_index, fmt::format("on {} ({})", symbol->name,
+                                                                             handle.second.body->getStart()->getLine())});
+        handle_types.push_back(handle_type);
+        map_source(visitor, handle.second.type_id, "handle", fmt::format("on {}", symbol->name), handle.second.body);
+
+        if (handle.second.sequence->start->kind == SequencePoint::AsyncPoint) {
+            fmt::print(event_state, "{}::State {};", handle.second.type_id, handle.second.type_id);
+            generate_async_functor_type(visitor.stream, handle.second, visitor);
+
+            // Handles suspended by their time slice continue on the next turn without waiting for the event
+            if (!visitor.sliced_cases.empty())
+                handle_types.back() = fmt::format("TimeSlicedHandle<{}, {}>", handle_types.back(),
+                                                  fmt::join(visitor.sliced_cases, ", "));
+        } else {
+            generate_sync_functor_type(visitor.stream, handle.second, visitor);
+        }
+    }
+
+    fmt::print(event_state, "}};");
+
+    auto predicate_type = predicateless_type;
+    if (event->has_predicate) {
+        predicate_type = event->predicate->type_id;
+        if (ctx != nullptr)
+            map_source(visitor, event->predicate->type_id, "predicate", symbol->name, ctx);
+
+        // Async predicates are left uninstrumented as they are not invoked directly
+        if (visitor.profile && event->predicate->sequence->start->kind != SequencePoint::AsyncPoint)
+            predicate_type = fmt::format("ProfiledPredicate<{}, __profile, {}>", predicate_type, event_index);
+
+        auto cache_index = visitor.cached_predicates.find(event);
+        if (cache_index != visitor.cached_predicates.end())
+            predicate_type = fmt::format("CachedPredicate<{}, __predicate_cache, {}>",
+                                         predicate_type, cache_index->second);
+
+        if (!event->builtin_predicate.empty()) {
+            fmt::print(*visitor.stream, "struct {} {{ static bool invoke() {{ return {}(); }} }};",
+                       event->predicate->type_id, event->builtin_predicate);
+        } else if (event->predicate->sequence->start->kind == SequencePoint::AsyncPoint) {
+            generate_async_functor_type(visitor.stream, *event->predicate, visitor);
+        } else {
+            generate_sync_functor_type(visitor.stream, *event->predicate, visitor);
+        }
+    }
+
+    fmt::print(*visitor.stream, "{}", event_state.str());
+
+    // Generate the event field
+    fmt::print(*visitor.stream, "Event<{}, {}_handle_state", predicate_type, event->id);
+    for (auto &handle_type: handle_types)
+        fmt::print(*visitor.stream, ", {}", handle_type);
+
+    fmt::print(*visitor.stream, "> {} {{}};\n", event->id);
+
+    visitor.is_in_event_code = false;
+}
+
+
+
+bool is_generated(CodegenVisitor &visitor, const symbols::Event *event) {
+    return !visitor.dead_events.contains(event) && (event->is_awaited || !event->get_handles().empty());
+}
+
+void generate_input_sampling(CodegenVisitor &visitor) {
+    if (!visitor.snapshot_pins.empty())
+        fmt::print(*visitor.stream, "__inputs.sample();\n");
+
+    for (auto id: visitor.sampled_pins)
+        fmt::print(*visitor.stream, "SampledPin<{}>::sample();\n", generate_variable_id(visitor.table.get_symbol(id)));
+}
+
+std::string generate_binary_expr(
+        CodegenVisitor &visitor,
+        eelParser::ExprContext *ctx,
+        eelParser::ExprContext *left,
+        const std::string &op,
+        eelParser::ExprContext *right,
+        bool is_shift
+) {
+    auto left_code = std::any_cast<std::string>(visitor.visit(left));
+    auto right_code = std::any_cast<std::string>(visitor.visit(right));
+
+    if (!visitor.narrow_arithmetic)
+        return fmt::format("({}){}({})", left_code, op, right_code);
+
+    visitor.ranges.scope = visitor.current_scope;
+    auto left_range = visitor.ranges.evaluate(left);
+    auto right_range = visitor.ranges.evaluate(right);
+    auto result_range = visitor.ranges.evaluate(ctx);
+    auto narrow = visitor.ranges.narrowed_type(left_range, right_range, result_range, is_shift);
+
+    if (narrow == nullptr)
+        return fmt::format("({}){}({})", left_code, op, right_code);
+
+    visitor.narrowing_log.push_back(fmt::format("{}:{}: `{}` computed as {} instead of {} (range {}..{})",
+                                                ctx->getStart()->getLine(),
+                                                ctx->getStart()->getCharPositionInLine(),
+                                                get_source_text(ctx),
+                                                narrow->type_source_name(),
+                                                result_range.type->type_source_name(),
+                                                result_range.lo,
+                                                result_range.hi));
+
+    // The shift amount is left as is, as it does not affect the type of the operation
+    return fmt::format("static_cast<{type}>(static_cast<{narrow}>({left}){op}{right})",
+                       fmt::arg("type", result_range.type->type_target_name()),
+                       fmt::arg("narrow", narrow->type_target_name()),
+                       fmt::arg("left", left_code),
+                       fmt::arg("op", op),
+                       fmt::arg("right", is_shift
+                                         ? fmt::format("({})", right_code)
+                                         : fmt::format("static_cast<{}>({})", narrow->type_target_name(),
+                                                       right_code)));
+}
+
+std::string generate_constant_division(CodegenVisitor &visitor, eelParser::ScalingExprContext *ctx) {
+    auto evaluator = ConstEvalVisitor(visitor.current_scope);
+    evaluator.int_width = visitor.ranges.int_width;
+    auto divisor = evaluator.evaluate(ctx->right);
+    if (divisor.kind != symbols::Constant::Value::Kind::Integer || divisor.integer <= 0)
+        return "";
+
+    // Fully constant expressions are left for the c++ compiler to fold
+    if (evaluator.evaluate(ctx->left).is_constant())
+        return "";
+
+    // The type the division is carried out in after the integral promotion and the
+    // usual arithmetic conversions, such that (u8 + u8) / 10 is divided in `int`
+    visitor.ranges.scope = visitor.current_scope;
+    auto type = visitor.ranges.evaluate(ctx).type;
+
+    auto width = integer_width(type);
+    auto is_power_of_two = (divisor.integer & (divisor.integer - 1)) == 0;
+    // There is no wider type to multiply 64-bit values in, so only shifts and masks apply
+    if (width == 0 || (width == 64 && !is_power_of_two))
+        return "";
+    if (!Range::of_type(type).contains(Range::exact(divisor.integer)))
+        return "";
+
+    return fmt::format("{}<{}, {}>({})",
+                       ctx->op->getText() == "/" ? "div_const" : "mod_const",
+                       type->type_target_name(),
+                       divisor.integer,
+                       std::any_cast<std::string>(visitor.visit(ctx->left)));
+}
+
 static void generate_functor_core(const symbols::Function &function, CodegenVisitor &visitor) {
     auto outer_scope = visitor.current_scope;
     visitor.current_sequence = function.sequence;
     visitor.current_sequence->reset();
     visitor.current_scope = visitor.current_sequence->start->scope;
 
+    generate_line_directive(visitor, function.body);
     visitor.visitChildren(function.body);
 
     if (function.is_async()) {
@@ -811,6 +1541,7 @@ void generate_sync_functor_type(
                return_type_name);
     generate_functor_core(function, visitor);
     fmt::print(*stream, "}} }};");
+    generate_glue_line_directive(visitor);
 }
 
 void generate_async_functor_type(
@@ -820,6 +1551,7 @@ void generate_async_functor_type(
 ) {
     visitor.async_state_counter = 0;
     visitor.is_in_async_state_case = false;
+    visitor.sliced_cases.clear();
 
     fmt::print(*stream,
                "struct {} : AsyncFunction {{"
@@ -880,6 +1612,7 @@ void generate_async_functor_type(
                         "template <typename S>"
                         "static State& get_state(S& s) {{ return s.{}; }}"
                         "}};", function.type_id);
+    generate_glue_line_directive(visitor);
 
 }
 
@@ -894,6 +1627,59 @@ std::string generate_variable_id(Symbol symbol) {
     return fmt::format("__v{}", symbol->id);
 }
 
+void generate_constants(std::iostream *stream, SymbolTable &table) {
+    for (size_t i = 0; i < table.get_symbol_count(); i++) {
+        auto symbol = table.get_symbol(i);
+        if (symbol->kind != Symbol_::Kind::Constant)
+            continue;
+
+        auto constant = symbol->value.constant;
+        auto type_symbol = constant->type;
+        resolve(type_symbol, table);
+        check_symbol(type_symbol, Symbol_::Kind::Type, symbol->name);
+        auto type = type_symbol->value.type;
+
+        if (constant->value.kind == symbols::Constant::Value::Kind::Array) {
+            std::string elements;
+            for (auto &element: constant->value.elements) {
+                if (!elements.empty())
+                    elements += ", ";
+                elements += generate_constant_value(element, type);
+            }
+
+            fmt::print(*stream, "const {} {}[{}] PROGMEM = {{{}}};\n",
+                       type->type_target_name(),
+                       generate_variable_id(symbol),
+                       constant->value.elements.size(),
+                       elements);
+        } else {
+            fmt::print(*stream, "constexpr {} {} = {};\n",
+                       type->type_target_name(),
+                       generate_variable_id(symbol),
+                       generate_constant_value(constant->value, type));
+        }
+    }
+}
+
+std::string generate_constant_value(const symbols::Constant::Value &value, const symbols::Type *type) {
+    using Kind = symbols::Constant::Value::Kind;
+    switch (value.kind) {
+        case Kind::Integer:
+            // u64 values are stored wrapped into the signed representation
+            if (type == &symbols::Primitive::u64 || type == &symbols::Primitive::usize)
+                return fmt::format("{}ull", static_cast<uint64_t>(value.integer));
+            if (value.integer == INT64_MIN)
+                return "INT64_MIN";
+            return fmt::format("{}", value.integer);
+        case Kind::Float:
+            return fmt::format("{}", value.floating);
+        case Kind::Bool:
+            return value.boolean ? "true" : "false";
+        default:
+            throw InternalError(InternalError::Codegen, "Constant has no computed value.");
+    }
+}
+
 void check_symbol(Symbol symbol, Symbol_::Kind expected_kind, const std::string &identifier) {
     if (symbol.is_nullptr())
         throw InternalError(
@@ -0,0 +1,393 @@
+#include <Visitors/const_eval.hpp>
+#include <Visitors/range.hpp>
+#include <Visitors/utility.hpp>
+#include <symbols/type.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+
+using namespace eel;
+using namespace eel::visitors;
+using Value = ConstEvalVisitor::Value;
+using Kind = Value::Kind;
+using symbols::Primitive;
+
+ConstEvalVisitor::ConstEvalVisitor(Scope scope) : scope(scope) {}
+
+Value ConstEvalVisitor::evaluate(eelParser::ExprContext* ctx) {
+    if (ctx == nullptr)
+        return {};
+    return std::any_cast<Value>(visit(ctx));
+}
+
+any ConstEvalVisitor::visitChildren(antlr4::tree::ParseTree*) {
+    // Anything without an explicit rule is not a constant expression.
+    return Value{};
+}
+
+Value ConstEvalVisitor::lookup(const Symbol& symbol) {
+    if (symbol->kind == Symbol_::Kind::Constant)
+        return symbol->value.constant->value;
+    return {};
+}
+
+/*
+ * Helpers
+ */
+
+/// Integer arithmetic is done on the unsigned representation to get
+/// two's complement wrapping rather than undefined behaviour on overflow.
+static int64_t wrap(uint64_t value) {
+    return static_cast<int64_t>(value);
+}
+
+/// Whether both operands are scalars and at least one of them is a float,
+/// in which case the operation is carried out in floating point.
+static bool is_float_op(const Value& left, const Value& right) {
+    return left.kind == Kind::Float || right.kind == Kind::Float;
+}
+
+static bool both_scalar(const Value& left, const Value& right) {
+    return left.is_scalar() && right.is_scalar();
+}
+
+static bool both_integral(const Value& left, const Value& right) {
+    return both_scalar(left, right) && !is_float_op(left, right);
+}
+
+/// The type of an operand in c++, literals are `int` or wider as needed to hold their value.
+static const Primitive* operand_type(const Value& value, size_t int_width) {
+    if (value.type != nullptr)
+        return value.type;
+    if (value.kind == Kind::Bool)
+        return &Primitive::boolean;
+    if (value.kind == Kind::Integer)
+        return literal_type(value.integer, int_width);
+    return nullptr;
+}
+
+/// The type an integer operation is carried out in. `nullptr` if both operands
+/// are untyped, or if the type is not a fixed width integer (such as `usize`).
+static const Primitive* operation_type(const Value& left, const Value& right, size_t int_width) {
+    if (left.type == nullptr && right.type == nullptr)
+        return nullptr;
+    return arithmetic_type(operand_type(left, int_width), operand_type(right, int_width), int_width);
+}
+
+/// The type of a unary operation on a value, `nullptr` for untyped values.
+static const Primitive* unary_type(const Value& value, size_t int_width) {
+    return value.type == nullptr ? nullptr : promoted_type(value.type, int_width);
+}
+
+/// The value of an operand converted to the type of the operation.
+static int64_t operand(const Value& value, const Primitive* type) {
+    return type == nullptr ? value.as_integer() : value.cast(type).as_integer();
+}
+
+/// The result of an integer operation, wrapped to the type it was carried out in.
+static Value result(int64_t value, const Primitive* type) {
+    auto result = Value::from_integer(value);
+    return type == nullptr ? result : result.cast(type);
+}
+
+static const Primitive* unsigned_type(size_t width) {
+    switch (width) {
+        case 8: return &Primitive::u8;
+        case 16: return &Primitive::u16;
+        case 32: return &Primitive::u32;
+        default: return &Primitive::u64;
+    }
+}
+
+/*
+ * Literals
+ */
+
+uint64_t ConstEvalVisitor::parse_integer(antlr4::tree::TerminalNode* literal) {
+    auto text = literal->getText();
+    if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
+        return std::strtoull(text.c_str() + 2, nullptr, 16);
+    return std::strtoull(text.c_str(), nullptr, 10);
+}
+
+any ConstEvalVisitor::visitIntegerLiteral(eelParser::IntegerLiteralContext* ctx) {
+    return Value::from_integer(wrap(parse_integer(ctx->IntegerLiteral())));
+}
+
+any ConstEvalVisitor::visitFloatLiteral(eelParser::FloatLiteralContext* ctx) {
+    return Value::from_float(std::strtod(ctx->FloatLiteral()->getText().c_str(), nullptr));
+}
+
+any ConstEvalVisitor::visitBoolLiteral(eelParser::BoolLiteralContext* ctx) {
+    return Value::from_bool(ctx->BoolLiteral()->getText() == "true");
+}
+
+any ConstEvalVisitor::visitCharLiteral(eelParser::CharLiteralContext* ctx) {
+    auto text = ctx->CharLiteral()->getText();
+    // strip the surrounding quotes
+    auto body = text.substr(1, text.size() - 2);
+
+    if (body.empty())
+        return Value::from_integer(0);
+    if (body[0] != '\\')
+        return Value::from_integer(static_cast<uint8_t>(body[0]));
+
+    switch (body[1]) {
+        case 'n': return Value::from_integer('\n');
+        case 'r': return Value::from_integer('\r');
+        case 't': return Value::from_integer('\t');
+        case 'v': return Value::from_integer('\v');
+        case 'x': return Value::from_integer(
+                static_cast<uint8_t>(std::strtoul(body.c_str() + 2, nullptr, 16)));
+        default: return Value::from_integer(static_cast<uint8_t>(body[1]));
+    }
+}
+
+/*
+ * Access expressions
+ */
+
+any ConstEvalVisitor::visitParenExpr(eelParser::ParenExprContext* ctx) {
+    return visit(ctx->expr());
+}
+
+any ConstEvalVisitor::visitFqnExpr(eelParser::FqnExprContext* ctx) {
+    auto symbol = resolve_fqn(scope, ctx->fqn());
+    if (symbol.is_nullptr())
+        return Value{};
+    return lookup(symbol);
+}
+
+any ConstEvalVisitor::visitArrayExpr(eelParser::ArrayExprContext* ctx) {
+    auto symbol = resolve_fqn(scope, ctx->fqn());
+    if (symbol.is_nullptr())
+        return Value{};
+
+    auto array = lookup(symbol);
+    auto index = evaluate(ctx->expr());
+    if (array.kind != Kind::Array || index.kind != Kind::Integer)
+        return Value{};
+    if (index.integer < 0 || static_cast<size_t>(index.integer) >= array.elements.size())
+        return Value{};
+
+    return array.elements[index.integer];
+}
+
+any ConstEvalVisitor::visitCastExpr(eelParser::CastExprContext* ctx) {
+    auto value = evaluate(ctx->expr());
+    auto type = scope->find(ctx->type()->getText());
+    if (!value.is_scalar() || type.is_nullptr() || type->kind != Symbol_::Kind::Type)
+        return Value{};
+
+    return value.cast(type->value.type);
+}
+
+/*
+ * Unary operators
+ */
+
+any ConstEvalVisitor::visitPos(eelParser::PosContext* ctx) {
+    auto value = evaluate(ctx->right);
+    if (value.kind == Kind::Integer) {
+        auto type = unary_type(value, int_width);
+        return result(operand(value, type), type);
+    }
+    if (value.kind != Kind::Float)
+        return Value{};
+    return value;
+}
+
+any ConstEvalVisitor::visitNeg(eelParser::NegContext* ctx) {
+    auto value = evaluate(ctx->right);
+    if (value.kind == Kind::Integer) {
+        auto type = unary_type(value, int_width);
+        return result(wrap(-static_cast<uint64_t>(operand(value, type))), type);
+    }
+    if (value.kind == Kind::Float)
+        return Value::from_float(-value.floating);
+    return Value{};
+}
+
+any ConstEvalVisitor::visitNot(eelParser::NotContext* ctx) {
+    auto value = evaluate(ctx->right);
+    if (!value.is_scalar())
+        return Value{};
+    return Value::from_bool(!value.as_bool());
+}
+
+any ConstEvalVisitor::visitBitComp(eelParser::BitCompContext* ctx) {
+    auto value = evaluate(ctx->right);
+    if (value.kind != Kind::Integer)
+        return Value{};
+    auto type = unary_type(value, int_width);
+    return result(~operand(value, type), type);
+}
+
+/*
+ * Binary operators
+ */
+
+any ConstEvalVisitor::visitScalingExpr(eelParser::ScalingExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    auto op = ctx->op->getText();
+    if (!both_scalar(left, right))
+        return Value{};
+
+    if (is_float_op(left, right)) {
+        if (op == "*")
+            return Value::from_float(left.as_float() * right.as_float());
+        if (op == "/" && right.as_float() != 0)
+            return Value::from_float(left.as_float() / right.as_float());
+        // modulo is not defined for floats, division by zero is left to the runtime
+        return Value{};
+    }
+
+    auto type = operation_type(left, right, int_width);
+    auto l = operand(left, type);
+    auto r = operand(right, type);
+    if (op == "*")
+        return result(wrap(static_cast<uint64_t>(l) * static_cast<uint64_t>(r)), type);
+
+    if (r == 0)
+        return Value{};
+    // Values of u64 above INT64_MAX are stored as negative numbers
+    if (type == &Primitive::u64) {
+        auto ul = static_cast<uint64_t>(l);
+        auto ur = static_cast<uint64_t>(r);
+        return result(wrap(op == "/" ? ul / ur : ul % ur), type);
+    }
+
+    // INT64_MIN / -1 has no meaningful value
+    if (r == -1 && l == INT64_MIN)
+        return Value{};
+    if (op == "/")
+        return result(l / r, type);
+    return result(l % r, type);
+}
+
+any ConstEvalVisitor::visitAdditiveExpr(eelParser::AdditiveExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    auto is_add = ctx->op->getText() == "+";
+    if (!both_scalar(left, right))
+        return Value{};
+
+    if (is_float_op(left, right)) {
+        return Value::from_float(is_add
+                                 ? left.as_float() + right.as_float()
+                                 : left.as_float() - right.as_float());
+    }
+
+    auto type = operation_type(left, right, int_width);
+    auto l = static_cast<uint64_t>(operand(left, type));
+    auto r = static_cast<uint64_t>(operand(right, type));
+    return result(wrap(is_add ? l + r : l - r), type);
+}
+
+any ConstEvalVisitor::visitShiftingExpr(eelParser::ShiftingExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    auto op = ctx->op->getText();
+    if (!both_integral(left, right))
+        return Value{};
+
+    // The type of a shift is that of its promoted left operand
+    auto type = unary_type(left, int_width);
+    auto value = operand(left, type);
+
+    // Logical shifts convert the operand to the unsigned type of its own width first
+    if (op == ">>>") {
+        auto width = integer_width(left.type);
+        if (width == 0)
+            width = int_width;
+        type = promoted_type(unsigned_type(width), int_width);
+        value = width < 64 ? value & static_cast<int64_t>((uint64_t(1) << width) - 1) : value;
+    }
+
+    // Shifting by the width of the type or more is undefined
+    auto width = integer_width(type) == 0 ? 64 : integer_width(type);
+    auto amount = right.as_integer();
+    if (amount < 0 || amount >= static_cast<int64_t>(width))
+        return Value{};
+
+    if (op == "<<")
+        return result(wrap(static_cast<uint64_t>(value) << amount), type);
+    if (op == ">>>" || type == &Primitive::u64)
+        return result(wrap(static_cast<uint64_t>(value) >> amount), type);
+    return result(value >> amount, type);
+}
+
+any ConstEvalVisitor::visitComparisonExpr(eelParser::ComparisonExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    auto op = ctx->op->getText();
+    if (!both_scalar(left, right))
+        return Value{};
+
+    int order;
+    if (is_float_op(left, right)) {
+        auto l = left.as_float();
+        auto r = right.as_float();
+        order = l < r ? -1 : (l > r ? 1 : 0);
+    } else if (auto type = operation_type(left, right, int_width); type == &Primitive::u64) {
+        auto l = static_cast<uint64_t>(operand(left, type));
+        auto r = static_cast<uint64_t>(operand(right, type));
+        order = l < r ? -1 : (l > r ? 1 : 0);
+    } else {
+        // Comparisons convert both operands as well, so -1 < 1u is false
+        auto l = operand(left, type);
+        auto r = operand(right, type);
+        order = l < r ? -1 : (l > r ? 1 : 0);
+    }
+
+    if (op == ">") return Value::from_bool(order > 0);
+    if (op == ">=") return Value::from_bool(order >= 0);
+    if (op == "<") return Value::from_bool(order < 0);
+    if (op == "<=") return Value::from_bool(order <= 0);
+    if (op == "==") return Value::from_bool(order == 0);
+    return Value::from_bool(order != 0);
+}
+
+any ConstEvalVisitor::visitAndExpr(eelParser::AndExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    if (!both_integral(left, right))
+        return Value{};
+    auto type = operation_type(left, right, int_width);
+    return result(operand(left, type) & operand(right, type), type);
+}
+
+any ConstEvalVisitor::visitXorExpr(eelParser::XorExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    if (!both_integral(left, right))
+        return Value{};
+    auto type = operation_type(left, right, int_width);
+    return result(operand(left, type) ^ operand(right, type), type);
+}
+
+any ConstEvalVisitor::visitOrExpr(eelParser::OrExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    if (!both_integral(left, right))
+        return Value{};
+    auto type = operation_type(left, right, int_width);
+    return result(operand(left, type) | operand(right, type), type);
+}
+
+any ConstEvalVisitor::visitLAndExpr(eelParser::LAndExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    if (!both_scalar(left, right))
+        return Value{};
+    return Value::from_bool(left.as_bool() && right.as_bool());
+}
+
+any ConstEvalVisitor::visitLOrExpr(eelParser::LOrExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    if (!both_scalar(left, right))
+        return Value{};
+    return Value::from_bool(left.as_bool() || right.as_bool());
+}
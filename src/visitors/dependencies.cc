@@ -0,0 +1,148 @@
+#include <Visitors/dependencies.hpp>
+
+#include <fmt/core.h>
+
+using namespace eel;
+using namespace eel::visitors;
+
+/// Returns the fqn assigned to by an assignment target, or null if it is not a plain or array variable.
+static eelParser::FqnContext* assignment_target(eelParser::ExprContext* target) {
+    if (auto fqn = dynamic_cast<eelParser::FqnExprContext*>(target))
+        return fqn->fqn();
+    if (auto array = dynamic_cast<eelParser::ArrayExprContext*>(target))
+        return array->fqn();
+    return nullptr;
+}
+
+/// Returns the target of any (compound) assignment expression, or null if not an assignment.
+static eelParser::ExprContext* assigned_expr(antlr4::tree::ParseTree* tree) {
+    if (auto assign = dynamic_cast<eelParser::AssignExprContext*>(tree)) return assign->var;
+    if (auto assign = dynamic_cast<eelParser::AdditiveAssignExprContext*>(tree)) return assign->var;
+    if (auto assign = dynamic_cast<eelParser::ScalingAssignExprContext*>(tree)) return assign->var;
+    if (auto assign = dynamic_cast<eelParser::ShiftingAssignExprContext*>(tree)) return assign->var;
+    if (auto assign = dynamic_cast<eelParser::OrAssignExprContext*>(tree)) return assign->var;
+    if (auto assign = dynamic_cast<eelParser::AndAssignExprContext*>(tree)) return assign->var;
+    if (auto assign = dynamic_cast<eelParser::XorAssignExprContext*>(tree)) return assign->var;
+    return nullptr;
+}
+
+PredicateDependencies::PredicateDependencies(SymbolTable& table) : table(table) {}
+
+PredicateDependencies::Result PredicateDependencies::run(eelParser::ProgramContext* program) {
+    Result result;
+    find_escaping(program);
+
+    for (auto tl_decl: program->tlDecl()) {
+        auto decl = tl_decl->decl();
+        if (decl == nullptr || decl->typeDecl() == nullptr || decl->typeDecl()->eventDecl() == nullptr)
+            continue;
+
+        auto event_decl = decl->typeDecl()->eventDecl();
+        if (event_decl->stmtBlock() == nullptr)
+            continue;
+
+        auto symbol = table.root_scope->find(event_decl->Identifier()->getText());
+        if (symbol.is_nullptr() || symbol->kind != Symbol_::Kind::Event || !symbol->value.event->has_predicate)
+            continue;
+
+        auto event = symbol->value.event;
+        std::unordered_set<Symbol::Id> reads;
+        auto reason = scan(event->predicate->scope, event_decl->stmtBlock(), reads);
+        if (!reason.empty()) {
+            result.log.push_back(fmt::format("predicate of `{}` is polled: {}", symbol->name, reason));
+            continue;
+        }
+
+        auto index = result.cached.size();
+        result.cached[event] = index;
+        for (auto id: reads)
+            result.dependents[id].push_back(index);
+
+        result.log.push_back(fmt::format("predicate of `{}` is cached: depends on {} variable(s)",
+                                         symbol->name, reads.size()));
+    }
+
+    return result;
+}
+
+Symbol PredicateDependencies::find_global(Scope scope, const std::string& name) {
+    auto symbol = scope->find(name);
+    if (symbol.is_nullptr() || symbol->kind != Symbol_::Kind::Variable)
+        return {};
+    if (table.root_scope->find_member(name) != symbol)
+        return {};
+    return symbol;
+}
+
+std::string PredicateDependencies::scan(Scope scope, antlr4::tree::ParseTree* tree,
+                                        std::unordered_set<Symbol::Id>& reads) {
+    if (dynamic_cast<eelParser::ReadPinExprContext*>(tree) != nullptr)
+        return "reads a pin";
+    if (dynamic_cast<eelParser::FnCallExprContext*>(tree) != nullptr
+        || dynamic_cast<eelParser::InstanceAssociatedFnCallExprContext*>(tree) != nullptr)
+        return "calls a function";
+    if (dynamic_cast<eelParser::AwaitStmtContext*>(tree) != nullptr)
+        return "awaits";
+    if (dynamic_cast<eelParser::EmitStmtContext*>(tree) != nullptr)
+        return "emits an event";
+    if (dynamic_cast<eelParser::StaticDeclContext*>(tree) != nullptr)
+        return "declares a static variable";
+
+    if (auto target = assigned_expr(tree)) {
+        auto fqn = assignment_target(target);
+        if (fqn == nullptr || !find_global(scope, fqn->getText()).is_nullptr())
+            return "writes a global variable";
+    }
+
+    if (auto identifier = dynamic_cast<eelParser::IdentifierContext*>(tree)) {
+        auto name = identifier->getText();
+        auto symbol = find_global(scope, name);
+        if (!symbol.is_nullptr()) {
+            if (escaping.contains(symbol->id))
+                return fmt::format("reads `{}` whose address is taken", name);
+            reads.insert(symbol->id);
+        } else {
+            auto other = scope->find(name);
+            if (!other.is_nullptr() && other->kind == Symbol_::Kind::Event)
+                return fmt::format("refers to event `{}`", name);
+        }
+        return "";
+    }
+
+    for (auto child: tree->children) {
+        auto reason = scan(scope, child, reads);
+        if (!reason.empty())
+            return reason;
+    }
+    return "";
+}
+
+void PredicateDependencies::find_escaping(antlr4::tree::ParseTree* tree) {
+    antlr4::tree::ParseTree* source = nullptr;
+    if (auto reference = dynamic_cast<eelParser::ReferenceExprContext*>(tree))
+        source = reference->fqn();
+    else if (auto pointer = dynamic_cast<eelParser::PointerExprContext*>(tree))
+        source = pointer->fqn();
+    else if (auto reference_decl = dynamic_cast<eelParser::ReferenceDeclContext*>(tree))
+        source = reference_decl->expr();
+    else if (auto pointer_decl = dynamic_cast<eelParser::PointerDeclContext*>(tree))
+        source = pointer_decl->expr();
+
+    if (source != nullptr) {
+        // Conservatively every global mentioned is considered to escape
+        std::vector<antlr4::tree::ParseTree*> pending {source};
+        while (!pending.empty()) {
+            auto node = pending.back();
+            pending.pop_back();
+            if (auto identifier = dynamic_cast<eelParser::IdentifierContext*>(node)) {
+                auto symbol = table.root_scope->find_member(identifier->getText());
+                if (!symbol.is_nullptr())
+                    escaping.insert(symbol->id);
+            }
+            pending.insert(pending.end(), node->children.begin(), node->children.end());
+        }
+    }
+
+    for (auto child: tree->children)
+        find_escaping(child);
+}
@@ -0,0 +1,645 @@
+#include <Visitors/latency.hpp>
+#include <Visitors/const_eval.hpp>
+#include <Visitors/range.hpp>
+#include <Visitors/utility.hpp>
+#include <symbols/type.hpp>
+#include <symbols/variable.hpp>
+#include <sequence.hpp>
+
+#include <algorithm>
+#include <fmt/core.h>
+
+using namespace eel;
+using namespace eel::visitors;
+using Cost = LatencyAnalysis::Cost;
+
+/*
+ * Cost model
+ *
+ * Cycle estimates for a 16MHz AVR. Arithmetic is assumed to be carried out
+ * in 16-bit `int`, division being a library call. Pin accesses go through
+ * the arduino core, where `analogRead` waits for a full ADC conversion.
+ */
+
+static constexpr uint64_t operand_cycles = 2;
+static constexpr uint64_t operator_cycles = 2;
+static constexpr uint64_t multiply_cycles = 10;
+static constexpr uint64_t divide_cycles = 220;
+static constexpr uint64_t shift_cycles = 6;
+static constexpr uint64_t call_overhead_cycles = 50;
+static constexpr uint64_t digital_access_cycles = 60;
+static constexpr uint64_t analog_read_cycles = 1700;
+static constexpr uint64_t emit_cycles = 4;
+static constexpr uint64_t await_cycles = 8;
+
+/// Return address and frame pointer of a call.
+static constexpr size_t frame_bytes = 4;
+/// Frames of `main` and the dispatch of events, which are mostly inlined.
+static constexpr size_t dispatch_frame_bytes = 8;
+/// Stack assumed to be used by an external function, including its frame.
+static constexpr size_t extern_call_bytes = 16;
+
+/// Returns the size of a type on AVR.
+static size_t type_size(const Symbol& type_symbol) {
+    if (type_symbol.is_nullptr() || type_symbol->kind != Symbol_::Kind::Type)
+        return 2;
+
+    auto type = type_symbol->value.type;
+    if (type == &symbols::Primitive::u8 || type == &symbols::Primitive::i8 || type == &symbols::Primitive::boolean
+        || type == &symbols::Primitive::digital || type == &symbols::Primitive::analog)
+        return 1;
+    if (type == &symbols::Primitive::u32 || type == &symbols::Primitive::i32 || type == &symbols::Primitive::f32
+        || type == &symbols::Primitive::f64 || type == &symbols::Primitive::q16_16)
+        return 4;
+    if (type == &symbols::Primitive::u64 || type == &symbols::Primitive::i64)
+        return 8;
+    // u16, i16, usize and q8_8
+    return 2;
+}
+
+/// Sums the sizes of the variables declared in a scope.
+static size_t variable_bytes(SymbolTable& table, Scope scope) {
+    size_t bytes = 0;
+    for (auto& member: scope->members()) {
+        auto symbol = table.get_symbol(member.second);
+        if (!symbol.is_nullptr() && symbol->kind == Symbol_::Kind::Variable)
+            bytes += type_size(symbol->value.variable->type);
+    }
+    return bytes;
+}
+
+/// Sums the sizes of the parameters and locals declared within a user-defined function,
+/// which are not part of the symbol table.
+static size_t declared_bytes(SymbolTable& table, antlr4::tree::ParseTree* tree) {
+    eelParser::TypedIdentifierContext* declared = nullptr;
+    if (auto variable = dynamic_cast<eelParser::VariableDeclContext*>(tree))
+        declared = variable->typedIdentifier();
+    else if (auto param = dynamic_cast<eelParser::FnParamContext*>(tree))
+        declared = param->typedIdentifier();
+
+    if (declared != nullptr)
+        return type_size(table.root_scope->find(declared->type()->getText()));
+
+    size_t bytes = 0;
+    for (auto child: tree->children)
+        bytes += declared_bytes(table, child);
+    return bytes;
+}
+
+/// The variable an assignment writes to, `nullptr` if `tree` is not an assignment.
+static eelParser::ExprContext* assigned_variable(antlr4::tree::ParseTree* tree) {
+    if (auto assign = dynamic_cast<eelParser::AssignExprContext*>(tree))
+        return assign->var;
+    if (auto assign = dynamic_cast<eelParser::AdditiveAssignExprContext*>(tree))
+        return assign->var;
+    if (auto assign = dynamic_cast<eelParser::ScalingAssignExprContext*>(tree))
+        return assign->var;
+    if (auto assign = dynamic_cast<eelParser::ShiftingAssignExprContext*>(tree))
+        return assign->var;
+    if (auto assign = dynamic_cast<eelParser::OrAssignExprContext*>(tree))
+        return assign->var;
+    if (auto assign = dynamic_cast<eelParser::AndAssignExprContext*>(tree))
+        return assign->var;
+    if (auto assign = dynamic_cast<eelParser::XorAssignExprContext*>(tree))
+        return assign->var;
+    return nullptr;
+}
+
+/// Collects the assignments to `name` within a loop body.
+/// \returns False if the variable may change in any other way, or an iteration may skip its assignments.
+static bool collect_writes(antlr4::tree::ParseTree* tree, const std::string& name,
+                           const std::unordered_map<std::string, eelParser::FnDeclContext*>& functions,
+                           std::vector<antlr4::tree::ParseTree*>& writes) {
+    if (auto variable = assigned_variable(tree); variable != nullptr && variable->getText() == name)
+        writes.push_back(tree);
+
+    if (dynamic_cast<eelParser::ContinueStmtContext*>(tree) != nullptr)
+        return false;
+    // References alias the counter, called functions may write to a global one
+    if (auto reference = dynamic_cast<eelParser::ReferenceExprContext*>(tree); reference != nullptr
+        && reference->fqn()->getText() == name)
+        return false;
+    if (auto reference = dynamic_cast<eelParser::ReferenceDeclContext*>(tree); reference != nullptr
+        && reference->expr() != nullptr && reference->expr()->getText() == name)
+        return false;
+    if (auto call = dynamic_cast<eelParser::FnCallExprContext*>(tree); call != nullptr
+        && functions.contains(call->fqn()->getText()))
+        return false;
+
+    return std::all_of(tree->children.begin(), tree->children.end(), [&](auto child) {
+        return collect_writes(child, name, functions, writes);
+    });
+}
+
+/// Finds the declaration of the local variable `name` visible at `use`, searching the enclosing blocks outwards.
+/// \param initializer Set to the initial value of the variable if it is declared right before `use`.
+/// \returns The declaration, or `nullptr` if `name` is not a local.
+static eelParser::TypedIdentifierContext* find_local(antlr4::tree::ParseTree* use, const std::string& name,
+                                                     eelParser::ExprContext*& initializer) {
+    initializer = nullptr;
+    for (auto node = use; node->parent != nullptr; node = node->parent) {
+        auto parent = node->parent;
+        if (auto fn = dynamic_cast<eelParser::FnDeclContext*>(parent)) {
+            for (auto params = fn->paramList(); params != nullptr; params = params->paramList()) {
+                if (params->fnParam() != nullptr && params->fnParam()->typedIdentifier()->Identifier()->getText() == name)
+                    return params->fnParam()->typedIdentifier();
+            }
+            return nullptr;
+        }
+
+        eelParser::VariableDeclContext* found = nullptr;
+        for (auto child: parent->children) {
+            if (child == node)
+                break;
+            auto decl = dynamic_cast<eelParser::LDeclContext*>(child);
+            if (decl != nullptr && decl->variableDecl() != nullptr
+                && decl->variableDecl()->typedIdentifier()->Identifier()->getText() == name)
+                found = decl->variableDecl();
+        }
+
+        if (found != nullptr) {
+            // `lDecl stmtsOrLDecls`, where the first statement of the rest is the use
+            if (!node->children.empty() && node->children.front() == use->parent)
+                initializer = found->expr();
+            return found->typedIdentifier();
+        }
+    }
+    return nullptr;
+}
+
+/// Sums the locals of the blocks of a sequence, split by whether they are kept in the `State` of the function.
+static void block_bytes(SymbolTable& table, SequencePoint* point, size_t& state_bytes, size_t& stack_bytes) {
+    if (point == nullptr)
+        return;
+
+    if (auto block = dynamic_cast<Block*>(point)) {
+        auto bytes = variable_bytes(table, block->scope);
+        if (block->kind == SequencePoint::AsyncPoint)
+            state_bytes += bytes;
+        else
+            stack_bytes += bytes;
+        block_bytes(table, block->child, state_bytes, stack_bytes);
+    }
+
+    block_bytes(table, point->next, state_bytes, stack_bytes);
+}
+
+Cost Cost::operator+(const Cost& other) const {
+    return {cycles + other.cycles, statements + other.statements};
+}
+
+Cost Cost::operator*(uint64_t times) const {
+    return {cycles * times, statements * times};
+}
+
+bool Cost::operator<(const Cost& other) const {
+    return cycles < other.cycles || (cycles == other.cycles && statements < other.statements);
+}
+
+/// Adds two optional costs, the result only existing if both do.
+static std::optional<Cost> add(const std::optional<Cost>& a, const std::optional<Cost>& b) {
+    if (!a.has_value() || !b.has_value())
+        return std::nullopt;
+    return *a + *b;
+}
+
+/// The largest of two optional costs.
+static std::optional<Cost> longest(const std::optional<Cost>& a, const std::optional<Cost>& b) {
+    if (!a.has_value())
+        return b;
+    if (!b.has_value())
+        return a;
+    return std::max(*a, *b);
+}
+
+LatencyAnalysis::Path LatencyAnalysis::Path::of(Cost cost) {
+    Path path;
+    path.through = cost;
+    return path;
+}
+
+LatencyAnalysis::Path LatencyAnalysis::Path::yield(Cost resume_cost) {
+    Path path;
+    path.head = Cost {};
+    path.tail = resume_cost;
+    return path;
+}
+
+LatencyAnalysis::Path LatencyAnalysis::Path::then(const Path& next) const {
+    Path path;
+    path.through = add(through, next.through);
+    path.head = longest(head, add(through, next.head));
+    path.tail = longest(next.tail, add(tail, next.through));
+    path.inner = std::max({inner, next.inner, add(tail, next.head).value_or(Cost {})});
+    return path;
+}
+
+LatencyAnalysis::Path LatencyAnalysis::Path::either(const Path& other) const {
+    Path path;
+    path.through = longest(through, other.through);
+    path.head = longest(head, other.head);
+    path.tail = longest(tail, other.tail);
+    path.inner = std::max(inner, other.inner);
+    return path;
+}
+
+LatencyAnalysis::LatencyAnalysis(SymbolTable& table) : table(table) {}
+
+LatencyAnalysis::Result LatencyAnalysis::run(eelParser::ProgramContext* program) {
+    Result result;
+
+    for (auto tl_decl: program->tlDecl()) {
+        if (tl_decl->decl() != nullptr && tl_decl->decl()->fnDecl() != nullptr) {
+            auto fn = tl_decl->decl()->fnDecl();
+            functions[fn->Identifier()->getText()] = fn;
+        }
+    }
+
+    for (auto [name, builtin]: {std::pair {"setup", builtin_setup_name}, std::pair {"loop", builtin_loop_name}}) {
+        auto symbol = table.root_scope->find(builtin);
+        if (!symbol.is_nullptr() && symbol->kind == Symbol_::Kind::Function)
+            result.functions.push_back(analyze(name, *symbol->value.function));
+    }
+
+    for (auto tl_decl: program->tlDecl()) {
+        auto decl = tl_decl->decl();
+        if (decl == nullptr || decl->lDecl() == nullptr)
+            continue;
+
+        std::string name;
+        if (auto variable = decl->lDecl()->variableDecl())
+            name = variable->typedIdentifier()->Identifier()->getText();
+        else if (auto pin = decl->lDecl()->pinDecl())
+            name = pin->Identifier()->getText();
+        else
+            continue;
+
+        auto symbol = table.root_scope->find_member(name);
+        if (!symbol.is_nullptr() && symbol->kind == Symbol_::Kind::Variable)
+            result.global_bytes += type_size(symbol->value.variable->type);
+    }
+
+    for (size_t i = 0; i < table.get_symbol_count(); i++) {
+        auto symbol = table.get_symbol(i);
+        if (symbol->kind != Symbol_::Kind::Event)
+            continue;
+
+        auto event = symbol->value.event;
+        if (dead_events.contains(event) || (!event->is_awaited && event->get_handles().empty()))
+            continue;
+
+        size_t async_handles = 0;
+        size_t handle_states = 0;
+
+        // Handles are reported in source order
+        std::vector<const symbols::Function*> handles;
+        for (auto& handle: event->get_handles())
+            handles.push_back(&handle.second);
+        std::sort(handles.begin(), handles.end(), [](auto a, auto b) {
+            return a->body->getStart()->getTokenIndex() < b->body->getStart()->getTokenIndex();
+        });
+
+        for (auto handle: handles) {
+            auto report = analyze(fmt::format("on {} ({})", symbol->name, handle->body->getStart()->getLine()),
+                                  *handle);
+            if (report.is_async) {
+                async_handles++;
+                handle_states += report.state_bytes;
+            }
+            result.functions.push_back(report);
+        }
+
+        if (event->has_predicate && event->predicate->body != nullptr) {
+            auto report = analyze(fmt::format("event {}", symbol->name), *event->predicate);
+            result.event_bytes += report.state_bytes;
+            result.functions.push_back(report);
+        }
+
+        // Status flags, the `incomplete_tasks` and `awaiting` counters and the handle states.
+        // An empty state struct still takes up a byte.
+        result.event_bytes += (async_handles + 2 + 7) / 8 + 2 + std::max<size_t>(handle_states, 1);
+    }
+
+    return result;
+}
+
+LatencyAnalysis::Report LatencyAnalysis::analyze(const std::string& name, const symbols::Function& function) {
+    Report report;
+    report.name = name;
+    report.is_async = function.is_async();
+
+    current = &report;
+    call_bytes = 0;
+    auto path = walk(function.body);
+    current = nullptr;
+
+    report.longest_segment = std::max({path.inner,
+                                       path.through.value_or(Cost {}),
+                                       path.head.value_or(Cost {}),
+                                       path.tail.value_or(Cost {})});
+
+    // The outermost block of the sequence holds the parameters
+    size_t state_bytes = 0;
+    size_t local_bytes = 0;
+    if (function.sequence != nullptr)
+        block_bytes(table, function.sequence->start, state_bytes, local_bytes);
+
+    if (report.is_async) {
+        // The state index and return value are stored along with the locals
+        report.state_bytes = state_bytes + 1 + (function.has_return_type() ? type_size(function.return_type) : 0);
+    } else {
+        local_bytes += state_bytes;
+    }
+
+    report.stack_bytes = dispatch_frame_bytes + frame_bytes + local_bytes + call_bytes;
+    return report;
+}
+
+const LatencyAnalysis::Callee& LatencyAnalysis::analyze_callee(eelParser::FnDeclContext* function) {
+    auto known = callees.find(function);
+    if (known != callees.end())
+        return known->second;
+
+    auto caller = current;
+    auto caller_call_bytes = call_bytes;
+
+    Report report;
+    current = &report;
+    call_bytes = 0;
+    entered.insert(function);
+    auto path = walk(function->stmtBlock());
+    entered.erase(function);
+
+    Callee callee;
+    callee.cycles = path.through.value_or(Cost {}).cycles;
+    callee.stack_bytes = frame_bytes + declared_bytes(table, function) + call_bytes;
+    callee.extern_calls = report.extern_calls;
+    callee.unbounded_loops = report.unbounded_loops;
+
+    current = caller;
+    call_bytes = caller_call_bytes;
+    return callees[function] = callee;
+}
+
+LatencyAnalysis::Path LatencyAnalysis::walk(antlr4::tree::ParseTree* tree) {
+    if (auto await = dynamic_cast<eelParser::AwaitStmtContext*>(tree)) {
+        current->yield_points++;
+        return Path::yield({await_cycles + expression_cycles(await->expr()), 1});
+    }
+
+    if (auto while_stmt = dynamic_cast<eelParser::WhileStmtContext*>(tree)) {
+        auto condition = Path::of({expression_cycles(while_stmt->conditionBlock()), 0});
+        auto body = walk(while_stmt->stmtBlock());
+
+        if (body.through.has_value() && !body.head.has_value()) {
+            auto iterations = trip_count(while_stmt);
+            if (iterations.has_value())
+                return Path::of(*condition.through + *condition.then(body).through * *iterations);
+
+            // Without yield points the loop runs to completion, we can only account for one iteration
+            current->unbounded_loops++;
+            return condition.then(body).then(condition);
+        }
+
+        // Async loops return to the scheduler at the end of every iteration
+        current->yield_points++;
+        auto iteration = condition.then(body).then(Path::yield({}));
+        return condition.either(iteration.then(iteration).then(condition));
+    }
+
+    if (auto if_stmt = dynamic_cast<eelParser::IfStmtContext*>(tree)) {
+        auto condition = Path::of({expression_cycles(if_stmt->conditionBlock()), 1});
+        auto taken = walk(if_stmt->stmt());
+        auto not_taken = if_stmt->elseStmt() != nullptr ? walk(if_stmt->elseStmt()) : Path::of({});
+        return condition.then(taken.either(not_taken));
+    }
+
+    if (auto stmt = dynamic_cast<eelParser::StmtContext*>(tree)) {
+        if (stmt->expr() != nullptr)
+            return Path::of({expression_cycles(stmt->expr()), 1});
+    }
+
+    if (auto decl = dynamic_cast<eelParser::VariableDeclContext*>(tree))
+        return Path::of({operand_cycles + (decl->expr() != nullptr ? expression_cycles(decl->expr()) : 0), 1});
+
+    if (dynamic_cast<eelParser::EmitStmtContext*>(tree) != nullptr)
+        return Path::of({emit_cycles, 1});
+
+    if (auto set_pin = dynamic_cast<eelParser::SetPinValueStmtContext*>(tree))
+        return Path::of({digital_access_cycles + expression_cycles(set_pin->expr()), 1});
+
+    if (auto set_mode = dynamic_cast<eelParser::SetPinModeStmtContext*>(tree))
+        return Path::of({digital_access_cycles + expression_cycles(set_mode->expr()), 1});
+
+    if (auto return_stmt = dynamic_cast<eelParser::ReturnStmtContext*>(tree))
+        return Path::of({return_stmt->expr() != nullptr ? expression_cycles(return_stmt->expr()) : 0, 1});
+
+    auto path = Path::of({});
+    for (auto child: tree->children)
+        path = path.then(walk(child));
+    return path;
+}
+
+std::optional<uint64_t> LatencyAnalysis::trip_count(eelParser::WhileStmtContext* loop) {
+    auto condition = dynamic_cast<eelParser::ComparisonExprContext*>(loop->conditionBlock()->expr());
+    if (condition == nullptr || dynamic_cast<eelParser::FqnExprContext*>(condition->left) == nullptr)
+        return std::nullopt;
+
+    auto name = condition->left->getText();
+    auto evaluator = ConstEvalVisitor(table.root_scope);
+    auto bound = evaluator.evaluate(condition->right);
+    if (bound.kind != symbols::Constant::Value::Kind::Integer)
+        return std::nullopt;
+
+    // The counter is stepped exactly once in every iteration
+    std::vector<antlr4::tree::ParseTree*> writes;
+    if (!collect_writes(loop->stmtBlock(), name, functions, writes) || writes.size() != 1)
+        return std::nullopt;
+
+    auto stmt = dynamic_cast<eelParser::StmtContext*>(writes.front()->parent);
+    if (stmt == nullptr)
+        return std::nullopt;
+    for (auto block = stmt->parent; block != loop->stmtBlock(); block = block->parent) {
+        if (dynamic_cast<eelParser::StmtsOrLDeclsContext*>(block) == nullptr)
+            return std::nullopt;
+    }
+
+    std::optional<symbols::Constant::Value> step;
+    if (auto assign = dynamic_cast<eelParser::AssignExprContext*>(writes.front())) {
+        auto sum = dynamic_cast<eelParser::AdditiveExprContext*>(assign->right);
+        if (sum != nullptr && sum->left->getText() == name) {
+            step = evaluator.evaluate(sum->right);
+            if (sum->op->getText() == "-")
+                step->integer = -step->integer;
+        }
+    } else if (auto add_assign = dynamic_cast<eelParser::AdditiveAssignExprContext*>(writes.front())) {
+        step = evaluator.evaluate(add_assign->right);
+        if (add_assign->op->getText() == "-=")
+            step->integer = -step->integer;
+    }
+    if (!step.has_value() || step->kind != symbols::Constant::Value::Kind::Integer || step->integer == 0)
+        return std::nullopt;
+
+    eelParser::ExprContext* initializer;
+    Symbol type;
+    if (auto local = find_local(loop, name, initializer)) {
+        type = table.root_scope->find(local->type()->getText());
+    } else {
+        auto global = table.root_scope->find_member(name);
+        if (global.is_nullptr() || global->kind != Symbol_::Kind::Variable)
+            return std::nullopt;
+        type = global->value.variable->type;
+    }
+    if (type.is_nullptr() || type->kind != Symbol_::Kind::Type)
+        return std::nullopt;
+
+    auto type_range = Range::of_type(dynamic_cast<const symbols::Primitive*>(type->value.type));
+    // Negative bounds are converted to unsigned by the comparison,
+    // and bounds outside of the range of the counter make the condition constant
+    if (!type_range.bounded || (bound.integer < 0 && type_range.lo >= 0)
+        || bound.integer < type_range.lo - 1 || bound.integer > type_range.hi + 1)
+        return std::nullopt;
+
+    auto start = type_range;
+    if (initializer != nullptr) {
+        auto initial = evaluator.evaluate(initializer);
+        if (initial.kind == symbols::Constant::Value::Kind::Integer
+            && type_range.contains(Range::exact(initial.integer)))
+            start = Range::exact(initial.integer);
+    }
+
+    // The loop terminates if the last value entering the body is stepped past the bound without wrapping
+    auto op = condition->op->getText();
+    if ((op == "<" || op == "<=") && step->integer > 0) {
+        auto last = op == "<" ? bound.integer - 1 : bound.integer;
+        if (last + step->integer > type_range.hi)
+            return std::nullopt;
+        if (start.lo > last)
+            return 0;
+        return static_cast<uint64_t>(last - start.lo) / step->integer + 1;
+    }
+    if ((op == ">" || op == ">=") && step->integer < 0) {
+        auto last = op == ">" ? bound.integer + 1 : bound.integer;
+        if (last + step->integer < type_range.lo)
+            return std::nullopt;
+        if (start.hi < last)
+            return 0;
+        return static_cast<uint64_t>(start.hi - last) / -step->integer + 1;
+    }
+    return std::nullopt;
+}
+
+uint64_t LatencyAnalysis::expression_cycles(antlr4::tree::ParseTree* tree) {
+    uint64_t cycles = 0;
+
+    if (auto read = dynamic_cast<eelParser::ReadPinExprContext*>(tree)) {
+        auto symbol = resolve_fqn(table.root_scope, read->fqn());
+        auto is_analog = !symbol.is_nullptr() && symbol->kind == Symbol_::Kind::Variable
+                         && !symbol->value.variable->type.is_nullptr()
+                         && symbol->value.variable->type->kind == Symbol_::Kind::Type
+                         && symbol->value.variable->type->value.type == &symbols::Primitive::analog;
+        return is_analog ? analog_read_cycles : digital_access_cycles;
+    } else if (auto call = dynamic_cast<eelParser::FnCallExprContext*>(tree)) {
+        cycles += call_overhead_cycles + call_cycles(call->fqn());
+    } else if (auto call = dynamic_cast<eelParser::InstanceAssociatedFnCallExprContext*>(tree)) {
+        cycles += call_overhead_cycles + call_cycles(call->fqn());
+    } else if (auto scaling = dynamic_cast<eelParser::ScalingExprContext*>(tree)) {
+        cycles += scaling->op->getText() == "*" ? multiply_cycles : divide_cycles;
+    } else if (auto scaling_assign = dynamic_cast<eelParser::ScalingAssignExprContext*>(tree)) {
+        cycles += scaling_assign->op->getText() == "*=" ? multiply_cycles : divide_cycles;
+    } else if (dynamic_cast<eelParser::ShiftingExprContext*>(tree) != nullptr
+               || dynamic_cast<eelParser::ShiftingAssignExprContext*>(tree) != nullptr) {
+        cycles += shift_cycles;
+    } else if (dynamic_cast<eelParser::FqnExprContext*>(tree) != nullptr
+               || dynamic_cast<eelParser::ArrayExprContext*>(tree) != nullptr
+               || dynamic_cast<eelParser::IntegerLiteralContext*>(tree) != nullptr
+               || dynamic_cast<eelParser::FloatLiteralContext*>(tree) != nullptr
+               || dynamic_cast<eelParser::BoolLiteralContext*>(tree) != nullptr
+               || dynamic_cast<eelParser::CharLiteralContext*>(tree) != nullptr) {
+        cycles += operand_cycles;
+    } else if (dynamic_cast<eelParser::ExprContext*>(tree) != nullptr
+               && dynamic_cast<eelParser::ParenExprContext*>(tree) == nullptr) {
+        cycles += operator_cycles;
+    }
+
+    for (auto child: tree->children)
+        cycles += expression_cycles(child);
+    return cycles;
+}
+
+uint64_t LatencyAnalysis::call_cycles(eelParser::FqnContext* fqn) {
+    auto user_function = functions.find(fqn->getText());
+    if (user_function != functions.end()) {
+        // The depth of a recursion is not known, much like the trip count of a loop
+        if (entered.contains(user_function->second)) {
+            current->unbounded_loops++;
+            call_bytes = std::max(call_bytes, frame_bytes);
+            return 0;
+        }
+
+        auto& callee = analyze_callee(user_function->second);
+        current->extern_calls += callee.extern_calls;
+        current->unbounded_loops += callee.unbounded_loops;
+        call_bytes = std::max(call_bytes, callee.stack_bytes);
+        return callee.cycles;
+    }
+
+    auto symbol = resolve_fqn(table.root_scope, fqn);
+    if (!symbol.is_nullptr() && symbol->kind == Symbol_::Kind::ExternFunction) {
+        current->extern_calls++;
+        call_bytes = std::max(call_bytes, extern_call_bytes);
+    } else {
+        call_bytes = std::max(call_bytes, frame_bytes);
+    }
+    return 0;
+}
+
+std::string LatencyAnalysis::Result::to_text() const {
+    std::string text = fmt::format("{:<24} {:>5} {:>8} {:>6} {:>6} {:>9} {:>5} {:>6} {:>6}\n",
+                                   "function", "async", "cycles", "stmts", "yields",
+                                   "unbounded", "calls", "stack", "state");
+
+    for (auto& report: functions) {
+        // Unbounded loops make the estimate a lower bound
+        auto cycles = fmt::format("{}{}", report.longest_segment.cycles, report.unbounded_loops > 0 ? "+" : "");
+        text += fmt::format("{:<24} {:>5} {:>8} {:>6} {:>6} {:>9} {:>5} {:>6} {:>6}\n",
+                            report.name,
+                            report.is_async ? "yes" : "no",
+                            cycles,
+                            report.longest_segment.statements,
+                            report.yield_points,
+                            report.unbounded_loops,
+                            report.extern_calls,
+                            report.stack_bytes,
+                            report.state_bytes);
+    }
+
+    text += fmt::format("SRAM: {} B globals + {} B events = {} B\n",
+                        global_bytes, event_bytes, global_bytes + event_bytes);
+    return text;
+}
+
+std::string LatencyAnalysis::Result::to_json() const {
+    std::string json = "{\n  \"functions\": [";
+
+    for (size_t i = 0; i < functions.size(); i++) {
+        auto& report = functions[i];
+        json += fmt::format("{}\n    {{\"name\": \"{}\", \"async\": {}, \"cycles\": {}, \"statements\": {}, "
+                            "\"yield_points\": {}, \"unbounded_loops\": {}, \"extern_calls\": {}, "
+                            "\"stack_bytes\": {}, \"state_bytes\": {}}}",
+                            i == 0 ? "" : ",",
+                            report.name,
+                            report.is_async ? "true" : "false",
+                            report.longest_segment.cycles,
+                            report.longest_segment.statements,
+                            report.yield_points,
+                            report.unbounded_loops,
+                            report.extern_calls,
+                            report.stack_bytes,
+                            report.state_bytes);
+    }
+
+    json += fmt::format("\n  ],\n  \"sram\": {{\"globals\": {}, \"events\": {}, \"total\": {}}}\n}}\n",
+                        global_bytes, event_bytes, global_bytes + event_bytes);
+    return json;
+}
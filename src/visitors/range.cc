@@ -0,0 +1,445 @@
+#include <Visitors/range.hpp>
+#include <Visitors/utility.hpp>
+#include <symbols/variable.hpp>
+#include <symbols/constant.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <initializer_list>
+
+using namespace eel;
+using namespace eel::visitors;
+using symbols::Primitive;
+
+/*
+ * Range
+ */
+
+Range Range::exact(int64_t value) {
+    return of(value, value);
+}
+
+Range Range::of(int64_t lo, int64_t hi, const Primitive* type) {
+    Range range;
+    range.bounded = true;
+    range.lo = lo;
+    range.hi = hi;
+    range.type = type;
+    return range;
+}
+
+Range Range::of_type(const Primitive* type) {
+    Range range;
+    range.type = type;
+
+    if (type == &Primitive::u8) return of(0, UINT8_MAX, type);
+    if (type == &Primitive::u16) return of(0, UINT16_MAX, type);
+    if (type == &Primitive::u32) return of(0, UINT32_MAX, type);
+    if (type == &Primitive::i8) return of(INT8_MIN, INT8_MAX, type);
+    if (type == &Primitive::i16) return of(INT16_MIN, INT16_MAX, type);
+    if (type == &Primitive::i32) return of(INT32_MIN, INT32_MAX, type);
+    if (type == &Primitive::boolean) return of(0, 1, type);
+
+    // 64-bit, platform dependant and non-integral types are unbounded
+    return range;
+}
+
+bool Range::contains(const Range& other) const {
+    if (!bounded)
+        return true;
+    return other.bounded && lo <= other.lo && other.hi <= hi;
+}
+
+size_t visitors::integer_width(const Primitive* type) {
+    if (type == &Primitive::u8 || type == &Primitive::i8) return 8;
+    if (type == &Primitive::u16 || type == &Primitive::i16) return 16;
+    if (type == &Primitive::u32 || type == &Primitive::i32) return 32;
+    if (type == &Primitive::u64 || type == &Primitive::i64) return 64;
+    return 0;
+}
+
+static bool is_unsigned(const Primitive* type) {
+    return type == &Primitive::u8 || type == &Primitive::u16
+           || type == &Primitive::u32 || type == &Primitive::u64;
+}
+
+const Primitive* visitors::signed_type(size_t width) {
+    switch (width) {
+        case 8: return &Primitive::i8;
+        case 16: return &Primitive::i16;
+        case 32: return &Primitive::i32;
+        case 64: return &Primitive::i64;
+        default: return nullptr;
+    }
+}
+
+const Primitive* visitors::promoted_type(const Primitive* type, size_t int_width) {
+    if (type == &Primitive::boolean)
+        return signed_type(int_width);
+
+    auto width = integer_width(type);
+    if (width != 0 && width < int_width)
+        return signed_type(int_width);
+    return type;
+}
+
+const Primitive* visitors::literal_type(int64_t value, size_t int_width) {
+    for (auto type: std::initializer_list<const Primitive*> {signed_type(int_width), &Primitive::i32}) {
+        if (Range::of_type(type).contains(Range::exact(value)))
+            return type;
+    }
+    return &Primitive::i64;
+}
+
+const Primitive* visitors::arithmetic_type(const Primitive* left, const Primitive* right, size_t int_width) {
+    left = promoted_type(left, int_width);
+    right = promoted_type(right, int_width);
+
+    auto left_width = integer_width(left);
+    auto right_width = integer_width(right);
+    if (left_width == 0 || right_width == 0)
+        return nullptr;
+
+    // After the promotion the wider type wins, for equal widths the unsigned one
+    if (left_width != right_width)
+        return left_width > right_width ? left : right;
+    return is_unsigned(left) ? left : right;
+}
+
+/// Whether every value of the bounded range is representable in the type.
+/// 64-bit types have no bounded range of their own, any value of a range fits `i64`
+/// and every non-negative one fits `u64`.
+static bool fits(const Range& range, const Primitive* type) {
+    if (type == &Primitive::i64)
+        return true;
+    if (type == &Primitive::u64)
+        return range.lo >= 0;
+    return Range::of_type(type).contains(range);
+}
+
+/// Builds the range of a binary operation from its candidate bounds.
+/// If the result does not fit the static type the operation may wrap,
+/// in which case nothing is known beyond the type itself.
+static Range result_of(std::initializer_list<int64_t> bounds, const Primitive* type) {
+    auto range = Range::of(std::min(bounds), std::max(bounds), type);
+    if (!fits(range, type))
+        return Range::of_type(type);
+    return range;
+}
+
+/// Whether any of the (128-bit) bounds are outside of the 64-bit range.
+static bool overflows(std::initializer_list<__int128> bounds) {
+    return std::any_of(bounds.begin(), bounds.end(), [](__int128 v) {
+        return v < INT64_MIN || v > INT64_MAX;
+    });
+}
+
+/// The primitive referred to by a type symbol, if any.
+static const Primitive* primitive_of(Symbol type) {
+    if (type.is_nullptr() || type->kind != Symbol_::Kind::Type)
+        return nullptr;
+    return dynamic_cast<const Primitive*>(type->value.type);
+}
+
+/*
+ * RangeVisitor
+ */
+
+RangeVisitor::RangeVisitor(Scope scope) : scope(scope) {}
+
+const Primitive* RangeVisitor::operand_type(const Range& range) const {
+    if (range.type != nullptr || !range.bounded)
+        return range.type;
+
+    auto lo = literal_type(range.lo, int_width);
+    auto hi = literal_type(range.hi, int_width);
+    return integer_width(lo) > integer_width(hi) ? lo : hi;
+}
+
+const Primitive* RangeVisitor::common_type(const Range& left, const Range& right) const {
+    // Operations on literals only are folded exactly
+    if (left.type == nullptr && right.type == nullptr)
+        return nullptr;
+    return arithmetic_type(operand_type(left), operand_type(right), int_width);
+}
+
+Range RangeVisitor::evaluate(eelParser::ExprContext* ctx) {
+    auto cached = cache.find(ctx);
+    if (cached != cache.end())
+        return cached->second;
+
+    auto range = std::any_cast<Range>(visit(ctx));
+    cache[ctx] = range;
+    return range;
+}
+
+const Primitive* RangeVisitor::narrowed_type(const Range& left, const Range& right, const Range& result,
+                                              bool is_shift) {
+    auto width = integer_width(result.type);
+    if (width <= int_width || !left.bounded || !right.bounded || !result.bounded)
+        return nullptr;
+
+    for (auto candidate: {&Primitive::i16, &Primitive::u16, &Primitive::i32, &Primitive::u32}) {
+        auto candidate_width = integer_width(candidate);
+        // Anything narrower than `int` would be promoted back
+        if (candidate_width >= width || candidate_width < int_width)
+            continue;
+
+        auto range = Range::of_type(candidate);
+        // The shift amount has to stay below the width of the narrower type
+        auto right_fits = is_shift ? right.lo >= 0 && right.hi < static_cast<int64_t>(candidate_width)
+                                   : range.contains(right);
+
+        if (range.contains(left) && right_fits && range.contains(result))
+            return candidate;
+    }
+    return nullptr;
+}
+
+any RangeVisitor::visitChildren(antlr4::tree::ParseTree*) {
+    return Range{};
+}
+
+/*
+ * Literals
+ */
+
+any RangeVisitor::visitIntegerLiteral(eelParser::IntegerLiteralContext* ctx) {
+    auto text = ctx->IntegerLiteral()->getText();
+    auto value = text.size() > 2 && text[1] == 'x'
+                 ? std::strtoull(text.c_str() + 2, nullptr, 16)
+                 : std::strtoull(text.c_str(), nullptr, 10);
+    if (value > INT64_MAX)
+        return Range{};
+    return Range::exact(static_cast<int64_t>(value));
+}
+
+any RangeVisitor::visitCharLiteral(eelParser::CharLiteralContext*) {
+    return Range::of(0, UINT8_MAX);
+}
+
+any RangeVisitor::visitBoolLiteral(eelParser::BoolLiteralContext*) {
+    return Range::of(0, 1);
+}
+
+/*
+ * Access expressions
+ */
+
+any RangeVisitor::visitParenExpr(eelParser::ParenExprContext* ctx) {
+    return evaluate(ctx->expr());
+}
+
+any RangeVisitor::visitFqnExpr(eelParser::FqnExprContext* ctx) {
+    auto symbol = resolve_fqn(scope, ctx->fqn());
+    if (symbol.is_nullptr())
+        return Range{};
+
+    if (symbol->kind == Symbol_::Kind::Constant) {
+        auto constant = symbol->value.constant;
+        auto type = primitive_of(constant->type);
+        if (constant->value.kind == symbols::Constant::Value::Kind::Integer) {
+            auto range = Range::exact(constant->value.integer);
+            range.type = type;
+            return range;
+        }
+        return Range::of_type(type);
+    }
+
+    if (symbol->kind == Symbol_::Kind::Variable)
+        return Range::of_type(primitive_of(symbol->value.variable->type));
+
+    return Range{};
+}
+
+any RangeVisitor::visitArrayExpr(eelParser::ArrayExprContext* ctx) {
+    auto symbol = resolve_fqn(scope, ctx->fqn());
+    if (symbol.is_nullptr() || symbol->kind != Symbol_::Kind::Constant)
+        return Range{};
+
+    // A lookup in a constant table is bounded by the smallest and largest element
+    auto constant = symbol->value.constant;
+    auto type = primitive_of(constant->type);
+    auto& elements = constant->value.elements;
+    if (elements.empty() || elements[0].kind != symbols::Constant::Value::Kind::Integer)
+        return Range::of_type(type);
+
+    auto [lo, hi] = std::minmax_element(elements.begin(), elements.end(), [](auto& a, auto& b) {
+        return a.integer < b.integer;
+    });
+    return Range::of(lo->integer, hi->integer, type);
+}
+
+any RangeVisitor::visitReadPinExpr(eelParser::ReadPinExprContext* ctx) {
+    auto symbol = resolve_fqn(scope, ctx->fqn());
+    if (symbol.is_nullptr() || symbol->kind != Symbol_::Kind::Variable)
+        return Range{};
+
+    if (primitive_of(symbol->value.variable->type) == &Primitive::digital)
+        return Range::of(0, 1);
+    // 10-bit ADC
+    return Range::of(0, 1023);
+}
+
+any RangeVisitor::visitCastExpr(eelParser::CastExprContext* ctx) {
+    auto inner = evaluate(ctx->expr());
+    auto type = primitive_of(scope->find(ctx->type()->getText()));
+    // A cast that keeps every value of the operand keeps its range, also when widening to 64 bits
+    if (!inner.bounded || integer_width(type) == 0 || !fits(inner, type))
+        return Range::of_type(type);
+
+    inner.type = type;
+    return inner;
+}
+
+/*
+ * Unary operators
+ */
+
+any RangeVisitor::visitPos(eelParser::PosContext* ctx) {
+    return evaluate(ctx->right);
+}
+
+any RangeVisitor::visitNeg(eelParser::NegContext* ctx) {
+    auto value = evaluate(ctx->right);
+    auto type = promoted_type(value.type, int_width);
+    if (!value.bounded || value.lo == INT64_MIN)
+        return Range::of_type(type);
+    return result_of({-value.lo, -value.hi}, type);
+}
+
+any RangeVisitor::visitNot(eelParser::NotContext*) {
+    return Range::of(0, 1);
+}
+
+/*
+ * Binary operators
+ */
+
+any RangeVisitor::visitScalingExpr(eelParser::ScalingExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    auto type = common_type(left, right);
+    auto op = ctx->op->getText();
+    if (!left.bounded || !right.bounded)
+        return Range::of_type(type);
+
+    if (op == "*") {
+        __int128 a = left.lo, b = left.hi, c = right.lo, d = right.hi;
+        if (overflows({a * c, a * d, b * c, b * d}))
+            return Range::of_type(type);
+        return result_of({left.lo * right.lo, left.lo * right.hi, left.hi * right.lo, left.hi * right.hi}, type);
+    }
+
+    // The magnitude of a quotient or remainder never exceeds that of the dividend
+    auto magnitude = std::max(std::abs(left.lo), std::abs(left.hi));
+    auto lo = left.lo < 0 ? -magnitude : 0;
+    auto hi = left.hi > 0 ? magnitude : 0;
+
+    if (op == "/") {
+        if (right.lo > 0 || right.hi < 0) {
+            // For divisors of a single sign the extremes are found at the corners
+            return result_of({left.lo / right.lo, left.lo / right.hi, left.hi / right.lo, left.hi / right.hi}, type);
+        }
+        return result_of({lo, hi}, type);
+    }
+
+    // The remainder is also smaller than the largest divisor
+    auto divisor = std::max(std::abs(right.lo), std::abs(right.hi));
+    if (divisor > 0) {
+        lo = std::max(lo, -(divisor - 1));
+        hi = std::min(hi, divisor - 1);
+    }
+    return result_of({lo, hi}, type);
+}
+
+any RangeVisitor::visitAdditiveExpr(eelParser::AdditiveExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    auto type = common_type(left, right);
+    if (!left.bounded || !right.bounded)
+        return Range::of_type(type);
+
+    __int128 a = left.lo, b = left.hi, c = right.lo, d = right.hi;
+    if (ctx->op->getText() == "+") {
+        if (overflows({a + c, b + d}))
+            return Range::of_type(type);
+        return result_of({left.lo + right.lo, left.hi + right.hi}, type);
+    }
+
+    if (overflows({a - d, b - c}))
+        return Range::of_type(type);
+    return result_of({left.lo - right.hi, left.hi - right.lo}, type);
+}
+
+any RangeVisitor::visitShiftingExpr(eelParser::ShiftingExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    // The type of a shift is that of its promoted left operand
+    auto type = left.type == nullptr ? nullptr : promoted_type(left.type, int_width);
+    if (!left.bounded || !right.bounded || right.lo < 0 || right.hi > 62)
+        return Range::of_type(type);
+
+    if (ctx->op->getText() == "<<") {
+        __int128 a = left.lo, b = left.hi;
+        if (left.lo < 0 || overflows({a << right.hi, b << right.hi}))
+            return Range::of_type(type);
+        return result_of({left.lo << right.lo, left.hi << right.hi}, type);
+    }
+
+    // Logical shifts of negative values produce large positive numbers
+    if (ctx->op->getText() == ">>>" && left.lo < 0)
+        return Range::of_type(type);
+
+    return result_of({left.lo >> right.lo, left.lo >> right.hi, left.hi >> right.lo, left.hi >> right.hi}, type);
+}
+
+any RangeVisitor::visitComparisonExpr(eelParser::ComparisonExprContext*) {
+    return Range::of(0, 1);
+}
+
+any RangeVisitor::visitAndExpr(eelParser::AndExprContext* ctx) {
+    auto left = evaluate(ctx->left);
+    auto right = evaluate(ctx->right);
+    auto type = common_type(left, right);
+
+    // Masking with a non-negative value bounds the result by the mask
+    auto left_mask = left.bounded && left.lo >= 0;
+    auto right_mask = right.bounded && right.lo >= 0;
+    if (left_mask && right_mask)
+        return result_of({0, std::min(left.hi, right.hi)}, type);
+    if (left_mask)
+        return result_of({0, left.hi}, type);
+    if (right_mask)
+        return result_of({0, right.hi}, type);
+    return Range::of_type(type);
+}
+
+/// Bounds the result of `|` and `^` for non-negative operands
+/// by the smallest all-ones value covering both operands.
+Range RangeVisitor::bitwise_union(const Range& left, const Range& right) const {
+    auto type = common_type(left, right);
+    if (!left.bounded || !right.bounded || left.lo < 0 || right.lo < 0)
+        return Range::of_type(type);
+
+    uint64_t ones = 0;
+    while (ones < static_cast<uint64_t>(std::max(left.hi, right.hi)))
+        ones = (ones << 1) | 1;
+    return result_of({0, static_cast<int64_t>(ones)}, type);
+}
+
+any RangeVisitor::visitXorExpr(eelParser::XorExprContext* ctx) {
+    return bitwise_union(evaluate(ctx->left), evaluate(ctx->right));
+}
+
+any RangeVisitor::visitOrExpr(eelParser::OrExprContext* ctx) {
+    return bitwise_union(evaluate(ctx->left), evaluate(ctx->right));
+}
+
+any RangeVisitor::visitLAndExpr(eelParser::LAndExprContext*) {
+    return Range::of(0, 1);
+}
+
+any RangeVisitor::visitLOrExpr(eelParser::LOrExprContext*) {
+    return Range::of(0, 1);
+}
@@ -0,0 +1,172 @@
+#include <Visitors/reachability.hpp>
+#include <Visitors/utility.hpp>
+
+#include <fmt/core.h>
+
+using namespace eel;
+using namespace eel::visitors;
+
+ReachabilityAnalysis::ReachabilityAnalysis(SymbolTable& table) : table(table) {}
+
+ReachabilityAnalysis::Result ReachabilityAnalysis::run(eelParser::ProgramContext* program) {
+    Result result;
+
+    for (auto tl_decl: program->tlDecl()) {
+        if (tl_decl->decl() != nullptr && tl_decl->decl()->fnDecl() != nullptr) {
+            auto fn = tl_decl->decl()->fnDecl();
+            functions[fn->Identifier()->getText()] = fn;
+        }
+    }
+
+    for (auto name: {builtin_setup_name, builtin_loop_name}) {
+        auto symbol = table.root_scope->find(name);
+        if (!symbol.is_nullptr() && symbol->kind == Symbol_::Kind::Function)
+            reach(symbol->value.function->body);
+    }
+
+    // Reaching a handle or predicate may reveal further emits and awaits,
+    // so we keep going until no more code becomes reachable.
+    auto changed = true;
+    while (changed) {
+        while (!worklist.empty()) {
+            auto body = worklist.back();
+            worklist.pop_back();
+            scan(body);
+        }
+
+        changed = false;
+        for (size_t i = 0; i < table.get_symbol_count(); i++) {
+            auto symbol = table.get_symbol(i);
+            if (symbol->kind != Symbol_::Kind::Event)
+                continue;
+
+            auto event = symbol->value.event;
+            auto occurs = event->has_predicate || emitted.contains(event);
+            auto is_live = awaited.contains(event) || (occurs && !event->get_handles().empty());
+            if (!is_live)
+                continue;
+
+            if (event->has_predicate && event->predicate->body != nullptr && !reached.contains(event->predicate->body)) {
+                reach(event->predicate->body);
+                changed = true;
+            }
+
+            if (!occurs)
+                continue;
+
+            for (auto& handle: event->get_handles()) {
+                if (!reached.contains(handle.second.body)) {
+                    reach(handle.second.body);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    Symbol used_builtin;
+    for (size_t i = 0; i < table.get_symbol_count(); i++) {
+        auto symbol = table.get_symbol(i);
+        if (symbol->kind != Symbol_::Kind::Event)
+            continue;
+
+        auto event = symbol->value.event;
+        auto& handles = event->get_handles();
+        auto occurs = event->has_predicate || emitted.contains(event);
+        event->is_awaited = awaited.contains(event);
+
+        if (!event->builtin_predicate.empty()) {
+            // Built-in events are declared in every program, only the used ones are of interest
+            if (!event->is_awaited && handles.empty())
+                continue;
+
+            // Polling either event releases the view of the received bytes handed to the other
+            if (used_builtin.is_nullptr()) {
+                used_builtin = symbol;
+            } else {
+                antlr4::ParserRuleContext* site = event->is_awaited ? awaited[event] : nullptr;
+                for (auto& handle: handles) {
+                    if (site == nullptr || handle.second.body->getStart()->getTokenIndex() < site->getStart()->getTokenIndex())
+                        site = handle.second.body;
+                }
+                result.errors.emplace_back(Error::Unsupported, site->getStart(), site,
+                                           fmt::format("using both `{}` and `{}`, which share the serial receive buffer",
+                                                       used_builtin->name, symbol->name));
+            }
+        }
+
+        if (!event->is_awaited && !(occurs && !handles.empty())) {
+            result.dead_events.insert(event);
+            for (auto& handle: handles)
+                result.dead_functions.insert(&handle.second);
+            if (event->has_predicate)
+                result.dead_functions.insert(event->predicate);
+
+            // Emitting an event that nobody listens to has no effect
+            for (auto site: emit_sites[event])
+                result.dead_statements.insert(site);
+
+            result.log.push_back(fmt::format("event `{}` removed: {}",
+                                             symbol->name,
+                                             occurs ? "never awaited and has no handles"
+                                                    : "never awaited and never occurs"));
+        } else if (!occurs && !handles.empty()) {
+            for (auto& handle: handles)
+                result.dead_functions.insert(&handle.second);
+
+            result.log.push_back(fmt::format("{} handle(s) of event `{}` removed: the event never occurs",
+                                             handles.size(),
+                                             symbol->name));
+        }
+    }
+
+    for (auto& [name, fn]: functions) {
+        if (!reached.contains(fn->stmtBlock())) {
+            result.dead_declarations.insert(fn);
+            result.log.push_back(fmt::format("function `{}` removed: never called", name));
+        } else {
+            // Code is only generated for functions declared with `declare_fn_cpp`
+            result.errors.emplace_back(Error::Unsupported, fn->Identifier()->getSymbol(), fn,
+                                       fmt::format("calling the user-defined function `{}`", name));
+        }
+    }
+
+    return result;
+}
+
+void ReachabilityAnalysis::reach(antlr4::tree::ParseTree* body) {
+    if (body == nullptr || reached.contains(body))
+        return;
+    reached.insert(body);
+    worklist.push_back(body);
+}
+
+symbols::Event* ReachabilityAnalysis::find_event(eelParser::FqnContext* fqn) {
+    // Events can only be declared in the root scope
+    auto symbol = resolve_fqn(table.root_scope, fqn);
+    if (symbol.is_nullptr() || symbol->kind != Symbol_::Kind::Event)
+        return nullptr;
+    return symbol->value.event;
+}
+
+void ReachabilityAnalysis::scan(antlr4::tree::ParseTree* tree) {
+    if (auto await = dynamic_cast<eelParser::AwaitStmtContext*>(tree)) {
+        auto fqn = dynamic_cast<eelParser::FqnExprContext*>(await->expr());
+        if (fqn != nullptr) {
+            if (auto event = find_event(fqn->fqn()))
+                awaited.emplace(event, await);
+        }
+    } else if (auto emit = dynamic_cast<eelParser::EmitStmtContext*>(tree)) {
+        if (auto event = find_event(emit->fqn())) {
+            emitted.insert(event);
+            // The enclosing `stmt` is what codegen visits
+            emit_sites[event].push_back(dynamic_cast<antlr4::ParserRuleContext*>(emit->parent));
+        }
+    } else if (auto call = dynamic_cast<eelParser::FnCallExprContext*>(tree)) {
+        auto fn = functions.find(call->fqn()->getText());
+        if (fn != functions.end())
+            reach(fn->second->stmtBlock());
+    }
+
+    for (auto child: tree->children)
+        scan(child);
+}
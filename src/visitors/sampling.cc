@@ -0,0 +1,81 @@
+#include <Visitors/sampling.hpp>
+#include <Visitors/const_eval.hpp>
+#include <Visitors/utility.hpp>
+#include <symbols/event.hpp>
+#include <symbols/type.hpp>
+
+#include <fmt/core.h>
+
+using namespace eel;
+using namespace eel::visitors;
+
+InputSampling::InputSampling(SymbolTable& table) : table(table) {}
+
+InputSampling::Result InputSampling::run(eelParser::ProgramContext* program) {
+    Result result;
+    find_renumbered(program);
+
+    for (size_t i = 0; i < table.get_symbol_count(); i++) {
+        auto symbol = table.get_symbol(i);
+        if (symbol->kind != Symbol_::Kind::Event)
+            continue;
+
+        auto event = symbol->value.event;
+        if (event->has_predicate && event->predicate->body != nullptr)
+            find_reads(event->predicate->body);
+    }
+
+    // Pins are visited in declaration order to keep the generated code stable
+    for (auto tl_decl: program->tlDecl()) {
+        auto decl = tl_decl->decl();
+        if (decl == nullptr || decl->lDecl() == nullptr || decl->lDecl()->pinDecl() == nullptr)
+            continue;
+
+        auto pin_decl = decl->lDecl()->pinDecl();
+        auto name = pin_decl->Identifier()->getText();
+        auto symbol = table.root_scope->find_member(name);
+        if (symbol.is_nullptr() || !read.contains(symbol->id))
+            continue;
+
+        auto is_digital = pin_decl->PinType()->getText() == symbols::Primitive::digital.type_source_name();
+        auto pin_id = ConstEvalVisitor(table.root_scope).evaluate(pin_decl->expr());
+        auto is_constant = pin_id.kind == symbols::Constant::Value::Kind::Integer
+                           && pin_id.integer >= 0 && pin_id.integer <= UINT8_MAX
+                           && !renumbered.contains(symbol->id);
+
+        if (is_digital && is_constant) {
+            result.snapshot_pins.emplace_back(symbol->id, static_cast<uint8_t>(pin_id.integer));
+            result.log.push_back(fmt::format("pin `{}` read from the digital snapshot", name));
+        } else {
+            result.sampled_pins.push_back(symbol->id);
+            result.log.push_back(fmt::format("pin `{}` sampled individually: {}",
+                                             name,
+                                             is_digital ? "pin id is not constant" : "analog pin"));
+        }
+    }
+
+    return result;
+}
+
+void InputSampling::find_reads(antlr4::tree::ParseTree* tree) {
+    if (auto read_pin = dynamic_cast<eelParser::ReadPinExprContext*>(tree)) {
+        // Pins can only be shared between predicates if declared globally
+        auto symbol = resolve_fqn(table.root_scope, read_pin->fqn());
+        if (!symbol.is_nullptr() && symbol->kind == Symbol_::Kind::Variable)
+            read.insert(symbol->id);
+    }
+
+    for (auto child: tree->children)
+        find_reads(child);
+}
+
+void InputSampling::find_renumbered(antlr4::tree::ParseTree* tree) {
+    if (auto set_pin = dynamic_cast<eelParser::SetPinNumberStmtContext*>(tree)) {
+        auto symbol = resolve_fqn(table.root_scope, set_pin->fqn());
+        if (!symbol.is_nullptr())
+            renumbered.insert(symbol->id);
+    }
+
+    for (auto child: tree->children)
+        find_renumbered(child);
+}
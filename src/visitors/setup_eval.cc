@@ -0,0 +1,168 @@
+#include <Visitors/setup_eval.hpp>
+#include <Visitors/utility.hpp>
+#include <symbols/function.hpp>
+#include <symbols/variable.hpp>
+#include <symbols/type.hpp>
+
+#include <fmt/core.h>
+
+using namespace eel;
+using namespace eel::visitors;
+using Value = SetupEvaluator::Value;
+
+/// Returns the type of a variable, following indirect type symbols.
+static const symbols::Type* variable_type(SymbolTable& table, Symbol symbol) {
+    auto type = symbol->value.variable->type;
+    if (type->kind == Symbol_::Kind::Indirect && type->value.indirect.is_set())
+        type = table.get_symbol(type->value.indirect.id);
+    if (type->kind != Symbol_::Kind::Type)
+        return nullptr;
+    return type->value.type;
+}
+
+/// Collects the ids of all symbols referred to within the given subtree.
+static void collect_references(Scope scope, antlr4::tree::ParseTree* tree, std::unordered_set<Symbol::Id>& out) {
+    if (auto identifier = dynamic_cast<eelParser::IdentifierContext*>(tree)) {
+        auto symbol = scope->find(identifier->getText());
+        if (!symbol.is_nullptr())
+            out.insert(symbol->id);
+        return;
+    }
+
+    for (auto child: tree->children)
+        collect_references(scope, child, out);
+}
+
+static std::string describe(const Value& value) {
+    switch (value.kind) {
+        case Value::Kind::Integer:
+            return fmt::format("{}", value.integer);
+        case Value::Kind::Float:
+            return fmt::format("{}", value.floating);
+        case Value::Kind::Bool:
+            return value.boolean ? "true" : "false";
+        default:
+            return "?";
+    }
+}
+
+SetupEvaluator::SetupEvaluator(SymbolTable& table)
+        : ConstEvalVisitor(table.root_scope), table(table) {}
+
+Value SetupEvaluator::lookup(const Symbol& symbol) {
+    auto binding = bindings.find(symbol->id);
+    if (binding != bindings.end())
+        return binding->second;
+    return ConstEvalVisitor::lookup(symbol);
+}
+
+SetupEvaluator::Result SetupEvaluator::run(eelParser::ProgramContext* program) {
+    bind_globals(program);
+
+    auto setup = table.root_scope->find(builtin_setup_name);
+    if (setup.is_nullptr() || setup->kind != Symbol_::Kind::Function)
+        return std::move(result);
+
+    auto function = setup->value.function;
+    scope = function->scope;
+
+    // The body of setup is a right-recursive list of statements and declarations.
+    auto list = function->body->stmtsOrLDecls();
+    while (list != nullptr && (list->stmt() != nullptr || list->lDecl() != nullptr)) {
+        if (auto decl = list->lDecl()) {
+            // Constants are already computed by the scope analysis
+            if (decl->constDecl() != nullptr) {
+                list = list->stmtsOrLDecls();
+                continue;
+            }
+            if (decl->variableDecl() == nullptr || !interpret(decl->variableDecl()))
+                break;
+        } else if (!interpret(list->stmt())) {
+            break;
+        }
+        list = list->stmtsOrLDecls();
+    }
+
+    return std::move(result);
+}
+
+void SetupEvaluator::bind_globals(eelParser::ProgramContext* program) {
+    scope = table.root_scope;
+
+    for (auto tl_decl: program->tlDecl()) {
+        auto decl = tl_decl->decl();
+        if (decl == nullptr || decl->lDecl() == nullptr || decl->lDecl()->variableDecl() == nullptr)
+            continue;
+
+        auto var_decl = decl->lDecl()->variableDecl();
+        auto symbol = table.root_scope->find_member(var_decl->typedIdentifier()->Identifier()->getText());
+        if (symbol.is_nullptr() || symbol->kind != Symbol_::Kind::Variable)
+            continue;
+
+        auto type = variable_type(table, symbol);
+        if (var_decl->expr() == nullptr) {
+            // Globals without an initializer are zero initialised
+            bindings[symbol->id] = Value::from_integer(0).cast(type);
+            continue;
+        }
+
+        collect_references(table.root_scope, var_decl->expr(), pinned_globals);
+
+        auto value = evaluate(var_decl->expr());
+        if (value.is_scalar())
+            bindings[symbol->id] = value.cast(type);
+    }
+}
+
+bool SetupEvaluator::interpret(eelParser::VariableDeclContext* ctx) {
+    auto symbol = scope->find_member(ctx->typedIdentifier()->Identifier()->getText());
+    if (symbol.is_nullptr() || symbol->kind != Symbol_::Kind::Variable)
+        return false;
+
+    // Locals are left as is, their value is only tracked
+    // such that later statements can refer to them.
+    if (ctx->expr() == nullptr)
+        return true;
+
+    auto value = evaluate(ctx->expr());
+    if (!value.is_scalar())
+        return false;
+
+    bindings[symbol->id] = value.cast(variable_type(table, symbol));
+    return true;
+}
+
+bool SetupEvaluator::interpret(eelParser::StmtContext* ctx) {
+    auto assign = dynamic_cast<eelParser::AssignExprContext*>(ctx->expr());
+    if (assign == nullptr)
+        return false;
+
+    auto target = dynamic_cast<eelParser::FqnExprContext*>(assign->var);
+    if (target == nullptr)
+        return false;
+
+    auto symbol = resolve_fqn(scope, target->fqn());
+    if (symbol.is_nullptr() || symbol->kind != Symbol_::Kind::Variable)
+        return false;
+
+    auto value = evaluate(assign->right);
+    if (!value.is_scalar())
+        return false;
+
+    value = value.cast(variable_type(table, symbol));
+    bindings[symbol->id] = value;
+
+    auto is_global = table.root_scope->find_member(symbol->name) == symbol;
+    if (is_global && !pinned_globals.contains(symbol->id)) {
+        result.initial_values[symbol->id] = value;
+        result.elided_statements.insert(ctx);
+        result.log.push_back(fmt::format("{}:{}: `{}` folded into initial value of `{}` ({})",
+                                         ctx->getStart()->getLine(),
+                                         ctx->getStart()->getCharPositionInLine(),
+                                         get_source_text(ctx),
+                                         symbol->name,
+                                         describe(value)));
+    }
+
+    return true;
+}
@@ -25,4 +25,13 @@ Error::Pos visitors::get_source_location(antlr4::Token* token) {
         token->getLine(),
         token->getCharPositionInLine(),
     };
+}
+
+std::vector<eelParser::ExprContext*> visitors::flatten_expr_list(eelParser::ExprListContext* list) {
+    std::vector<eelParser::ExprContext*> exprs;
+    while (list != nullptr) {
+        exprs.push_back(list->expr());
+        list = list->exprList();
+    }
+    return exprs;
 }
\ No newline at end of file
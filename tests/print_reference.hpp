@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+/*
+ * The generic formatting of the arduino `Print` class, used as the reference
+ * for `print_format`. `F` is the type `double` has on the target,
+ * which is a 32-bit float on AVR.
+ */
+namespace print_reference {
+
+    inline std::string print_number(unsigned long n, uint8_t base = 10) {
+        char buf[8 * sizeof(long) + 1];
+        char* str = &buf[sizeof(buf) - 1];
+        *str = '\0';
+
+        if (base < 2)
+            base = 10;
+
+        do {
+            char c = static_cast<char>(n % base);
+            n /= base;
+            *--str = static_cast<char>(c < 10 ? c + '0' : c + 'A' - 10);
+        } while (n);
+
+        return str;
+    }
+
+    template<typename F>
+    std::string print_float(F number, uint8_t digits) {
+        if (std::isnan(number)) return "nan";
+        if (std::isinf(number)) return "inf";
+        if (number > F(4294967040.0)) return "ovf";
+        if (number < F(-4294967040.0)) return "ovf";
+
+        std::string text;
+        if (number < F(0.0)) {
+            text += '-';
+            number = -number;
+        }
+
+        F rounding = 0.5;
+        for (uint8_t i = 0; i < digits; ++i)
+            rounding /= F(10.0);
+
+        number += rounding;
+
+        auto int_part = static_cast<uint32_t>(number);
+        F remainder = number - static_cast<F>(int_part);
+        text += print_number(int_part);
+
+        if (digits > 0)
+            text += '.';
+
+        while (digits-- > 0) {
+            remainder *= F(10.0);
+            auto to_print = static_cast<unsigned int>(remainder);
+            text += print_number(to_print);
+            remainder -= static_cast<F>(to_print);
+        }
+
+        return text;
+    }
+}
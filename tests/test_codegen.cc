@@ -0,0 +1,135 @@
+#include <catch.hpp>
+#include <sstream>
+#include <string>
+#include "antlr4-runtime.h"
+#include "eelLexer.h"
+#include "eelParser.h"
+#include "Visitors/ScopeVisitor.hpp"
+#include "Visitors/TypeVisitor.hpp"
+#include "Visitors/codegen.hpp"
+
+using namespace std;
+using namespace antlr4;
+using namespace eel;
+
+#define CODEGEN(String) \
+    ANTLRInputStream input(String); \
+    eelLexer lexer(&input); \
+    CommonTokenStream tokens(&lexer); \
+    tokens.fill(); \
+    eelParser parser(&tokens); \
+    auto tree = parser.program(); \
+    SymbolTable table; \
+    ScopeVisitor scope_visitor(&table); \
+    scope_visitor.visitProgram(tree); \
+    TypeVisitor(&table).visitProgram(tree); \
+    stringstream output; \
+    visitors::CodegenVisitor codegen(table, &output); \
+    codegen.pre_include_hook = [](){}; \
+    codegen.visitProgram(tree); \
+    auto code = output.str(); \
+
+
+TEST_CASE("constant divisions are carried out in the promoted type", "[codegen]") {
+    CODEGEN("u8 x; u8 y; u16 z; loop { z = (x + y) / 10; z = x % 7; }")
+    // The sum of two u8 may exceed 255, so it must not be divided as u8
+    REQUIRE(code.find("div_const<i16, 10>") != string::npos);
+    REQUIRE(code.find("mod_const<i16, 7>") != string::npos);
+    REQUIRE(code.find("div_const<u8") == string::npos);
+}
+
+TEST_CASE("prints in async code keep every argument", "[codegen]") {
+    CODEGEN("event e; loop { await e; serial_print(42, 16); serial_println(42, 16); }")
+    REQUIRE(code.find("serial_try_print(42,16)") != string::npos);
+    REQUIRE(code.find("serial_try_println(42,16)") != string::npos);
+    REQUIRE(code.find(",)") == string::npos);
+}
+
+TEST_CASE("emits are latched once per pass of the main loop", "[codegen]") {
+    CODEGEN("event e; on e {} loop { emit e; await e; }")
+    auto latch = code.find("latch_emits(");
+    REQUIRE(latch != string::npos);
+    // Latched before the dispatch, awaits only test the emit without consuming it
+    REQUIRE(latch < code.find("run_handles<"));
+    REQUIRE(code.find(".has_emit_flag()") != string::npos);
+    REQUIRE(code.find("take_emit_flag") == string::npos);
+}
+
+TEST_CASE("built-in events poll the runtime", "[codegen]") {
+    CODEGEN("on serial_line {} loop {}")
+    REQUIRE(code.find("static bool invoke() { return serial_poll_line(); }") != string::npos);
+    REQUIRE(code.find("serial_poll_data") == string::npos);
+}
+
+TEST_CASE("handles with sliced loops resume without their event", "[codegen]") {
+    ANTLRInputStream input("event e; on e { u16 i = 0; while (i < 1000) { i = i + 1; } } loop { emit e; }");
+    eelLexer lexer(&input);
+    CommonTokenStream tokens(&lexer);
+    tokens.fill();
+    eelParser parser(&tokens);
+    auto tree = parser.program();
+    SymbolTable table;
+    ScopeVisitor scope_visitor(&table);
+    scope_visitor.time_slicing = true;
+    scope_visitor.visitProgram(tree);
+    TypeVisitor(&table).visitProgram(tree);
+    stringstream output;
+    visitors::CodegenVisitor codegen(table, &output);
+    codegen.pre_include_hook = [](){};
+    codegen.sliced_loops = scope_visitor.sliced_loops;
+    codegen.visitProgram(tree);
+    auto code = output.str();
+
+    REQUIRE(code.find("TimeSlicedHandle<") != string::npos);
+    REQUIRE(code.find("begin_time_slice();") != string::npos);
+}
+
+TEST_CASE("line directives map statements and declarations to the source", "[codegen]") {
+    ANTLRInputStream input("u8 x = 0;\n"
+                           "loop {\n"
+                           "    x = x + 1;\n"
+                           "}\n");
+    eelLexer lexer(&input);
+    CommonTokenStream tokens(&lexer);
+    tokens.fill();
+    eelParser parser(&tokens);
+    auto tree = parser.program();
+    SymbolTable table;
+    ScopeVisitor scope_visitor(&table);
+    scope_visitor.visitProgram(tree);
+    TypeVisitor(&table).visitProgram(tree);
+    stringstream output;
+    visitors::CodegenVisitor codegen(table, &output);
+    codegen.pre_include_hook = [](){};
+    codegen.source_path = "src/count.eel";
+    codegen.visitProgram(tree);
+    auto code = output.str();
+
+    REQUIRE(codegen.source_map.size() == 2);
+    auto& variable = codegen.source_map[0];
+    REQUIRE(variable.kind == "variable");
+    REQUIRE(variable.name == "x");
+    REQUIRE(variable.line == 1);
+    auto& loop = codegen.source_map[1];
+    REQUIRE(loop.kind == "loop");
+    REQUIRE(loop.name == "loop");
+    REQUIRE(loop.line == 2);
+
+    // Directives are on a line of their own, right before the code of their line
+    auto declaration = code.find("\n#line 1 \"src/count.eel\"\n");
+    REQUIRE(declaration != string::npos);
+    REQUIRE(declaration < code.find(variable.generated));
+
+    auto functor = code.find("struct " + loop.generated);
+    auto body = code.find("\n#line 2 \"src/count.eel\"\n", functor);
+    auto statement = code.find("\n#line 3 \"src/count.eel\"\n", body);
+    REQUIRE(functor != string::npos);
+    REQUIRE(body != string::npos);
+    REQUIRE(statement != string::npos);
+    REQUIRE(code.find(variable.generated + " = ", statement) != string::npos);
+
+    // Code that does not stem from a line of the source is marked as generated
+    auto glue = code.find("\n#line 1 \"<generated>\"\n", statement);
+    REQUIRE(glue != string::npos);
+    REQUIRE(glue < code.find("int main(void)"));
+}
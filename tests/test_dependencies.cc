@@ -0,0 +1,53 @@
+#include <catch.hpp>
+#include <string>
+#include "antlr4-runtime.h"
+#include "eelLexer.h"
+#include "eelParser.h"
+#include "Visitors/ScopeVisitor.hpp"
+#include "Visitors/dependencies.hpp"
+
+using namespace std;
+using namespace antlr4;
+using namespace eel;
+
+#define PREDICATE_DEPENDENCIES(String) \
+    ANTLRInputStream input(String); \
+    eelLexer lexer(&input); \
+    CommonTokenStream tokens(&lexer); \
+    tokens.fill(); \
+    eelParser parser(&tokens); \
+    auto tree = parser.program(); \
+    SymbolTable table; \
+    ScopeVisitor scope_visitor(&table); \
+    scope_visitor.visitProgram(tree); \
+    auto result = visitors::PredicateDependencies(table).run(tree); \
+
+
+TEST_CASE("predicates reading only variables are cached", "[dependencies]") {
+    PREDICATE_DEPENDENCIES("u8 x = 0; u8 y = 0; event a { return x > y; } on a {} loop { x = x + 1; }")
+    auto a = table.root_scope->find("a")->value.event;
+    REQUIRE(result.cached.size() == 1);
+    REQUIRE(result.cached.contains(a));
+
+    auto index = result.cached[a];
+    auto x = table.root_scope->find("x")->id;
+    auto y = table.root_scope->find("y")->id;
+    REQUIRE(result.dependents[x] == vector<size_t> {index});
+    REQUIRE(result.dependents[y] == vector<size_t> {index});
+}
+
+TEST_CASE("predicates reading pins are polled", "[dependencies]") {
+    PREDICATE_DEPENDENCIES("pin p digital(1); event a { return read p; } on a {}")
+    REQUIRE(result.cached.empty());
+    REQUIRE(result.dependents.empty());
+}
+
+TEST_CASE("predicates calling functions are polled", "[dependencies]") {
+    PREDICATE_DEPENDENCIES("fn f() -> bool { return true; } event a { return f(); } on a {}")
+    REQUIRE(result.cached.empty());
+}
+
+TEST_CASE("predicates reading referenced variables are polled", "[dependencies]") {
+    PREDICATE_DEPENDENCIES("u8 x = 0; event a { return x > 1; } on a {} loop { u8& r = x; r = 2; }")
+    REQUIRE(result.cached.empty());
+}
@@ -0,0 +1,105 @@
+#include <catch.hpp>
+#include <string>
+#include "antlr4-runtime.h"
+#include "eelLexer.h"
+#include "eelParser.h"
+#include "Visitors/ScopeVisitor.hpp"
+#include "Visitors/latency.hpp"
+
+using namespace std;
+using namespace antlr4;
+using namespace eel;
+
+#define LATENCY_ANALYSIS(String) \
+    ANTLRInputStream input(String); \
+    eelLexer lexer(&input); \
+    CommonTokenStream tokens(&lexer); \
+    tokens.fill(); \
+    eelParser parser(&tokens); \
+    auto tree = parser.program(); \
+    SymbolTable table; \
+    table.root_scope->declare_fn_cpp("ext", "ext", {}); \
+    ScopeVisitor scope_visitor(&table); \
+    scope_visitor.visitProgram(tree); \
+    auto result = visitors::LatencyAnalysis(table).run(tree); \
+
+
+TEST_CASE("awaits split the longest segment", "[latency]") {
+    LATENCY_ANALYSIS("u8 x = 0; setup { x = x + 1; x = x * 2; x = x / 3; } loop { x = x + 1; x = x * 2; await true; x = x / 3; }")
+    REQUIRE(result.functions.size() == 2);
+    auto& setup = result.functions[0];
+    auto& loop = result.functions[1];
+
+    REQUIRE(setup.name == "setup");
+    REQUIRE_FALSE(setup.is_async);
+    REQUIRE(setup.yield_points == 0);
+    REQUIRE(setup.longest_segment.statements == 3);
+
+    REQUIRE(loop.is_async);
+    REQUIRE(loop.yield_points == 1);
+    REQUIRE(loop.longest_segment.statements == 2);
+    REQUIRE(loop.longest_segment.cycles < setup.longest_segment.cycles);
+}
+
+TEST_CASE("loops, calls and analog reads are accounted for", "[latency]") {
+    LATENCY_ANALYSIS("pin a analog(0); pin d digital(1); u16 x = 0;"
+                     "setup { x = read d; } loop { while (x > 0) { x = read a; } ext(x); }")
+    auto& setup = result.functions[0];
+    auto& loop = result.functions[1];
+
+    REQUIRE(loop.unbounded_loops == 1);
+    REQUIRE(loop.extern_calls == 1);
+    REQUIRE(loop.longest_segment.cycles > setup.longest_segment.cycles + 1000);
+    REQUIRE(loop.stack_bytes > setup.stack_bytes);
+}
+
+TEST_CASE("loops counting towards a constant bound are bounded", "[latency]") {
+    LATENCY_ANALYSIS("u16 x = 0; setup { u8 i = 0; while (i < 10) { x = x / 3; i = i + 1; } }"
+                     "loop { i8 k = 100; while (k > 0) { k -= 2; }"
+                     "u8 n = 0; while (n <= 255) { n = n + 1; }"
+                     "u8 m = 0; while (m < 10) { if (x > 2) { m = m + 1; } } }")
+    auto& setup = result.functions[0];
+    auto& loop = result.functions[1];
+
+    REQUIRE(setup.unbounded_loops == 0);
+    REQUIRE(setup.longest_segment.cycles > 10 * 220);
+    REQUIRE(setup.longest_segment.cycles < 2 * 10 * 220);
+
+    // `n` wraps around before passing the bound and `m` is not stepped in every iteration
+    REQUIRE(loop.unbounded_loops == 2);
+}
+
+TEST_CASE("calls of user-defined functions are followed into their body", "[latency]") {
+    LATENCY_ANALYSIS("u16 x = 0; fn idle() {} fn work(u16 y) { u32 z = y; x = x / 3; x = x / 5; ext(x); }"
+                     "setup { idle(); } loop { work(x); }")
+    auto& setup = result.functions[0];
+    auto& loop = result.functions[1];
+
+    // Only functions declared with `declare_fn_cpp` are external
+    REQUIRE(setup.extern_calls == 0);
+    REQUIRE(loop.extern_calls == 1);
+    REQUIRE(loop.longest_segment.cycles > setup.longest_segment.cycles + 2 * 220);
+    // The frame and locals of `work` on top of the stack of `ext`
+    REQUIRE(loop.stack_bytes == setup.stack_bytes + 2 + 4 + 16);
+}
+
+TEST_CASE("sram footprint of globals and events", "[latency]") {
+    LATENCY_ANALYSIS("u8 a = 0; u32 b = 0; pin p digital(2);"
+                     "event e; on e { await true; } loop { u16 n = 0; emit e; await true; n = n + 1; }")
+    REQUIRE(result.global_bytes == 6);
+
+    // State index and the local kept across the await
+    auto& loop = result.functions[0];
+    REQUIRE(loop.is_async);
+    REQUIRE(loop.state_bytes == 3);
+
+    auto& handle = result.functions[1];
+    REQUIRE(handle.name.starts_with("on e"));
+    REQUIRE(handle.is_async);
+    REQUIRE(handle.state_bytes == 1);
+    // Status flags, counters and the handle state
+    REQUIRE(result.event_bytes == 1 + 2 + 1);
+
+    auto json = result.to_json();
+    REQUIRE(json.find("\"total\": 10") != string::npos);
+}
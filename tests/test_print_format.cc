@@ -0,0 +1,80 @@
+#include <catch.hpp>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+#include <arduino/print_format.h>
+#include "print_reference.hpp"
+
+using namespace std;
+
+static string decimal(uint32_t n) {
+    char buf[10];
+    auto end = buf + sizeof(buf);
+    return {print_format::format_decimal(n, end), end};
+}
+
+static string fixed(float number, uint8_t digits) {
+    char buf[print_format::fixed_length(print_format::max_fixed_digits)];
+    return {buf, print_format::format_fixed(buf, number, digits)};
+}
+
+static float from_bits(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+TEST_CASE("decimal formatting matches Print for every u16", "[print_format]") {
+    for (uint32_t n = 0; n <= 0xFFFF; n++)
+        REQUIRE(decimal(n) == print_reference::print_number(n));
+}
+
+TEST_CASE("decimal formatting matches Print for u32 samples", "[print_format]") {
+    for (uint32_t n: {65536u, 99999u, 100000u, 999999999u, 1000000000u, 4294967295u})
+        REQUIRE(decimal(n) == print_reference::print_number(n));
+
+    mt19937 random(42);
+    for (int i = 0; i < 1'000'000; i++) {
+        auto n = static_cast<uint32_t>(random());
+        // Spread the samples over all magnitudes
+        n >>= random() % 32;
+        REQUIRE(decimal(n) == print_reference::print_number(n));
+    }
+}
+
+TEST_CASE("the rounding table matches the rounding loop", "[print_format]") {
+    float rounding = 0.5f;
+    for (uint8_t digits = 0; digits <= print_format::max_fixed_digits; digits++) {
+        REQUIRE(print_format::read_rounding(digits) == rounding);
+        rounding /= 10.0f;
+    }
+}
+
+TEST_CASE("fixed formatting matches Print for special values", "[print_format]") {
+    for (float number: {numeric_limits<float>::quiet_NaN(), numeric_limits<float>::infinity(),
+                        -numeric_limits<float>::infinity(), 4294967040.0f, -4294967040.0f, 4294967296.0f,
+                        -4294967296.0f, 0.0f, -0.0f, 0.995f, 9.999f, -1.005f, 1e-30f,
+                        numeric_limits<float>::denorm_min(), 16777217.0f}) {
+        for (uint8_t digits = 0; digits <= print_format::max_fixed_digits; digits++)
+            REQUIRE(fixed(number, digits) == print_reference::print_float<float>(number, digits));
+    }
+}
+
+TEST_CASE("fixed formatting matches Print for float samples", "[print_format]") {
+    mt19937 random(7);
+    uniform_int_distribution<int> exponent(-40, 33);
+    uniform_real_distribution<float> mantissa(-1.0f, 1.0f);
+    uniform_int_distribution<uint32_t> any_bits;
+
+    for (int i = 0; i < 200'000; i++) {
+        // Both numbers of typical magnitudes and arbitrary bit patterns
+        auto number = ldexp(mantissa(random), exponent(random));
+        auto bits = from_bits(any_bits(random));
+        auto digits = static_cast<uint8_t>(random() % (print_format::max_fixed_digits + 1));
+
+        REQUIRE(fixed(number, digits) == print_reference::print_float<float>(number, digits));
+        REQUIRE(fixed(bits, digits) == print_reference::print_float<float>(bits, digits));
+    }
+}
@@ -0,0 +1,122 @@
+#include <catch.hpp>
+#include <string>
+#include "antlr4-runtime.h"
+#include "eelLexer.h"
+#include "eelParser.h"
+#include "Visitors/ScopeVisitor.hpp"
+#include "Visitors/range.hpp"
+
+using namespace std;
+using namespace antlr4;
+using namespace eel;
+
+#define RANGE_ANALYSIS(String) \
+    ANTLRInputStream input(String); \
+    eelLexer lexer(&input); \
+    CommonTokenStream tokens(&lexer); \
+    tokens.fill(); \
+    eelParser parser(&tokens); \
+    auto tree = parser.program(); \
+    SymbolTable table; \
+    ScopeVisitor scope_visitor(&table); \
+    scope_visitor.visitProgram(tree); \
+    visitors::RangeVisitor ranges(table.root_scope); \
+
+
+/// Returns the initializer of the n'th top level variable declaration.
+static eelParser::ExprContext* initializer(eelParser::ProgramContext* program, size_t n) {
+    return program->tlDecl(n)->decl()->lDecl()->variableDecl()->expr();
+}
+
+TEST_CASE("pin reads are bounded by the pin type", "[range]") {
+    RANGE_ANALYSIS("pin a analog(0); pin d digital(1); u32 x = read a; u32 y = read d;")
+    auto x = ranges.evaluate(initializer(tree, 2));
+    auto y = ranges.evaluate(initializer(tree, 3));
+    REQUIRE(x.bounded);
+    REQUIRE(x.lo == 0);
+    REQUIRE(x.hi == 1023);
+    REQUIRE(y.hi == 1);
+}
+
+TEST_CASE("remainders and masks bound the result", "[range]") {
+    RANGE_ANALYSIS("u32 t; u32 a = t % 60; u32 b = t & 0xff;")
+    auto a = ranges.evaluate(initializer(tree, 1));
+    auto b = ranges.evaluate(initializer(tree, 2));
+    REQUIRE(a.lo == 0);
+    REQUIRE(a.hi == 59);
+    REQUIRE(b.lo == 0);
+    REQUIRE(b.hi == 255);
+    REQUIRE(b.type == &symbols::Primitive::u32);
+}
+
+TEST_CASE("operations are narrowed when the result fits", "[range]") {
+    RANGE_ANALYSIS("u32 t; u32 a = (t % 60) * 1000; u32 b = t * 2;")
+    auto product = dynamic_cast<eelParser::ScalingExprContext*>(initializer(tree, 1));
+    REQUIRE(product != nullptr);
+    auto narrowed = ranges.narrowed_type(ranges.evaluate(product->left),
+                                         ranges.evaluate(product->right),
+                                         ranges.evaluate(product));
+    REQUIRE(narrowed == &symbols::Primitive::u16);
+
+    auto unbounded = dynamic_cast<eelParser::ScalingExprContext*>(initializer(tree, 2));
+    REQUIRE(unbounded != nullptr);
+    REQUIRE(ranges.narrowed_type(ranges.evaluate(unbounded->left),
+                                 ranges.evaluate(unbounded->right),
+                                 ranges.evaluate(unbounded)) == nullptr);
+}
+
+TEST_CASE("shift amounts must fit the narrowed type", "[range]") {
+    RANGE_ANALYSIS("u32 t; u32 a = (t & 0xf) << 4; u32 b = (t & 0xf) << 20;")
+    auto small = dynamic_cast<eelParser::ShiftingExprContext*>(initializer(tree, 1));
+    auto large = dynamic_cast<eelParser::ShiftingExprContext*>(initializer(tree, 2));
+    REQUIRE(ranges.narrowed_type(ranges.evaluate(small->left), ranges.evaluate(small->right),
+                                 ranges.evaluate(small), true) == &symbols::Primitive::i16);
+    REQUIRE(ranges.narrowed_type(ranges.evaluate(large->left), ranges.evaluate(large->right),
+                                 ranges.evaluate(large), true) == nullptr);
+}
+
+TEST_CASE("operands narrower than int are promoted", "[range]") {
+    RANGE_ANALYSIS("u8 a; u8 b; u8 c; u32 x = (a + b) * (c as u32);")
+    auto product = dynamic_cast<eelParser::ScalingExprContext*>(initializer(tree, 3));
+    REQUIRE(product != nullptr);
+
+    // The sum is computed in `int` and does not wrap at 255
+    auto sum = ranges.evaluate(product->left);
+    REQUIRE(sum.type == &symbols::Primitive::i16);
+    REQUIRE(sum.hi == 510);
+
+    auto result = ranges.evaluate(product);
+    REQUIRE(result.type == &symbols::Primitive::u32);
+    REQUIRE(result.hi == 130050);
+    REQUIRE(ranges.narrowed_type(sum, ranges.evaluate(product->right), result) == nullptr);
+
+    // On the host `int` is 32 bits wide, so 32-bit operations are never narrowed
+    visitors::RangeVisitor host(table.root_scope);
+    host.int_width = 32;
+    REQUIRE(host.evaluate(product->left).type == &symbols::Primitive::i32);
+}
+
+TEST_CASE("widening casts keep the range of their operand", "[range]") {
+    RANGE_ANALYSIS("u16 a; u16 b; i16 c; u64 x = (a as u64) * (b as u64); i64 y = (c as i64) * 3; u64 z = (c as u64);")
+    auto product = dynamic_cast<eelParser::ScalingExprContext*>(initializer(tree, 3));
+    REQUIRE(product != nullptr);
+
+    auto left = ranges.evaluate(product->left);
+    REQUIRE(left.bounded);
+    REQUIRE(left.type == &symbols::Primitive::u64);
+    REQUIRE(left.hi == UINT16_MAX);
+
+    // The product of two u16 always fits u32, so the 64-bit multiply is narrowed
+    auto result = ranges.evaluate(product);
+    REQUIRE(result.bounded);
+    REQUIRE(result.hi == int64_t(UINT16_MAX) * UINT16_MAX);
+    REQUIRE(ranges.narrowed_type(left, ranges.evaluate(product->right), result) == &symbols::Primitive::u32);
+
+    auto scaled = ranges.evaluate(initializer(tree, 4));
+    REQUIRE(scaled.bounded);
+    REQUIRE(scaled.type == &symbols::Primitive::i64);
+    REQUIRE(scaled.lo == int64_t(INT16_MIN) * 3);
+
+    // Negative values wrap when cast to u64
+    REQUIRE_FALSE(ranges.evaluate(initializer(tree, 5)).bounded);
+}
@@ -0,0 +1,82 @@
+#include <catch.hpp>
+#include <string>
+#include "antlr4-runtime.h"
+#include "eelLexer.h"
+#include "eelParser.h"
+#include "Visitors/ScopeVisitor.hpp"
+#include "Visitors/reachability.hpp"
+
+using namespace std;
+using namespace antlr4;
+using namespace eel;
+
+#define REACHABILITY_ANALYSIS(String) \
+    ANTLRInputStream input(String); \
+    eelLexer lexer(&input); \
+    CommonTokenStream tokens(&lexer); \
+    tokens.fill(); \
+    eelParser parser(&tokens); \
+    auto tree = parser.program(); \
+    SymbolTable table; \
+    ScopeVisitor scope_visitor(&table); \
+    scope_visitor.visitProgram(tree); \
+    auto result = visitors::ReachabilityAnalysis(table).run(tree); \
+
+
+TEST_CASE("unused events are removed", "[reachability]") {
+    REACHABILITY_ANALYSIS("event a; event b { return true; } event c { return true; } on c {} loop {}")
+    REQUIRE(result.dead_events.size() == 2);
+    REQUIRE(result.dead_events.contains(table.root_scope->find("a")->value.event));
+    REQUIRE(result.dead_events.contains(table.root_scope->find("b")->value.event));
+}
+
+TEST_CASE("handles of events that never occur are removed", "[reachability]") {
+    REACHABILITY_ANALYSIS("event a; on a {} loop { await a; }")
+    auto a = table.root_scope->find("a")->value.event;
+    REQUIRE(result.dead_events.empty());
+    REQUIRE(a->is_awaited);
+    REQUIRE(result.dead_functions.size() == 1);
+}
+
+TEST_CASE("emits from reachable handles keep events alive", "[reachability]") {
+    REACHABILITY_ANALYSIS("event a; event b; event c { return true; } on c { emit a; } on a { emit b; } on b {}")
+    REQUIRE(result.dead_events.empty());
+    REQUIRE(result.dead_functions.empty());
+}
+
+TEST_CASE("awaits in unreachable handles are ignored", "[reachability]") {
+    REACHABILITY_ANALYSIS("event a; event b; on a { await b; } loop {}")
+    auto b = table.root_scope->find("b")->value.event;
+    REQUIRE(b->is_awaited == false);
+    REQUIRE(result.dead_events.size() == 2);
+}
+
+TEST_CASE("unused built-in events are not reported", "[reachability]") {
+    REACHABILITY_ANALYSIS("// on serial_line {}\nloop {}")
+    REQUIRE(result.dead_events.empty());
+    REQUIRE(result.log.empty());
+    REQUIRE(result.errors.empty());
+}
+
+TEST_CASE("handled built-in events are live", "[reachability]") {
+    REACHABILITY_ANALYSIS("on serial_line { u8 c = serial_view_at(0); }")
+    auto serial_line = table.root_scope->find("serial_line")->value.event;
+    REQUIRE(serial_line->has_predicate);
+    REQUIRE(serial_line->builtin_predicate == "serial_poll_line");
+    REQUIRE(result.dead_events.empty());
+    REQUIRE(result.dead_functions.empty());
+    REQUIRE(result.errors.empty());
+}
+
+TEST_CASE("using both built-in serial events is an error", "[reachability]") {
+    REACHABILITY_ANALYSIS("on serial_data {} loop { await serial_line; }")
+    REQUIRE(result.errors.size() == 1);
+    REQUIRE(result.errors[0].kind == Error::Unsupported);
+}
+
+TEST_CASE("calls of user-defined functions are reported as errors", "[reachability]") {
+    REACHABILITY_ANALYSIS("fn f() {} fn g() {} loop { f(); }")
+    REQUIRE(result.errors.size() == 1);
+    REQUIRE(result.errors[0].kind == Error::Unsupported);
+    REQUIRE(result.dead_declarations.size() == 1);
+}
@@ -0,0 +1,70 @@
+#include <catch.hpp>
+#include <random>
+
+#define NO_ARDUINO
+#include <runtime/arithmetic.hpp>
+
+/// Checks div_const and mod_const against the built-in operators for every value of T.
+template<typename T, T D>
+static void check_exhaustive() {
+    size_t mismatches = 0;
+    for (i64 i = std::numeric_limits<T>::min(); i <= std::numeric_limits<T>::max(); i++) {
+        auto x = static_cast<T>(i);
+        mismatches += div_const<T, D>(x) != static_cast<T>(x / D) || mod_const<T, D>(x) != static_cast<T>(x % D);
+    }
+
+    INFO("divisor " << static_cast<i64>(D));
+    REQUIRE(mismatches == 0);
+}
+
+/// Checks div_const and mod_const against the built-in operators for the extremes
+/// of T and a large number of random values.
+template<typename T, T D>
+static void check_sampled() {
+    std::mt19937_64 rng(static_cast<u64>(D));
+    std::uniform_int_distribution<T> distribution(std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+
+    size_t mismatches = 0;
+    auto check = [&](T x) {
+        mismatches += div_const<T, D>(x) != static_cast<T>(x / D) || mod_const<T, D>(x) != static_cast<T>(x % D);
+    };
+
+    for (T x: {std::numeric_limits<T>::min(), std::numeric_limits<T>::max(), T(0), T(1), T(D - 1), D, static_cast<T>(static_cast<u64>(D) + 1)})
+        check(x);
+    for (int i = 0; i < 1000000; i++)
+        check(distribution(rng));
+
+    INFO("divisor " << static_cast<i64>(D));
+    REQUIRE(mismatches == 0);
+}
+
+template<typename T, T... Ds>
+static void check_all_exhaustive() {
+    (check_exhaustive<T, Ds>(), ...);
+}
+
+template<typename T, T... Ds>
+static void check_all_sampled() {
+    (check_sampled<T, Ds>(), ...);
+}
+
+TEST_CASE("8-bit division by constants", "[arithmetic]") {
+    check_all_exhaustive<u8, 1, 2, 3, 5, 7, 10, 16, 60, 100, 127, 128, 129, 200, 255>();
+    check_all_exhaustive<i8, 1, 2, 3, 5, 7, 10, 16, 60, 100, 127>();
+}
+
+TEST_CASE("16-bit division by constants", "[arithmetic]") {
+    check_all_exhaustive<u16, 1, 3, 7, 10, 60, 100, 641, 1000, 1024, 3600, 32767, 32769, 65535>();
+    check_all_exhaustive<i16, 1, 3, 7, 10, 60, 100, 1000, 1024, 3600, 32767>();
+}
+
+TEST_CASE("32-bit division by constants", "[arithmetic]") {
+    check_all_sampled<u32, 1, 3, 7, 10, 60, 100, 641, 1000, 3600, 86400, 1000000, 65536, 2147483647u, 2147483649u,
+            4294967295u>();
+    check_all_sampled<i32, 1, 3, 7, 10, 60, 100, 1000, 3600, 86400, 1000000, 65536, 2147483647>();
+}
+
+TEST_CASE("64-bit division by powers of two", "[arithmetic]") {
+    check_all_sampled<u64, 1, 2, 1024, u64(1) << 40>();
+    check_all_sampled<i64, 1, 2, 1024, i64(1) << 40>();
+}
@@ -97,7 +97,191 @@ TEST_CASE("predicate-less event is not dispatched until emitted", "[Event]") {
     run_handles(event);
     REQUIRE(x == false); // we expect that the handle was not invoked
     event.emit();
+    latch_emits(event);
     run_handles(event);
     // since the event has been emitted the handle should have been invoked.
     REQUIRE(x == true);
+}
+
+TEST_CASE("an emit runs the handles once", "[Event]") {
+    static int runs = 0;
+    struct State {};
+    struct EventHandle {
+        static void invoke() {
+            runs++;
+        }
+    };
+    Event<PredicateLess, State, EventHandle> event;
+
+    event.emit();
+    for (int pass = 0; pass < 3; pass++) {
+        latch_emits(event);
+        run_handles(event);
+    }
+    REQUIRE(runs == 1);
+    REQUIRE_FALSE(event.has_emit_flag());
+
+    // An emit during a pass is only observed in the next one
+    latch_emits(event);
+    event.emit();
+    run_handles(event);
+    REQUIRE(runs == 1);
+    latch_emits(event);
+    run_handles(event);
+    REQUIRE(runs == 2);
+}
+
+TEST_CASE("a handle and an await observe the same emit", "[Event]") {
+    static int runs = 0;
+    struct State {};
+    struct EventHandle {
+        static void invoke() {
+            runs++;
+        }
+    };
+    static Event<PredicateLess, State, EventHandle> event;
+
+    /*
+     * fn waiter() {
+     *  await event;
+     * }
+     */
+    struct Waiter : AsyncFunction {
+        struct State { u8 s; };
+        static int step(State& state) {
+            switch (state.s) {
+                case 0: { if (event.has_emit_flag()) state.s += 1; return 0; }
+                case 1: return 1;
+            }
+            return 1;
+        }
+    };
+
+    // The await is stepped before and after the dispatch of the handles
+    for (auto await_first: {true, false}) {
+        runs = 0;
+        Waiter::State waiter {};
+        event.emit();
+        latch_emits(event);
+
+        if (await_first)
+            Waiter::step(waiter);
+        run_handles(event);
+        if (!await_first)
+            Waiter::step(waiter);
+
+        REQUIRE(runs == 1);
+        REQUIRE(Waiter::step(waiter));
+
+        // The emit is cleared once the pass is over
+        latch_emits(event);
+        run_handles(event);
+        REQUIRE(runs == 1);
+    }
+}
+
+TEST_CASE("any tests whole groups from an offset", "[StatusFlags]") {
+    StatusFlags<20> flags {};
+    REQUIRE_FALSE(flags.any());
+
+    flags.set<0>(true);
+    flags.set(9, true);
+    flags.set<19>(true);
+
+    REQUIRE(flags.any());
+    REQUIRE(flags.any<1>());
+    REQUIRE_FALSE(flags.any<20>());
+    REQUIRE(flags.get<9>() > 0);
+
+    flags.set<9>(false);
+    flags.set<19>(false);
+    REQUIRE_FALSE(flags.any<1>());
+}
+
+TEST_CASE("flags work for 64-bit groups", "[StatusFlags]") {
+    StatusFlags<128, u64> flags {};
+    flags.set(63, true);
+    flags.set<100>(true);
+    REQUIRE(flags.storage[0] == (u64(1) << 63));
+    REQUIRE(flags.get(63) > 0);
+    REQUIRE(flags.get<100>() > 0);
+    REQUIRE(flags.any<64>());
+    flags.set<100>(false);
+    REQUIRE_FALSE(flags.any<64>());
+}
+
+TEST_CASE("running async handles are only stepped when the event occurs", "[Event]") {
+    static int steps = 0;
+    static bool occurs = false;
+    struct State { int s = 0; };
+    struct States { State handle; };
+    struct Predicate {
+        static bool invoke() { return occurs; }
+    };
+    struct Handle : AsyncFunction {
+        static State& get_state(States& states) { return states.handle; }
+        static int begin_invoke(State& state) {
+            state.s = 0;
+            return step(state);
+        }
+        static int step(State& state) {
+            steps++;
+            return ++state.s == 3;
+        }
+    };
+    Event<Predicate, States, Handle> event {};
+
+    run_handles(event);
+    REQUIRE(steps == 0);
+    REQUIRE_FALSE(event.has_running_handles());
+
+    occurs = true;
+    run_handles(event);
+    occurs = false;
+    REQUIRE(steps == 1);
+    REQUIRE(event.has_running_handles());
+
+    // The handle does not advance while the event does not occur
+    run_handles(event);
+    run_handles(event);
+    REQUIRE(steps == 1);
+    REQUIRE(event.has_running_handles());
+
+    occurs = true;
+    run_handles(event);
+    run_handles(event);
+    occurs = false;
+    REQUIRE(steps == 3);
+    REQUIRE_FALSE(event.has_running_handles());
+
+    run_handles(event);
+    REQUIRE(steps == 3);
+}
+
+static StatusFlags<2> predicate_cache {};
+
+TEST_CASE("cached predicates are only evaluated after invalidation", "[Event]") {
+    static int evaluations = 0;
+    static int value = 0;
+    struct Predicate {
+        static bool invoke() {
+            evaluations++;
+            return value > 2;
+        }
+    };
+    using Cached = CachedPredicate<Predicate, predicate_cache, 1>;
+
+    REQUIRE_FALSE(Cached::invoke());
+    REQUIRE_FALSE(Cached::invoke());
+    REQUIRE(evaluations == 1);
+
+    invalidate<1>(predicate_cache, value = 3);
+    REQUIRE(Cached::invoke());
+    REQUIRE(Cached::invoke());
+    REQUIRE(evaluations == 2);
+
+    // Invalidating another predicate has no effect
+    invalidate<0>(predicate_cache, value = 0);
+    REQUIRE(Cached::invoke());
+    REQUIRE(evaluations == 2);
 }
\ No newline at end of file
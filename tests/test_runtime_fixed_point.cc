@@ -0,0 +1,59 @@
+#include <catch.hpp>
+#include <cmath>
+
+#define NO_ARDUINO
+#include <runtime/platform.hpp>
+#include <runtime/primitives.hpp>
+
+static_assert(q8_8(1.5).raw == 384);
+static_assert((q8_8(1.5) * q8_8(2)).raw == 768);
+static_assert(q16_16(q8_8(1.5)).raw == 98304);
+
+TEST_CASE("fixed-point conversions round and saturate", "[fixed]") {
+    REQUIRE(q8_8(0.1).raw == 26);
+    REQUIRE(q8_8(-0.1).raw == -26);
+    REQUIRE(q8_8(200).raw == q8_8::raw_max);
+    REQUIRE(q8_8(-200.0).raw == q8_8::raw_min);
+    REQUIRE(static_cast<int>(q8_8(-2.75)) == -2);
+    REQUIRE(static_cast<float>(q16_16(0.25)) == 0.25f);
+    REQUIRE(q8_8(q16_16(1000)).raw == q8_8::raw_max);
+}
+
+TEST_CASE("fixed-point arithmetic saturates", "[fixed]") {
+    q8_8 big = 100;
+    REQUIRE((big + big).raw == q8_8::raw_max);
+    REQUIRE((-big - big).raw == q8_8::raw_min);
+    REQUIRE((big * big).raw == q8_8::raw_max);
+    REQUIRE((big * -big).raw == q8_8::raw_min);
+    REQUIRE((-q8_8::from_raw(q8_8::raw_min)).raw == q8_8::raw_max);
+    REQUIRE((big / q8_8(0)).raw == q8_8::raw_max);
+}
+
+TEST_CASE("fixed-point multiplication and division round to nearest", "[fixed]") {
+    // Compare against the exact result for every q8_8 value multiplied by 0.3 and divided by 3
+    auto factor = q8_8(0.3);
+    auto divisor = q8_8(3);
+    for (i32 raw = q8_8::raw_min; raw <= q8_8::raw_max; raw++) {
+        auto x = q8_8::from_raw(static_cast<i16>(raw));
+        auto exact_product = static_cast<double>(raw) * factor.raw / 256.0;
+        auto exact_quotient = static_cast<double>(raw) * 256.0 / divisor.raw;
+        REQUIRE(std::abs((x * factor).raw - exact_product) <= 0.5);
+        REQUIRE(std::abs((x / divisor).raw - exact_quotient) <= 0.5);
+    }
+}
+
+TEST_CASE("large integers saturate instead of overflowing", "[fixed]") {
+    REQUIRE(q8_8(INT32_MAX).raw == q8_8::raw_max);
+    REQUIRE(q8_8(INT32_MIN).raw == q8_8::raw_min);
+    REQUIRE(q8_8(i32(128)).raw == q8_8::raw_max);
+    REQUIRE(q8_8(i32(-128)).raw == q8_8::raw_min);
+    REQUIRE(q8_8(u32(127)).raw == 127 * 256);
+
+    REQUIRE(q16_16(INT64_MAX).raw == q16_16::raw_max);
+    REQUIRE(q16_16(INT64_MIN).raw == q16_16::raw_min);
+    REQUIRE(q16_16(UINT32_MAX).raw == q16_16::raw_max);
+    REQUIRE(q16_16(UINT64_MAX).raw == q16_16::raw_max);
+    REQUIRE(q16_16(INT32_MAX).raw == q16_16::raw_max);
+    REQUIRE(q16_16(i64(-32768)).raw == q16_16::raw_min);
+    REQUIRE(q16_16(i64(-32769)).raw == q16_16::raw_min);
+}
@@ -0,0 +1,46 @@
+#include <catch.hpp>
+#include <string>
+#include "antlr4-runtime.h"
+#include "eelLexer.h"
+#include "eelParser.h"
+#include "Visitors/ScopeVisitor.hpp"
+#include "Visitors/sampling.hpp"
+
+using namespace std;
+using namespace antlr4;
+using namespace eel;
+
+#define INPUT_SAMPLING(String) \
+    ANTLRInputStream input(String); \
+    eelLexer lexer(&input); \
+    CommonTokenStream tokens(&lexer); \
+    tokens.fill(); \
+    eelParser parser(&tokens); \
+    auto tree = parser.program(); \
+    SymbolTable table; \
+    ScopeVisitor scope_visitor(&table); \
+    scope_visitor.visitProgram(tree); \
+    auto result = visitors::InputSampling(table).run(tree); \
+
+
+TEST_CASE("constant digital pins read by predicates are snapshot", "[sampling]") {
+    INPUT_SAMPLING("pin a digital(2); pin b digital(3); pin c digital(4);"
+                   "event x { return read b; } event y { return read a && read b; } on x {} on y {}")
+    REQUIRE(result.sampled_pins.empty());
+    REQUIRE(result.snapshot_pins.size() == 2);
+    REQUIRE(result.snapshot_pins[0] == pair<Symbol::Id, uint8_t>(table.root_scope->find("a")->id, 2));
+    REQUIRE(result.snapshot_pins[1] == pair<Symbol::Id, uint8_t>(table.root_scope->find("b")->id, 3));
+}
+
+TEST_CASE("analog and renumbered pins are sampled individually", "[sampling]") {
+    INPUT_SAMPLING("pin a analog(0); pin b digital(3);"
+                   "event x { return read a > 512 && read b; } on x {} loop { set b pin 5; }")
+    REQUIRE(result.snapshot_pins.empty());
+    REQUIRE(result.sampled_pins.size() == 2);
+}
+
+TEST_CASE("pins only read outside predicates are not sampled", "[sampling]") {
+    INPUT_SAMPLING("pin a digital(2); u8 x = 0; event e { return x > 0; } on e {} loop { x = read a; }")
+    REQUIRE(result.snapshot_pins.empty());
+    REQUIRE(result.sampled_pins.empty());
+}
@@ -77,3 +77,109 @@ TEST_CASE("Setup/Loop void function", "[scope_analysis]") {
     REQUIRE(loop->value.function->has_return_type() == false);
 }
 
+
+TEST_CASE("constant evaluation", "[scope_analysis]") {
+    SCOPE_ANALYSIS("const u16 x = (1 << 4) * 3 + 0x10; const u16 y = x / 4; const bool z = y >= 16;")
+    REQUIRE(scope_visitor.errors.empty());
+    auto x = table.get_scope(0)->find("x");
+    auto y = table.get_scope(0)->find("y");
+    auto z = table.get_scope(0)->find("z");
+    REQUIRE(x->kind == Symbol_::Kind::Constant);
+    REQUIRE(x->value.constant->value.integer == 64);
+    REQUIRE(y->value.constant->value.integer == 16);
+    REQUIRE(z->value.constant->value.boolean == true);
+}
+
+TEST_CASE("constant wraps to declared type", "[scope_analysis]") {
+    SCOPE_ANALYSIS("const u8 x = 255 + 2; const i8 y = 200; const f32 z = 1 / 2;")
+    REQUIRE(scope_visitor.errors.empty());
+    REQUIRE(table.get_scope(0)->find("x")->value.constant->value.integer == 1);
+    REQUIRE(table.get_scope(0)->find("y")->value.constant->value.integer == -56);
+    auto z = table.get_scope(0)->find("z")->value.constant->value;
+    REQUIRE(z.kind == symbols::Constant::Value::Kind::Float);
+    REQUIRE(z.floating == 0);
+}
+
+TEST_CASE("constant operations wrap like the generated code", "[scope_analysis]") {
+    SCOPE_ANALYSIS("const u32 a = 4000000000; const u64 b = a * 2; const i32 c = -16; const i32 d = c >>> 28;"
+                   "const u16 e = 65535; const u32 f = e + 1; const bool g = -1 < (1 as u32);")
+    REQUIRE(scope_visitor.errors.empty());
+    // The product is computed in u32, not in 64 bits
+    REQUIRE(table.get_scope(0)->find("b")->value.constant->value.integer == 3705032704);
+    // The logical shift is carried out in 32 bits
+    REQUIRE(table.get_scope(0)->find("d")->value.constant->value.integer == 15);
+    // u16 is `unsigned int` on AVR, so the sum wraps
+    REQUIRE(table.get_scope(0)->find("f")->value.constant->value.integer == 0);
+    REQUIRE(table.get_scope(0)->find("g")->value.constant->value.boolean == false);
+}
+
+TEST_CASE("non-constant initializer", "[scope_analysis]") {
+    SCOPE_ANALYSIS("u8 a = 2; const u8 x = a + 1; const u8 y = 1 / 0;")
+    REQUIRE(scope_visitor.errors.size() == 2);
+    REQUIRE(scope_visitor.errors.at(0).kind == Error::Kind::NotConstant);
+    REQUIRE(scope_visitor.errors.at(1).kind == Error::Kind::NotConstant);
+    REQUIRE(table.get_scope(0)->find("x").is_nullptr());
+}
+
+TEST_CASE("constant tables", "[scope_analysis]") {
+    SCOPE_ANALYSIS("const u8 n = 2; const u8 t[4] = {n, n * 2, 300}; const u8 s[] = {t[1], 1,};")
+    REQUIRE(scope_visitor.errors.empty());
+    auto t = table.get_scope(0)->find("t")->value.constant->value;
+    REQUIRE(t.kind == symbols::Constant::Value::Kind::Array);
+    REQUIRE(t.elements.size() == 4);
+    REQUIRE(t.elements[1].integer == 4);
+    REQUIRE(t.elements[2].integer == 44);
+    REQUIRE(t.elements[3].integer == 0);
+    auto s = table.get_scope(0)->find("s")->value.constant->value;
+    REQUIRE(s.elements.size() == 2);
+    REQUIRE(s.elements[0].integer == 4);
+}
+
+TEST_CASE("constant table larger than its size", "[scope_analysis]") {
+    SCOPE_ANALYSIS("const u8 t[1] = {1, 2};")
+    REQUIRE(scope_visitor.errors.size() == 1);
+    REQUIRE(scope_visitor.errors.at(0).kind == Error::Kind::TypeMisMatch);
+}
+
+TEST_CASE("multiple handles for one event", "[scope_analysis]") {
+    SCOPE_ANALYSIS("event x; on x {} on x {}")
+    auto x = table.get_scope(0)->find("x");
+    REQUIRE(x->value.event->get_handles().size() == 2);
+}
+
+TEST_CASE("event priorities", "[scope_analysis]") {
+    SCOPE_ANALYSIS("event x priority(2); on x priority(5) {} on x {} event y { return true; } event z priority(0x400);")
+    REQUIRE(scope_visitor.errors.empty());
+    REQUIRE(table.get_scope(0)->find("x")->value.event->priority == 5);
+    REQUIRE(table.get_scope(0)->find("y")->value.event->priority == 0);
+    REQUIRE(table.get_scope(0)->find("z")->value.event->priority == 255);
+}
+
+TEST_CASE("priority is not a reserved word", "[scope_analysis]") {
+    SCOPE_ANALYSIS("u8 priority = 1; event x urgency(2); on x {}")
+    REQUIRE(table.get_scope(0)->find("priority")->kind == Symbol_::Kind::Variable);
+    REQUIRE(scope_visitor.errors.size() == 1);
+    REQUIRE(scope_visitor.errors.at(0).kind == Error::Kind::Unsupported);
+    REQUIRE(table.get_scope(0)->find("x")->value.event->priority == 0);
+}
+
+TEST_CASE("time slicing makes long loops async", "[scope_analysis]") {
+    ANTLRInputStream input("event e { u8 j = 0; while (j < 3) { j = j + 1; } return true; } on e {}"
+                           "loop { u8 i = 0; while (i < 10) { while (true) {} i = i + 1; } }");
+    eelLexer lexer(&input);
+    CommonTokenStream tokens(&lexer);
+    tokens.fill();
+    eelParser parser(&tokens);
+    auto tree = parser.program();
+    SymbolTable table;
+    ScopeVisitor scope_visitor(&table);
+    scope_visitor.time_slicing = true;
+    scope_visitor.visitProgram(tree);
+
+    // Only the outer loop of `loop` is sliced, the predicate stays sync
+    REQUIRE(scope_visitor.sliced_loops.size() == 1);
+    auto loop = table.get_scope(0)->find(visitors::builtin_loop_name)->value.function;
+    REQUIRE(loop->is_async());
+    auto e = table.get_scope(0)->find("e")->value.event;
+    REQUIRE_FALSE(e->predicate->sequence->start->is_async());
+}
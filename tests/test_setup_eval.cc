@@ -0,0 +1,53 @@
+#include <catch.hpp>
+#include <string>
+#include "antlr4-runtime.h"
+#include "eelLexer.h"
+#include "eelParser.h"
+#include "Visitors/ScopeVisitor.hpp"
+#include "Visitors/setup_eval.hpp"
+
+using namespace std;
+using namespace antlr4;
+using namespace eel;
+
+#define SETUP_EVALUATION(String) \
+    ANTLRInputStream input(String); \
+    eelLexer lexer(&input); \
+    CommonTokenStream tokens(&lexer); \
+    tokens.fill(); \
+    eelParser parser(&tokens); \
+    auto tree = parser.program(); \
+    SymbolTable table; \
+    ScopeVisitor scope_visitor(&table); \
+    scope_visitor.visitProgram(tree); \
+    auto result = visitors::SetupEvaluator(table).run(tree); \
+
+
+TEST_CASE("globals assigned in setup are folded", "[setup_evaluation]") {
+    SETUP_EVALUATION("u16 threshold; u8 step = 2; setup { u8 n = 10; threshold = n * step + 1; step = step << 1; }")
+    auto threshold = table.root_scope->find("threshold");
+    auto step = table.root_scope->find("step");
+    REQUIRE(result.elided_statements.size() == 2);
+    REQUIRE(result.initial_values.at(threshold->id).integer == 21);
+    REQUIRE(result.initial_values.at(step->id).integer == 4);
+}
+
+TEST_CASE("evaluation stops at side effects", "[setup_evaluation]") {
+    SETUP_EVALUATION("u8 a; u8 b; setup { a = 1; serial_begin(9600); b = 2; }")
+    REQUIRE(result.elided_statements.size() == 1);
+    REQUIRE(result.initial_values.contains(table.root_scope->find("a")->id));
+    REQUIRE_FALSE(result.initial_values.contains(table.root_scope->find("b")->id));
+}
+
+TEST_CASE("globals read by other initializers are not folded", "[setup_evaluation]") {
+    SETUP_EVALUATION("u8 a = 1; u8 b = a; setup { a = 5; b = a; }")
+    REQUIRE(result.elided_statements.size() == 1);
+    REQUIRE_FALSE(result.initial_values.contains(table.root_scope->find("a")->id));
+    REQUIRE(result.initial_values.at(table.root_scope->find("b")->id).integer == 5);
+}
+
+TEST_CASE("folded assignments wrap like the generated code", "[setup_evaluation]") {
+    SETUP_EVALUATION("u32 a = 4000000000; u64 b; i32 c = -16; i32 d; setup { b = a * 2; d = c >>> 28; }")
+    REQUIRE(result.initial_values.at(table.root_scope->find("b")->id).integer == 3705032704);
+    REQUIRE(result.initial_values.at(table.root_scope->find("d")->id).integer == 15);
+}
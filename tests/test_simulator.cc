@@ -0,0 +1,563 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#define TARGET_SIM
+#include <runtime/all.hpp>
+
+TEST_CASE("virtual clock advances per loop iteration", "[simulator]") {
+    auto& simulator = sim::simulator();
+    simulator.now_us = 0;
+    simulator.tick_us = 250;
+
+    for (int i = 0; i < 4000; i++)
+        loop_tick();
+
+    REQUIRE(micros() == 1'000'000);
+    REQUIRE(millis() == 1000);
+
+    delay(500);
+    REQUIRE(millis() == 1500);
+}
+
+TEST_CASE("scheduled inputs are applied when due", "[simulator]") {
+    auto path = "simulator_inputs.txt";
+    auto file = fopen(path, "w");
+    fprintf(file, "10 2 1\n5 3 512\n20 2 0\n");
+    fclose(file);
+
+    auto& simulator = sim::simulator();
+    simulator.now_us = 0;
+    simulator.tick_us = 1000;
+    simulator.inputs.clear();
+    simulator.next_input = 0;
+    simulator.load_inputs(path);
+    remove(path);
+
+    pinMode(2, INPUT);
+    REQUIRE(digitalRead(2) == LOW);
+
+    delay(5);
+    REQUIRE(analogRead(3) == 512);
+    REQUIRE(digitalRead(2) == LOW);
+
+    delay(5);
+    REQUIRE(digitalRead(2) == HIGH);
+
+    for (int i = 0; i < 10; i++)
+        loop_tick();
+    REQUIRE(digitalRead(2) == LOW);
+}
+
+TEST_CASE("pin writes are visible to reads", "[simulator]") {
+    pin<digital> led(13);
+    led.set_mode(OUTPUT);
+    led.write(HIGH);
+    REQUIRE(led.read() == HIGH);
+    led.write(LOW);
+    REQUIRE(led.read() == LOW);
+}
+
+TEST_CASE("serial output is captured", "[simulator]") {
+    auto& simulator = sim::simulator();
+    simulator.capture_serial = true;
+    simulator.serial_buffer.clear();
+
+    Serial.print("t=");
+    Serial.print(-42);
+    Serial.print(' ');
+    Serial.print(255u, HEX);
+    Serial.print(' ');
+    Serial.println(1.5);
+
+    REQUIRE(simulator.serial_buffer == "t=-42 FF 1.50\r\n");
+    simulator.capture_serial = false;
+}
+
+static pin<analog> sampled_analog {5};
+
+TEST_CASE("input snapshots only change when sampled", "[simulator]") {
+    auto& simulator = sim::simulator();
+    pinMode(6, INPUT);
+    pinMode(7, INPUT);
+    simulator.values[6] = LOW;
+    simulator.values[7] = HIGH;
+    simulator.values[5] = 100;
+
+    DigitalSnapshot<6, 7> inputs {};
+    inputs.sample();
+    SampledPin<sampled_analog>::sample();
+    REQUIRE(inputs.read<0>() == LOW);
+    REQUIRE(inputs.read<1>() == HIGH);
+    REQUIRE(SampledPin<sampled_analog>::value == 100);
+
+    simulator.values[6] = HIGH;
+    simulator.values[5] = 200;
+    REQUIRE(inputs.read<0>() == LOW);
+    REQUIRE(SampledPin<sampled_analog>::value == 100);
+
+    inputs.sample();
+    SampledPin<sampled_analog>::sample();
+    REQUIRE(inputs.read<0>() == HIGH);
+    REQUIRE(SampledPin<sampled_analog>::value == 200);
+}
+
+TEST_CASE("time slices expire after the budget", "[simulator]") {
+    auto& simulator = sim::simulator();
+    simulator.now_us = 0;
+
+    begin_time_slice();
+    delayMicroseconds(EEL_TIME_SLICE_US - 1);
+    REQUIRE_FALSE(time_slice_expired());
+    delayMicroseconds(1);
+    REQUIRE(time_slice_expired());
+
+    begin_time_slice();
+    REQUIRE_FALSE(time_slice_expired());
+}
+
+static ProfileTable<1, 2> profile {};
+
+struct SlowPredicate {
+    static bool invoke() {
+        delayMicroseconds(3);
+        return millis() % 2 == 0;
+    }
+};
+
+struct SlowHandle {
+    static void invoke() {
+        delayMicroseconds(40);
+    }
+};
+
+struct SteppedHandle : AsyncFunction {
+    struct State {
+        int steps;
+    };
+
+    template<typename S>
+    static State& get_state(S& s) { return s; }
+
+    static int begin_invoke(State& state) {
+        state.steps = 0;
+        return step(state);
+    }
+
+    static int step(State& state) {
+        delayMicroseconds(10);
+        return ++state.steps == 3;
+    }
+};
+
+TEST_CASE("profiled predicates and handles are counted and timed", "[simulator]") {
+    auto& simulator = sim::simulator();
+    simulator.now_us = 0;
+
+    using Predicate = ProfiledPredicate<SlowPredicate, profile, 0>;
+    using Handle = ProfiledHandle<SlowHandle, profile, 0, 0>;
+    using Stepped = ProfiledHandle<SteppedHandle, profile, 1, 0>;
+    static_assert(IsAsyncFunction<Stepped>);
+
+    REQUIRE(Predicate::invoke());
+    delay(1);
+    REQUIRE_FALSE(Predicate::invoke());
+    REQUIRE(profile.events[0].predicate_evaluations == 2);
+    REQUIRE(profile.events[0].predicate_true == 1);
+
+    Handle::invoke();
+    Handle::invoke();
+    REQUIRE(profile.events[0].handle_invocations == 2);
+    REQUIRE(profile.handles[0].invocations == 2);
+    REQUIRE(profile.handles[0].min_us == 40);
+    REQUIRE(profile.handles[0].total_us == 80);
+
+    SteppedHandle::State state {};
+    REQUIRE_FALSE(Stepped::begin_invoke(Stepped::get_state(state)));
+    REQUIRE_FALSE(Stepped::step(state));
+    REQUIRE(Stepped::step(state));
+    REQUIRE(profile.events[0].handle_invocations == 3);
+    REQUIRE(profile.events[0].async_steps == 2);
+    REQUIRE(profile.handles[1].invocations == 3);
+    REQUIRE(profile.handles[1].max_us == 10);
+}
+
+TEST_CASE("loop times are binned by powers of two", "[simulator]") {
+    ProfileTable<0, 0> loops {};
+    auto& simulator = sim::simulator();
+    simulator.now_us = 0;
+
+    profile_loop(loops);
+    delayMicroseconds(1);
+    profile_loop(loops);
+    delayMicroseconds(100);
+    profile_loop(loops);
+    delay(1000);
+    profile_loop(loops);
+
+    REQUIRE(loops.loop_histogram[0] == 1);
+    REQUIRE(loops.loop_histogram[6] == 1);
+    REQUIRE(loops.loop_histogram[loop_histogram_bins - 1] == 1);
+}
+
+TEST_CASE("profile dumps are written to serial", "[simulator]") {
+    ProfileTable<2, 1> table {};
+    table.events[1].predicate_true = 7;
+    auto& simulator = sim::simulator();
+    simulator.capture_serial = true;
+    simulator.serial_buffer.clear();
+
+    profile_dump(table);
+
+    auto& dump = simulator.serial_buffer;
+    REQUIRE(dump.size() == 6 + 2 * sizeof(EventCounters) + sizeof(HandleTiming) + 4 * loop_histogram_bins);
+    REQUIRE(dump.substr(0, 2) == "EP");
+    REQUIRE(dump[2] == profile_version);
+    REQUIRE(dump[3] == 2);
+    REQUIRE(dump[4] == 1);
+    REQUIRE(dump[5] == loop_histogram_bins);
+
+    EventCounters second;
+    memcpy(&second, dump.data() + 6 + sizeof(EventCounters), sizeof(second));
+    REQUIRE(second.predicate_true == 7);
+    simulator.capture_serial = false;
+}
+
+static TraceBuffer<4> trace_buffer {};
+
+struct TracedStep : AsyncFunction {
+    struct State {
+        int steps;
+    };
+
+    template<typename S>
+    static State& get_state(S& s) { return s; }
+
+    static int begin_invoke(State& state) {
+        state.steps = 0;
+        return step(state);
+    }
+
+    static int step(State&) {
+        delayMicroseconds(5);
+        return 0;
+    }
+};
+
+TEST_CASE("trace buffers keep the most recent records", "[simulator]") {
+    auto& simulator = sim::simulator();
+    simulator.now_us = 1000;
+    trace_buffer.clear();
+
+    using Handle = TracedHandle<TracedStep, trace_buffer, 2, 1>;
+    TracedStep::State state {};
+    REQUIRE_FALSE(Handle::begin_invoke(state));
+    REQUIRE(trace_buffer.count == 2);
+    REQUIRE(trace_buffer.base_us == 1000);
+    REQUIRE(trace_buffer.records[1].delta_us == 5);
+    REQUIRE(trace_buffer.records[1].event == 2);
+    REQUIRE(trace_buffer.records[1].info == (static_cast<u8>(TraceKind::Yield) << 6 | 1));
+
+    // Gaps longer than a record can hold take up a gap record,
+    // which pushes the first record out of the buffer
+    delay(100);
+    REQUIRE_FALSE(Handle::step(state));
+    REQUIRE(trace_buffer.count == 4);
+    REQUIRE(trace_buffer.head == 1);
+    REQUIRE(trace_buffer.base_us == 1000);
+    REQUIRE(trace_buffer.records[2].event == trace_gap_event);
+    REQUIRE(trace_buffer.records[2].delta_us == 100'000 >> 16);
+    REQUIRE(trace_buffer.records[3].delta_us == (100'000 & 0xFFFF));
+    REQUIRE(trace_buffer.records[3].info >> 6 == static_cast<u8>(TraceKind::Resume));
+
+    simulator.capture_serial = true;
+    simulator.serial_buffer.clear();
+    trace_dump(trace_buffer);
+
+    auto& dump = simulator.serial_buffer;
+    REQUIRE(dump.size() == 9 + 4 * sizeof(TraceRecord));
+    REQUIRE(dump.substr(0, 2) == "ET");
+    REQUIRE(dump[3] == 4);
+
+    // The oldest record is the first yield
+    TraceRecord oldest;
+    memcpy(&oldest, dump.data() + 9, sizeof(oldest));
+    REQUIRE(oldest.delta_us == 5);
+    REQUIRE(oldest.info >> 6 == static_cast<u8>(TraceKind::Yield));
+    REQUIRE(trace_buffer.count == 0);
+    simulator.capture_serial = false;
+}
+
+TEST_CASE("multi-second gaps take up a single trace record", "[simulator]") {
+    auto& simulator = sim::simulator();
+    simulator.now_us = 2000;
+    trace_buffer.clear();
+
+    // Replaying the records from the base time ends at the time of the newest record
+    auto replayed_us = [] {
+        u64 time = trace_buffer.base_us;
+        for (size_t i = 0; i < trace_buffer.count; i++)
+            time += trace_record_us(trace_buffer.records[(trace_buffer.head + i) % decltype(trace_buffer)::size]);
+        return time;
+    };
+
+    using Handle = TracedHandle<TracedStep, trace_buffer, 3, 0>;
+    TracedStep::State state {};
+    REQUIRE_FALSE(Handle::begin_invoke(state));
+
+    delay(10'000);
+    REQUIRE_FALSE(Handle::step(state));
+    // Begin, yield, gap, resume and yield
+    REQUIRE(trace_buffer.count == 4);
+    REQUIRE(trace_buffer.records[2].event == trace_gap_event);
+    REQUIRE(replayed_us() == simulator.now_us);
+
+    // The gap is pushed out of the buffer along with the records before it,
+    // the lower bits of the gap remain part of the resume
+    REQUIRE_FALSE(Handle::step(state));
+    REQUIRE(trace_buffer.base_us == 2000 + 5 + (10'000'000 >> 16 << 16));
+    REQUIRE(replayed_us() == simulator.now_us);
+}
+
+TEST_CASE("serial lengths match the printed text", "[simulator]") {
+    auto& simulator = sim::simulator();
+    simulator.capture_serial = true;
+
+    auto printed = [&](auto... args) {
+        simulator.serial_buffer.clear();
+        Serial.print(args...);
+        return simulator.serial_buffer.size();
+    };
+
+    REQUIRE(serial_length("hello") == printed("hello"));
+    REQUIRE(serial_length('x') == printed('x'));
+    REQUIRE(serial_length(0) == printed(0));
+    REQUIRE(serial_length(-1234) == printed(-1234));
+    REQUIRE(serial_length(255u, HEX) == printed(255u, HEX));
+    REQUIRE(serial_length(65535ul, BIN) == printed(65535ul, BIN));
+    REQUIRE(serial_length(static_cast<u8>(7)) == printed(static_cast<u8>(7)));
+    REQUIRE(serial_length(3.14159) == printed(3.14159));
+    REQUIRE(serial_length(-12.5, 3) == printed(-12.5, 3));
+    simulator.capture_serial = false;
+}
+
+TEST_CASE("serial prints wait for space in the TX buffer", "[simulator]") {
+    auto& simulator = sim::simulator();
+    simulator.capture_serial = true;
+    simulator.serial_buffer.clear();
+    serial::dropped = 0;
+
+    simulator.serial_tx_space = 4;
+    REQUIRE_FALSE(serial_try_print(12345));
+    REQUIRE(serial_try_print(1234));
+    REQUIRE_FALSE(serial_try_println(123));
+    REQUIRE(serial_print_or_drop("too long") == 0);
+    REQUIRE(serial_dropped() == 1);
+    REQUIRE(simulator.serial_buffer == "1234");
+
+    // Text longer than the buffer only needs an empty buffer
+    simulator.serial_tx_space = serial_tx_capacity;
+    REQUIRE(serial_writable(1000));
+    REQUIRE(serial_try_println("a line"));
+    REQUIRE(simulator.serial_buffer == "1234a line\r\n");
+
+    simulator.serial_tx_space = 63;
+    simulator.capture_serial = false;
+}
+
+TEST_CASE("serial_line hands out views of complete lines", "[simulator]") {
+    Serial.receive("12,-3.5\r\nab");
+    REQUIRE(serial_poll_line());
+    REQUIRE(serial_view_length() == 7);
+    REQUIRE(serial_view_at(2) == ',');
+    REQUIRE(serial_view_at(7) == 0);
+
+    REQUIRE(serial_has_number());
+    REQUIRE(serial_next_int() == 12);
+    REQUIRE(serial_next_float() == -3.5f);
+    REQUIRE_FALSE(serial_has_number());
+
+    // The rest of the line arrives later
+    REQUIRE_FALSE(serial_poll_line());
+    REQUIRE(Serial.available() == 2);
+    Serial.receive("c\n");
+    REQUIRE(serial_poll_line());
+    REQUIRE(serial_view_length() == 3);
+    REQUIRE(serial_view_at(0) == 'a');
+
+    REQUIRE_FALSE(serial_poll_line());
+    REQUIRE(Serial.available() == 0);
+}
+
+TEST_CASE("serial_data continues numbers across chunks", "[simulator]") {
+    Serial.receive("x 4");
+    REQUIRE(serial_poll_data());
+    REQUIRE(serial_view_length() == 3);
+    REQUIRE_FALSE(serial_has_number());
+
+    Serial.receive("2 7");
+    REQUIRE(serial_poll_data());
+    REQUIRE(serial_next_int() == 42);
+    REQUIRE_FALSE(serial_has_number());
+
+    REQUIRE_FALSE(serial_poll_data());
+    Serial.receive(" ");
+    REQUIRE(serial_poll_data());
+    REQUIRE(serial_next_int() == 7);
+    REQUIRE_FALSE(serial_poll_data());
+}
+
+TEST_CASE("serial_line hands out a full buffer without delimiter", "[simulator]") {
+    std::string data(serial_rx_size + 8, '1');
+    Serial.receive(data.c_str());
+    REQUIRE(serial_poll_line());
+    REQUIRE(serial_view_length() == serial_rx_size - 1);
+    REQUIRE_FALSE(serial_poll_line());
+    REQUIRE(Serial.available() == 0);
+}
+
+TEST_CASE("coalesced prints are written in order", "[simulator]") {
+    auto& simulator = sim::simulator();
+    simulator.capture_serial = true;
+    simulator.serial_buffer.clear();
+    serial::dropped = 0;
+
+    u8 temperature = 21;
+    REQUIRE(serial_print_all(EEL_FLASH("temp="), temperature, EEL_FLASH(" C" "\r\n")) == 11);
+    REQUIRE(simulator.serial_buffer == "temp=21 C\r\n");
+
+    // Either the whole text fits or nothing is written
+    simulator.serial_tx_space = 10;
+    REQUIRE_FALSE(serial_try_print_all(EEL_FLASH("temp="), temperature, EEL_FLASH(" C" "\r\n")));
+    REQUIRE(serial_try_print_all(EEL_FLASH("t="), -4, '!'));
+    REQUIRE(simulator.serial_buffer == "temp=21 C\r\nt=-4!");
+
+    simulator.serial_tx_space = serial_tx_capacity;
+    simulator.capture_serial = false;
+}
+
+static std::vector<u8> cobs_decode(const u8* frame, size_t length) {
+    std::vector<u8> payload;
+    size_t i = 0;
+    while (i < length && frame[i] != 0) {
+        auto code = frame[i++];
+        for (u8 j = 1; j < code; j++)
+            payload.push_back(frame[i++]);
+        if (code != 0xFF && frame[i] != 0)
+            payload.push_back(0);
+    }
+    return payload;
+}
+
+TEST_CASE("telemetry frames are COBS encoded with a checksum", "[simulator]") {
+    auto& simulator = sim::simulator();
+    simulator.capture_serial = true;
+    simulator.serial_buffer.clear();
+
+    REQUIRE(telemetry_emit(3, static_cast<u16>(0x0100), static_cast<i8>(-1)) == 7);
+    auto& frame = simulator.serial_buffer;
+    REQUIRE(frame.size() == 7);
+    REQUIRE(frame.back() == 0);
+    REQUIRE(frame.find('\0') == frame.size() - 1);
+
+    auto payload = cobs_decode(reinterpret_cast<const u8*>(frame.data()), frame.size());
+    REQUIRE(payload == std::vector<u8> {3, 0x00, 0x01, 0xFF, 3 ^ 0x01 ^ 0xFF});
+
+    // The frame is only sent if it fits as a whole
+    simulator.serial_buffer.clear();
+    simulator.serial_tx_space = 6;
+    REQUIRE_FALSE(telemetry_try_emit(3, static_cast<u16>(0x0100), static_cast<i8>(-1)));
+    simulator.serial_tx_space = 7;
+    REQUIRE(telemetry_try_emit(3, static_cast<u16>(0x0100), static_cast<i8>(-1)));
+    REQUIRE(simulator.serial_buffer.size() == 7);
+
+    simulator.serial_tx_space = serial_tx_capacity;
+    simulator.capture_serial = false;
+}
+
+TEST_CASE("telemetry frames split long runs of non-zero bytes", "[simulator]") {
+    telemetry::Encoder<300> encoder;
+    std::vector<u8> expected;
+    for (int i = 0; i < 300; i++) {
+        encoder.put(static_cast<u8>(i % 255 + 1));
+        expected.push_back(static_cast<u8>(i % 255 + 1));
+    }
+    u8 checksum = 0;
+    for (auto byte: expected)
+        checksum ^= byte;
+    expected.push_back(checksum);
+
+    auto length = encoder.finish();
+    REQUIRE(length <= sizeof(encoder.data));
+    REQUIRE(std::count(encoder.data, encoder.data + length, 0) == 1);
+    REQUIRE(cobs_decode(encoder.data, length) == expected);
+}
+
+TEST_CASE("the clock rolls over at 32 bits like on the device", "[simulator]") {
+    auto& simulator = sim::simulator();
+    simulator.now_us = UINT32_MAX - 99;
+
+    begin_time_slice();
+    delayMicroseconds(100);
+    REQUIRE(micros() == 0);
+    REQUIRE_FALSE(time_slice_expired());
+    delayMicroseconds(EEL_TIME_SLICE_US);
+    REQUIRE(micros() == EEL_TIME_SLICE_US);
+    REQUIRE(time_slice_expired());
+
+    simulator.now_us = uint64_t(UINT32_MAX) * 1000 + 999;
+    REQUIRE(millis() == UINT32_MAX);
+    delay(1);
+    REQUIRE(millis() == 0);
+}
+
+/*
+ * event e;
+ * on e {
+ *  u16 i = 0;
+ *  while (i < 100) { delay_us(100); i = i + 1; }
+ * }
+ */
+struct SlicedHandle : AsyncFunction {
+    struct State { u8 s; u16 i; };
+    template<typename S>
+    static State& get_state(S& states) { return states.handle; }
+    static int begin_invoke(State& state) {
+        state.s = 0;
+        state.i = 0;
+        return step(state);
+    }
+    static int step(State& state) {
+        switch (state.s) {
+            case 0: { bool __expired = false;
+                do { if (!(state.i < 100)) break; delayMicroseconds(100); state.i++; }
+                while (!(__expired = time_slice_expired()));
+                if (__expired) return 0; }
+        }
+        return 1;
+    }
+};
+
+TEST_CASE("a sliced handle runs to completion after a single emit", "[simulator]") {
+    struct States { SlicedHandle::State handle; };
+    static Event<PredicateLess, States, TimeSlicedHandle<SlicedHandle, 0>> event {};
+
+    sim::simulator().now_us = 0;
+    event.emit();
+
+    int passes = 0;
+    for (; passes < 100; passes++) {
+        loop_tick();
+        begin_time_slice();
+        latch_emits(event);
+        run_handles(event);
+        if (!event.has_running_handles())
+            break;
+    }
+
+    // The loop took several time slices, while the event was only emitted once
+    REQUIRE(passes > 1);
+    REQUIRE_FALSE(event.has_running_handles());
+    REQUIRE(event.states.handle.i == 100);
+}
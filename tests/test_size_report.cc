@@ -0,0 +1,84 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include "size_report.hpp"
+
+using namespace std;
+using namespace eel;
+
+// Kept out of .bss by the initialiser, so it is found as initialised data
+char size_report_data[100] = {1};
+char size_report_bss[200];
+
+static const SizeReport::Entry* find_entry(const SizeReport& report, SizeReport::Construct construct,
+                                           const string& name) {
+    auto it = find_if(report.entries.begin(), report.entries.end(), [&](auto& entry) {
+        return entry.construct == construct && entry.name == name;
+    });
+    return it == report.entries.end() ? nullptr : &*it;
+}
+
+TEST_CASE("symbols are read from elf files", "[size]") {
+    ifstream file("/proc/self/exe", ios::binary);
+    vector<uint8_t> image((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    size_report_bss[0] = size_report_data[0];
+
+    auto symbols = read_elf_symbols(image);
+    REQUIRE(symbols.has_value());
+
+    auto data = find_if(symbols->begin(), symbols->end(), [](auto& s) { return s.name == "size_report_data"; });
+    REQUIRE(data != symbols->end());
+    REQUIRE(data->size == 100);
+    REQUIRE(data->in_ram);
+    REQUIRE(data->in_flash);
+
+    auto bss = find_if(symbols->begin(), symbols->end(), [](auto& s) { return s.name == "size_report_bss"; });
+    REQUIRE(bss != symbols->end());
+    REQUIRE(bss->size == 200);
+    REQUIRE(bss->in_ram);
+    REQUIRE_FALSE(bss->in_flash);
+
+    // Names are demangled
+    auto function = find_if(symbols->begin(), symbols->end(), [](auto& s) {
+        return s.name.starts_with("eel::read_elf_symbols(");
+    });
+    REQUIRE(function != symbols->end());
+    REQUIRE(function->in_flash);
+    REQUIRE_FALSE(function->in_ram);
+}
+
+TEST_CASE("non elf files are rejected", "[size]") {
+    REQUIRE_FALSE(read_elf_symbols({}).has_value());
+    REQUIRE_FALSE(read_elf_symbols(vector<uint8_t>(64, 'x')).has_value());
+}
+
+TEST_CASE("sizes are attributed to the constructs they were generated from", "[size]") {
+    vector<ElfSymbol> symbols {
+            {"s3_event_button", 12, false, true},
+            {"s3_event_button_handle0::invoke()", 40, true, false},
+            {"s3_event_button_predicate::invoke()", 20, true, false},
+            {"func7_blink::step(func7_blink::State&)", 30, true, false},
+            {"func1___eel_loop::invoke()", 10, true, false},
+            {"__v12", 2, false, true},
+            {"void run_handles<Event<s3_event_button_predicate, s3_event_button_handle_state> >(Event<...>&)", 16, true, false},
+            {"main", 100, true, false},
+            {"__udivmodsi4", 8, true, false},
+    };
+
+    auto report = SizeReport::build(symbols, {{"__v12", "count"}});
+    REQUIRE(report.flash_bytes == 40 + 20 + 30 + 10 + 16 + 100 + 8);
+    REQUIRE(report.ram_bytes == 12 + 2);
+    REQUIRE(report.entries.front().construct == SizeReport::Construct::Main);
+
+    auto event = find_entry(report, SizeReport::Construct::Event, "button");
+    REQUIRE(event != nullptr);
+    REQUIRE(event->ram_bytes == 12);
+    REQUIRE(find_entry(report, SizeReport::Construct::Handle, "on button #0") != nullptr);
+    REQUIRE(find_entry(report, SizeReport::Construct::Predicate, "button") != nullptr);
+    REQUIRE(find_entry(report, SizeReport::Construct::Function, "blink") != nullptr);
+    REQUIRE(find_entry(report, SizeReport::Construct::Loop, "loop") != nullptr);
+    REQUIRE(find_entry(report, SizeReport::Construct::Variable, "count") != nullptr);
+    REQUIRE(find_entry(report, SizeReport::Construct::Runtime, "run_handles") != nullptr);
+    REQUIRE(find_entry(report, SizeReport::Construct::Other, "other") != nullptr);
+}
@@ -99,4 +99,10 @@ TEST_CASE("function with return value", "[type_analysis]"){
     TYPE_ANALYSIS("event x { return true; } event y {bool t = true; return t;} event z { return \"oh no\"; }")
     REQUIRE(type_visitor.errors.size() == 1);
     REQUIRE(type_visitor.errors.at(0).kind == Error::Kind::InvalidReturnType);
-}
\ No newline at end of file
+}
+
+TEST_CASE("fixed-point literals", "[type_analysis]"){
+    TYPE_ANALYSIS("setup{ q8_8 x = 1.5; q16_16 y = 2; q8_8 z = x * 2.0; f32 w = 1.0; x = w; }")
+    REQUIRE(type_visitor.errors.size() == 1);
+    REQUIRE(type_visitor.errors[0].kind == Error::Kind::TypeMisMatch);
+}
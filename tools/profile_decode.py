@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""
+Decodes a profiling dump of a program compiled with `eelc --profile`.
+
+The dump is what the program writes to serial after receiving a 'P',
+the name map is the <file>.profile.json written by eelc. Other serial
+output before the dump is skipped, if the capture holds several dumps
+the last one is decoded.
+
+Usage: profile_decode.py --map program.eel.profile.json dump.bin
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+VERSION = 1
+HEADER = struct.Struct("<2sBBBB")
+EVENT = struct.Struct("<IIII")
+HANDLE = struct.Struct("<IIII")
+
+
+def find_dump(data):
+    """Finds the start of the last complete dump in the capture."""
+    start = data.rfind(b"EP")
+    while start >= 0:
+        if len(data) - start >= HEADER.size:
+            _, version, event_count, handle_count, bins = HEADER.unpack_from(data, start)
+            size = HEADER.size + event_count * EVENT.size + handle_count * HANDLE.size + bins * 4
+            # The counters may contain "EP" as well, so the header has to be plausible
+            if version == VERSION and len(data) - start >= size:
+                return start
+        start = data.rfind(b"EP", 0, start)
+    raise ValueError("no complete profile dump found")
+
+
+def decode(data):
+    start = find_dump(data)
+    _, _, event_count, handle_count, bins = HEADER.unpack_from(data, start)
+    offset = start + HEADER.size
+
+    events = []
+    for _ in range(event_count):
+        events.append(EVENT.unpack_from(data, offset))
+        offset += EVENT.size
+
+    handles = []
+    for _ in range(handle_count):
+        handles.append(HANDLE.unpack_from(data, offset))
+        offset += HANDLE.size
+
+    histogram = struct.unpack_from(f"<{bins}I", data, offset)
+    return events, handles, histogram
+
+
+def name(names, index, kind):
+    if index >= len(names):
+        return f"<{kind} {index}>"
+    return names[index] if kind == "event" else names[index]["name"]
+
+
+def print_report(events, handles, histogram, names):
+    print(f"{'event':<24}{'evaluated':>12}{'true':>12}{'handled':>12}{'steps':>12}")
+    for i, (evaluated, true, handled, steps) in enumerate(events):
+        print(f"{name(names['events'], i, 'event'):<24}{evaluated:>12}{true:>12}{handled:>12}{steps:>12}")
+
+    print()
+    print(f"{'handle':<24}{'runs':>12}{'min us':>12}{'avg us':>12}{'max us':>12}{'total us':>12}")
+    for i, (runs, min_us, max_us, total_us) in enumerate(handles):
+        label = name(names['handles'], i, 'handle')
+        if runs == 0:
+            print(f"{label:<24}{0:>12}{'-':>12}{'-':>12}{'-':>12}{0:>12}")
+        else:
+            print(f"{label:<24}{runs:>12}{min_us:>12}{total_us // runs:>12}{max_us:>12}{total_us:>12}")
+
+    print()
+    print("loop iteration time")
+    for i, count in enumerate(histogram):
+        low = 0 if i == 0 else 1 << i
+        bound = f">= {low} us" if i == len(histogram) - 1 else f"{low}-{(1 << (i + 1)) - 1} us"
+        print(f"  {bound:<16}{count:>12}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decodes an eelc profiling dump")
+    parser.add_argument("dump", help="raw serial capture containing the dump")
+    parser.add_argument("--map", required=True, help="the <file>.profile.json written by eelc")
+    args = parser.parse_args()
+
+    with open(args.map) as f:
+        names = json.load(f)
+    with open(args.dump, "rb") as f:
+        data = f.read()
+
+    try:
+        events, handles, histogram = decode(data)
+    except (ValueError, struct.error) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    print_report(events, handles, histogram, names)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""
+Decodes the binary telemetry of a program using `emit_telemetry`.
+
+Frames are COBS encoded and end with a zero byte, the schema is the
+<file>.telemetry.json written by eelc. Text and corrupted frames in
+between are skipped, their count is reported on stderr. Each message
+is printed as one line of JSON.
+
+Usage: telemetry_decode.py --schema program.eel.telemetry.json capture.bin
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+VERSION = 1
+FORMATS = {
+    "u8": "B", "i8": "b", "u16": "H", "i16": "h", "u32": "I", "i32": "i",
+    "u64": "Q", "i64": "q", "f32": "f", "f64": "d", "bool": "?",
+    "q8_8": "h", "q16_16": "i",
+}
+SCALES = {"q8_8": 256, "q16_16": 65536}
+
+
+def cobs_decode(frame):
+    """Returns the decoded frame, or None if it is not valid COBS."""
+    data = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame):
+            return None
+        data += frame[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(frame):
+            data.append(0)
+    return bytes(data)
+
+
+def load_schema(path):
+    with open(path) as f:
+        schema = json.load(f)
+    if schema.get("version") != VERSION:
+        raise ValueError(f"unsupported schema version {schema.get('version')}")
+
+    messages = {}
+    for message in schema["messages"]:
+        layout = struct.Struct("<" + "".join(FORMATS[field["type"]] for field in message["fields"]))
+        messages[message["id"]] = (message, layout)
+    return messages
+
+
+def decode(frame, messages):
+    """Returns the message of a frame as a dict, or None if the frame is invalid."""
+    data = cobs_decode(frame)
+    if not data or len(data) < 2:
+        return None
+
+    checksum = 0
+    for byte in data:
+        checksum ^= byte
+    if checksum != 0 or data[0] not in messages:
+        return None
+
+    message, layout = messages[data[0]]
+    payload = data[1:-1]
+    if len(payload) != layout.size:
+        return None
+
+    values = {"id": message["id"], "line": message["line"]}
+    for field, value in zip(message["fields"], layout.unpack(payload)):
+        values[field["name"]] = value / SCALES[field["type"]] if field["type"] in SCALES else value
+    return values
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decodes eelc binary telemetry")
+    parser.add_argument("capture", help="raw serial capture, or - to read stdin")
+    parser.add_argument("--schema", required=True, help="the <file>.telemetry.json written by eelc")
+    args = parser.parse_args()
+
+    try:
+        messages = load_schema(args.schema)
+    except (ValueError, KeyError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    if args.capture == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+
+    # The last piece is an incomplete frame, if any
+    skipped = 0
+    for frame in data.split(b"\0")[:-1]:
+        values = decode(frame, messages)
+        if values is None:
+            skipped += 1
+        else:
+            print(json.dumps(values))
+
+    if skipped > 0:
+        print(f"skipped {skipped} invalid frame(s)", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
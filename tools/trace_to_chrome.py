@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""
+Converts traces of a program compiled with `eelc --trace` to the chrome
+`trace_event` JSON format, which can be opened in chrome://tracing or Perfetto.
+
+The input is either the file streamed by the simulator (EEL_SIM_TRACE) or a
+serial capture containing one or more dumps written after receiving a 'T'.
+The name map is the <file>.trace.json written by eelc.
+
+Every event is shown as a thread, with a slice for each time one of its
+handles runs. Async handles additionally get a span from their beginning
+to their end, which shows handles that overlap across yields.
+
+Usage: trace_to_chrome.py --map program.eel.trace.json trace.bin -o trace.json
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+VERSION = 2
+HEADER = struct.Struct("<2sBHI")
+RECORD = struct.Struct("<HBB")
+STREAMED = 0xFFFF
+GAP_EVENT = 0xFF
+
+BEGIN, END, YIELD, RESUME = range(4)
+
+
+def read_records(data):
+    """Yields (time us, event, handle, kind) for every record of every trace in the data."""
+    start = data.find(b"ET")
+    while start >= 0 and len(data) - start >= HEADER.size:
+        _, version, count, time = HEADER.unpack_from(data, start)
+        if version != VERSION:
+            start = data.find(b"ET", start + 2)
+            continue
+
+        offset = start + HEADER.size
+        end = len(data) if count == STREAMED else min(len(data), offset + count * RECORD.size)
+        while offset + RECORD.size <= end:
+            delta, event, info = RECORD.unpack_from(data, offset)
+            offset += RECORD.size
+            if event == GAP_EVENT:
+                # Gaps hold the upper bits of the time until the next record
+                time += info << 32 | delta << 16
+            else:
+                time += delta
+                yield time, event, info & 0x3F, info >> 6
+        start = data.find(b"ET", offset)
+
+
+def handle_names(names):
+    """Maps (event, index of the handle within the event) to the name of the handle."""
+    result = {}
+    counts = {}
+    for handle in names["handles"]:
+        index = counts.get(handle["event"], 0)
+        counts[handle["event"]] = index + 1
+        result[(handle["event"], index)] = handle["name"]
+    return result
+
+
+def convert(records, names):
+    events = names["events"]
+    handles = handle_names(names)
+    trace = []
+    used_events = set()
+    running = set()
+    spanning = set()
+    begun = {}
+
+    for time, event, handle, kind in records:
+        key = (event, handle)
+        name = handles.get(key, f"handle {event}.{handle}")
+        used_events.add(event)
+        common = {"name": name, "pid": 0, "tid": event, "ts": time}
+
+        if kind in (BEGIN, RESUME):
+            trace.append({**common, "ph": "B"})
+            running.add(key)
+        elif key in running:
+            # Dumps may start in the middle of a handle, which has no beginning to match
+            trace.append({**common, "ph": "E"})
+            running.discard(key)
+
+        span = {"name": name, "cat": "async", "id": f"{event}.{handle}", "pid": 0, "tid": event}
+        if kind == BEGIN:
+            begun[key] = time
+        elif kind == YIELD and key not in spanning and key in begun:
+            # Only handles that yield get a span, starting where the handle began
+            trace.append({**span, "ph": "b", "ts": begun[key]})
+            spanning.add(key)
+        elif kind == END and key in spanning:
+            trace.append({**span, "ph": "e", "ts": time})
+            spanning.discard(key)
+
+    for event in sorted(used_events):
+        label = events[event] if event < len(events) else f"event {event}"
+        trace.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": event, "args": {"name": label}})
+
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Converts an eelc trace to chrome trace_event JSON")
+    parser.add_argument("trace", help="simulator trace file or serial capture containing trace dumps")
+    parser.add_argument("--map", required=True, help="the <file>.trace.json written by eelc")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    args = parser.parse_args()
+
+    with open(args.map) as f:
+        names = json.load(f)
+    with open(args.trace, "rb") as f:
+        data = f.read()
+
+    result = convert(read_records(data), names)
+    if not result["traceEvents"]:
+        print("error: no trace records found", file=sys.stderr)
+        return 1
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(result, f)
+    else:
+        json.dump(result, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())